@@ -66,6 +66,7 @@ Window {
 	Loader {
 		id: dataManagerLoader
 		readonly property bool connectionReady: BackendConnection.state === BackendConnection.Ready
+				|| BackendConnection.warmStarting
 		onConnectionReadyChanged: {
 			if (connectionReady) {
 				active = true
@@ -11,34 +11,30 @@ ListModel {
 
 	readonly property var monitoredStatuses: [ VenusOS.Evcs_Status_Charging, VenusOS.Evcs_Status_Charged, VenusOS.Evcs_Status_Disconnected ]
 
-	property var _statusConnections: Instantiator {
-		model: Global.evChargers.model
-		asynchronous: true
-		delegate: Connections {
-			target: model.device
-			function onStatusChanged() { Qt.callLater(root._reloadCounts) }
-			Component.onCompleted: Qt.callLater(root._reloadCounts)
+	// One filtered model per status, so that a status change only updates the counts of the old
+	// and new statuses, instead of recounting all chargers.
+	property var _statusModels: Instantiator {
+		model: root.monitoredStatuses
+		delegate: FilteredDeviceModel {
+			sourceModel: Global.evChargers.model
+			filterProperty: "status"
+			filterValues: [ modelData ]
+
+			onCountChanged: root._setStatusCount(index, count)
+			Component.onCompleted: root._setStatusCount(index, count)
 		}
 	}
 
-	function _reloadCounts() {
-		let totals = monitoredStatuses.map(function(status) { return 0 })
-		let i
-		for (i = 0; i < Global.evChargers.model.count; ++i) {
-			const charger = Global.evChargers.model.deviceAt(i)
-			const statusIndex = monitoredStatuses.indexOf(charger.status)
-			if (statusIndex >= 0) {
-				totals[statusIndex] += 1
-			}
-		}
-		for (i = 0; i < totals.length; ++i) {
-			setProperty(i, "statusCount", totals[i])
+	function _setStatusCount(statusIndex, statusCount) {
+		if (statusIndex < count) {
+			setProperty(statusIndex, "statusCount", statusCount)
 		}
 	}
 
 	Component.onCompleted: {
 		for (let i = 0; i < monitoredStatuses.length; ++i) {
-			append({ "status": monitoredStatuses[i], "statusCount": 0 })
+			const statusModel = _statusModels.objectAt(i)
+			append({ "status": monitoredStatuses[i], "statusCount": statusModel ? statusModel.count : 0 })
 		}
 	}
 }
@@ -103,7 +103,7 @@ Rectangle {
 			onRunningChanged: {
 				if (running) {
 					logoIconFadeOutAnim.running = true
-				} else if (BackendConnection.state === BackendConnection.Ready) {
+				} else if (BackendConnection.state === BackendConnection.Ready || BackendConnection.warmStarting) {
 					animatedLogo.playing = true
 				}
 			}
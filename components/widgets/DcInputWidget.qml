@@ -12,23 +12,11 @@ OverviewWidget {
 	property DeviceModel inputs: DeviceModel {}
 	property string detailUrl: "/pages/settings/devicelist/dc-in/PageDcMeter.qml"
 
-	function _refreshTotalPower() {
-		let totalPower = NaN
-		let totalCurrent = NaN
-		for (let i = 0; i < inputs.count; ++i) {
-			const input = inputs.deviceAt(i)
-			totalPower = Units.sumRealNumbers(totalPower, input.power)
-			totalCurrent = Units.sumRealNumbers(totalCurrent, input.current)
-		}
-		quantityLabel.dataObject.power = totalPower
-		quantityLabel.dataObject.current = totalCurrent
-	}
-
 	title: !inputs.firstObject ? ""
 		   : Global.dcInputs.inputTypeToText(Global.dcInputs.inputType(inputs.firstObject.serviceUid, inputs.firstObject.monitorMode))
 	quantityLabel.dataObject: QtObject {
-		property real power: NaN
-		property real current: NaN
+		readonly property real power: _totalPower.sum
+		readonly property real current: _totalCurrent.sum
 	}
 	icon.source: "qrc:/images/icon_dc_24.svg"
 	preferLargeSize: false  // there is no extra content, so no need for size L widget.
@@ -45,16 +33,16 @@ OverviewWidget {
 		}
 	}
 
-	Instantiator {
+	DeviceAggregate {
+		id: _totalPower
 		model: root.inputs
-		// Each object in the model should be a DcDevice object with a 'power' value.
-		delegate: Connections {
-			target: model.device
-			function onPowerChanged() {
-				Qt.callLater(root._refreshTotalPower)
-			}
-			Component.onCompleted: Qt.callLater(root._refreshTotalPower)
-		}
+		propertyName: "power"
+	}
+
+	DeviceAggregate {
+		id: _totalCurrent
+		model: root.inputs
+		propertyName: "current"
 	}
 
 	Component {
@@ -40,7 +40,7 @@ Item {
 
 	readonly property bool _shouldInitialize: _dataObjectsReady
 			&& BackendConnection.type !== BackendConnection.UnknownSource
-			&& BackendConnection.state === BackendConnection.Ready
+			&& (BackendConnection.state === BackendConnection.Ready || BackendConnection.warmStarting)
 
 	function _setBackendSource() {
 		if (!_shouldInitialize) {
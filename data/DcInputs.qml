@@ -18,45 +18,28 @@ QtObject {
 	}
 
 	function addInput(input) {
-		if (model.addDevice(input)) {
-			updateTotals()
-		}
+		model.addDevice(input)
 	}
 
 	function removeInput(input) {
-		if (model.removeDevice(input.serviceUid)) {
-			updateTotals()
-		}
-	}
-
-	function updateTotals() {
-		let totalPower = NaN
-		let totalCurrent = NaN
-		for (let i = 0; i < model.count; ++i) {
-			const input = model.deviceAt(i)
-			const p = input.power
-			if (!isNaN(p)) {
-				if (isNaN(totalPower)) {
-					totalPower = 0
-				}
-				totalPower += p
-			}
-			const c = input.current
-			if (!isNaN(c)) {
-				if (isNaN(totalCurrent)) {
-					totalCurrent = 0
-				}
-				totalCurrent += c
-			}
-		}
-		power = totalPower
-		current = totalCurrent
+		model.removeDevice(input.serviceUid)
 	}
 
 	function reset() {
 		model.clear()
-		power = NaN
-		current = NaN
+	}
+
+	// The totals are updated as each input changes, without a pass over all inputs.
+	readonly property DeviceAggregate _totalPower: DeviceAggregate {
+		model: root.model
+		propertyName: "power"
+		onSumChanged: root.power = sum
+	}
+
+	readonly property DeviceAggregate _totalCurrent: DeviceAggregate {
+		model: root.model
+		propertyName: "current"
+		onSumChanged: root.current = sum
 	}
 
 	// TODO these provide names that are not only for DC inputs, e.g. "dcsystem", so should move
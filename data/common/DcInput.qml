@@ -13,8 +13,6 @@ DcDevice {
 	readonly property real temperature: _temperature.value === undefined ? NaN : _temperature.value
 	readonly property int monitorMode: _monitorMode.value === undefined ? -1 : _monitorMode.value
 
-	property bool _completed
-
 	readonly property VeQuickItem _temperature: VeQuickItem {
 		uid: input.serviceUid + "/Dc/0/Temperature"
 	}
@@ -32,18 +30,4 @@ DcDevice {
 			}
 		}
 	}
-
-	function _updateTotals() {
-		if (_completed && !!Global.dcInputs) {
-			Qt.callLater(Global.dcInputs.updateTotals)
-		}
-	}
-
-	onVoltageChanged: _updateTotals()
-	onCurrentChanged: _updateTotals()
-	onPowerChanged: _updateTotals()
-
-	Component.onCompleted: {
-		_completed = true
-	}
 }
@@ -36,6 +36,9 @@ QtObject {
 		}
 	}
 
+	// Only registered once bindPrefix is set, so that "/History/Daily" is not registered as a uid.
+	readonly property int _dailyHistoryHandle: root.bindPrefix ? UidRegistry.handle(root.bindPrefix + "/History/Daily") : 0
+
 	readonly property Instantiator _historyObjects: Instantiator {
 		function dailyHistory(day, trackerIndex) {
 			let overallDailyHistory = objectAt(day)
@@ -62,14 +65,17 @@ QtObject {
 			readonly property Instantiator trackerHistoryObjects: Instantiator {
 				model: root.trackerCount > 1 ? root.trackerCount : null
 				delegate: SolarDailyHistory {
-					uidPrefix: overallDailyHistoryDelegate.uidPrefix + "/Pv/" + model.index
+					uidPrefix: UidRegistry.uid(UidRegistry.childHandle(overallDailyHistoryDelegate._pvHandle, model.index))
 				}
 			}
 
+			readonly property int _dayHandle: UidRegistry.childHandle(root._dailyHistoryHandle, model.index)
+			readonly property int _pvHandle: root.trackerCount > 1 ? UidRegistry.childHandle(_dayHandle, "Pv") : 0
+
 			property bool _completed
 
 			// uid is e.g. com.victronenergy.root.tty0/History/Daily/<day>
-			uidPrefix: root.bindPrefix + "/History/Daily/" + model.index
+			uidPrefix: UidRegistry.uid(_dayHandle)
 
 			onYieldKwhChanged: {
 				if (_completed) {
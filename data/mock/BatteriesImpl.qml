@@ -101,6 +101,16 @@ QtObject {
 		}
 	}
 
+	// The service paths of the Battery properties that can be set by the mock configs.
+	readonly property var _batteryPaths: ({
+		stateOfCharge: "/Soc",
+		voltage: "/Dc/0/Voltage",
+		power: "/Dc/0/Power",
+		current: "/Dc/0/Current",
+		temperature: "/Dc/0/Temperature",
+		timeToGo: "/TimeToGo"
+	})
+
 	property Battery dummyBattery: Battery {
 		serviceUid: "mock/com.victronenergy.battery.ttyUSB1"
 
@@ -111,7 +121,7 @@ QtObject {
 
 		Component.onCompleted: {
 			serviceUid = "mock/com.victronenergy.battery.ttyUSB1"
-			_deviceInstance.setValue(1)
+			Global.mockDataSimulator.setMockValue(serviceUid + "/DeviceInstance", 1)
 			root.initLynxBattery(dummyBattery)
 
 			Global.batteries.system = dummyBattery
@@ -124,7 +134,7 @@ QtObject {
 		function onSetBatteryRequested(config) {
 			if (config) {
 				for (var propName in config) {
-					dummyBattery["_" + propName].setValue(config[propName])
+					Global.mockDataSimulator.setMockValue(dummyBattery.serviceUid + root._batteryPaths[propName], config[propName])
 				}
 			}
 		}
@@ -148,7 +158,7 @@ QtObject {
 		ScriptAction {
 			script: {
 				// negative value == discharging
-				dummyBattery._power.setValue(dummyBattery.power * -1)
+				Global.mockDataSimulator.setMockValue(dummyBattery.serviceUid + "/Dc/0/Power", dummyBattery.power * -1)
 				root.chargeTimer.beginDischarging()
 			}
 		}
@@ -157,6 +167,22 @@ QtObject {
 		}
 	}
 
+	// Services generated with the --mock-fleet option or a --mock-scenario file.
+	readonly property Instantiator fleetObjects: Instantiator {
+		model: VeQItemSortTableModel {
+			dynamicSortFilter: true
+			filterRole: VeQItemTableModel.UniqueIdRole
+			filterRegExp: "^mock/com\.victronenergy\.battery\.(fleet_|scenario)"
+			model: VeQItemTableModel {
+				uids: ["mock"]
+				flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
+			}
+		}
+		delegate: Battery {
+			serviceUid: model.uid
+		}
+	}
+
 	// Use a Timer rather than NumberAnimations because otherwise we get
 	// a heap of animated property value updates showing up in the profiler.
 	property Timer chargeTimer: Timer {
@@ -171,9 +197,10 @@ QtObject {
 				return
 			}
 			var newSoc = Global.batteries.system.stateOfCharge + stepSize
-			if (newSoc >= 0 && newSoc <= 100) { dummyBattery._stateOfCharge.setValue(newSoc) }
-			else if (newSoc > 100) { dummyBattery._stateOfCharge.setValue(100); stop() }
-			else if (newSoc < 0) { dummyBattery._stateOfCharge.setValue(0); stop() }
+			const socUid = dummyBattery.serviceUid + "/Soc"
+			if (newSoc >= 0 && newSoc <= 100) { Global.mockDataSimulator.setMockValue(socUid, newSoc) }
+			else if (newSoc > 100) { Global.mockDataSimulator.setMockValue(socUid, 100); stop() }
+			else if (newSoc < 0) { Global.mockDataSimulator.setMockValue(socUid, 0); stop() }
 			else { stop() }
 		}
 	}
@@ -11,13 +11,14 @@ Item {
 
 	function populate() {
 		const inputCount = (Math.random() * 3) + 1
+		let inputs = []
 		for (let i = 0; i < inputCount; ++i) {
-			const inputObj = inputComponent.createObject(root, {
+			inputs.push(inputComponent.createObject(root, {
 				type: Math.random() * VenusOS.DigitalInput_Type_Generator,
 				state: Math.random() * VenusOS.DigitalInput_State_Stopped
-			})
-			Global.digitalInputs.model.addDevice(inputObj)
+			}))
 		}
+		Global.digitalInputs.model.addDevices(inputs)
 	}
 
 	property Component inputComponent: Component {
@@ -199,6 +199,22 @@ QtObject {
 
 	property var _createdObjects: []
 
+	// Services generated with the --mock-fleet option or a --mock-scenario file.
+	readonly property Instantiator fleetObjects: Instantiator {
+		model: VeQItemSortTableModel {
+			dynamicSortFilter: true
+			filterRole: VeQItemTableModel.UniqueIdRole
+			filterRegExp: "^mock/com\.victronenergy\.solarcharger\.(fleet_|scenario)"
+			model: VeQItemTableModel {
+				uids: ["mock"]
+				flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
+			}
+		}
+		delegate: SolarCharger {
+			serviceUid: model.uid
+		}
+	}
+
 	Component.onCompleted: {
 		populate()
 	}
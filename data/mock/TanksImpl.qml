@@ -125,6 +125,22 @@ QtObject {
 		}
 	}
 
+	// Services generated with the --mock-fleet option or a --mock-scenario file.
+	readonly property Instantiator fleetObjects: Instantiator {
+		model: VeQItemSortTableModel {
+			dynamicSortFilter: true
+			filterRole: VeQItemTableModel.UniqueIdRole
+			filterRegExp: "^mock/com\.victronenergy\.tank\.(fleet_|scenario)"
+			model: VeQItemTableModel {
+				uids: ["mock"]
+				flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
+			}
+		}
+		delegate: Tank {
+			serviceUid: model.uid
+		}
+	}
+
 	Component.onCompleted: {
 		populate()
 	}
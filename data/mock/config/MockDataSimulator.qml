@@ -9,7 +9,8 @@ import Victron.VenusOS
 QtObject {
 	id: root
 
-	property bool timersActive: !Global.splashScreenVisible
+	// A scenario simulates the backend from a worker thread, so the QML timers are not needed.
+	property bool timersActive: !Global.splashScreenVisible && BackendConnection.mockScenario === ""
 	property int deviceCount
 
 	signal setBatteryRequested(config : var)
@@ -23,6 +24,14 @@ QtObject {
 	signal setTanksRequested(config : var)
 	signal addDummyNotification(isAlarm : bool)
 
+	property int _networkProfileIndex
+	readonly property var _networkProfiles: [
+		{ name: "normal", conditions: {} },
+		{ name: "slow", conditions: { latency: 500, jitter: 200 } },
+		{ name: "lossy", conditions: { latency: 150, jitter: 50, drop: 0.1 } },
+		{ name: "bursty", conditions: { latency: 100, burst: 3000 } },
+	]
+
 	readonly property var _configs: ({
 		"qrc:/qt/qml/Victron/VenusOS/pages/BriefPage.qml": briefAndOverviewConfig,
 		"qrc:/qt/qml/Victron/VenusOS/pages/OverviewPage.qml": briefAndOverviewConfig,
@@ -113,6 +122,13 @@ QtObject {
 			Theme.colorScheme = Theme.colorScheme == Theme.Dark ? Theme.Light : Theme.Dark
 			event.accepted = true
 			break
+		case Qt.Key_D:
+			// Cycle through some simulated links to the GX device.
+			root._networkProfileIndex = (root._networkProfileIndex + 1) % root._networkProfiles.length
+			BackendConnection.mockNetworkConditions = root._networkProfiles[root._networkProfileIndex].conditions
+			pageConfigTitle.text = "Network: " + root._networkProfiles[root._networkProfileIndex].name
+			event.accepted = true
+			break
 		case Qt.Key_G:
 			let oldValue
 			let newValue
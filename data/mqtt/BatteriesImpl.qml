@@ -9,7 +9,7 @@ import Victron.VenusOS
 QtObject {
 	property Instantiator batteryObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/battery"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/battery")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 
@@ -20,7 +20,7 @@ QtObject {
 
 	property Instantiator multiRsBatteryObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/multi"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/multi")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 
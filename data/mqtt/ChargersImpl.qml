@@ -11,7 +11,7 @@ QtObject {
 
 	property Instantiator objects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/charger"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/charger")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 		delegate: Charger {
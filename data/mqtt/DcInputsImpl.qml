@@ -11,11 +11,9 @@ QtObject {
 
 	property Instantiator inputObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: [
-				"mqtt/alternator",
-				"mqtt/fuelcell",
-				"mqtt/dcsource",
-			]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/alternator")
+				.concat(BackendConnection.uidPrefixes.map(prefix => prefix + "/fuelcell"))
+				.concat(BackendConnection.uidPrefixes.map(prefix => prefix + "/dcsource"))
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 
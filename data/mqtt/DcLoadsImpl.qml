@@ -11,7 +11,7 @@ Instantiator {
 
 	readonly property Instantiator dcloadObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/dcload"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/dcload")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 
@@ -22,7 +22,7 @@ Instantiator {
 
 	readonly property Instantiator dcsystemObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/dcsystem"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/dcsystem")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 
@@ -33,7 +33,7 @@ Instantiator {
 
 	readonly property Instantiator dcdcObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/dcdc"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/dcdc")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 
@@ -11,7 +11,7 @@ QtObject {
 
 	property Instantiator inputObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/digitalinput"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/digitalinput")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 		delegate: DigitalInput {
@@ -11,7 +11,7 @@ QtObject {
 
 	property Instantiator inputObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/temperature"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/temperature")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 		delegate: EnvironmentInput {
@@ -11,7 +11,7 @@ QtObject {
 
 	property Instantiator chargerObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/evcharger"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/evcharger")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 
@@ -11,7 +11,7 @@ QtObject {
 
 	property Instantiator generatorObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/generator"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/generator")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 
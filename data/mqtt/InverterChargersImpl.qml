@@ -11,7 +11,7 @@ QtObject {
 
 	property Instantiator vebusInverterObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/vebus"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/vebus")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 
@@ -32,7 +32,7 @@ QtObject {
 
 	property Instantiator multiRsInverterObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/multi"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/multi")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 
@@ -53,7 +53,7 @@ QtObject {
 
 	property Instantiator inverterObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/inverter"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/inverter")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 
@@ -11,7 +11,7 @@ QtObject {
 
 	property Instantiator objects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/meteo"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/meteo")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 		delegate: MeteoDevice {
@@ -11,7 +11,7 @@ QtObject {
 
 	property Instantiator objects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/motordrive"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/motordrive")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 		delegate: MotorDrive {
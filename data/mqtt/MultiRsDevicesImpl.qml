@@ -11,7 +11,7 @@ QtObject {
 
 	property Instantiator objects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/multi"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/multi")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 		delegate: MultiRsDevice {
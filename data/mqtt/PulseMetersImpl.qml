@@ -11,7 +11,7 @@ QtObject {
 
 	property Instantiator objects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/pulsemeter"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/pulsemeter")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 		delegate: PulseMeter {
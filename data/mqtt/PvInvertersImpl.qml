@@ -11,7 +11,7 @@ QtObject {
 
 	property Instantiator inverterObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/pvinverter"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/pvinverter")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 
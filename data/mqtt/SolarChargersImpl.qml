@@ -11,7 +11,7 @@ QtObject {
 
 	property Instantiator chargerObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/solarcharger"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/solarcharger")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 
@@ -22,7 +22,7 @@ QtObject {
 
 	property Instantiator multiRsChargerObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/multi"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/multi")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 
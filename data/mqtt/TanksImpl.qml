@@ -11,7 +11,7 @@ QtObject {
 
 	readonly property Instantiator tankObjects: Instantiator {
 		model: VeQItemTableModel {
-			uids: ["mqtt/tank"]
+			uids: BackendConnection.uidPrefixes.map(prefix => prefix + "/tank")
 			flags: VeQItemTableModel.AddChildren | VeQItemTableModel.AddNonLeaves | VeQItemTableModel.DontAddItem
 		}
 		delegate: Tank {
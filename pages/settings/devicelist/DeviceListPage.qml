@@ -206,6 +206,9 @@ Page {
 		model: AggregateDeviceModel {
 			id: aggregateModel
 
+			// Show the devices found in the previous session with this site while the system is
+			// still starting up.
+			cacheId: BackendConnection.siteId ? "devicelist-" + BackendConnection.siteId : ""
 			sourceModels: [
 				Global.batteries.model,
 				Global.chargers.model,
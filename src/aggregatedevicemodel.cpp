@@ -4,20 +4,39 @@
 */
 
 #include "aggregatedevicemodel.h"
+#include "sortedlist.h"
 
 #include <QQmlInfo>
+#include <QSettings>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <iterator>
 
 using namespace Victron::VenusOS;
 
-AggregateDeviceModel::DeviceInfo::DeviceInfo(BaseDevice *d, BaseDeviceModel *m)
+namespace {
+
+// Save the cache once the list has not changed for a while, e.g. after the startup burst.
+const int SaveCacheDelay = 2000;
+
+}
+
+AggregateDeviceModel::DeviceInfo::DeviceInfo(BaseDevice *d, BaseDeviceModel *m, const QCollator &collator)
 	: id(infoId(d, m))
 	, device(d)
 	, sourceModel(m)
-	, cachedDeviceDescription(d ? d->description() : QString())
+	, cachedDeviceDescription(!d ? QString() : d->description().isEmpty() ? d->serviceUid() : d->description())
+	, sortKey(collator.sortKey(cachedDeviceDescription))
+{
+}
+
+AggregateDeviceModel::DeviceInfo::DeviceInfo(const QString &infoId, const QString &description, const QCollator &collator)
+	: id(infoId)
+	, cachedDeviceDescription(description)
+	, sortKey(collator.sortKey(cachedDeviceDescription))
+	, cached(true)
 {
-	if (device && cachedDeviceDescription.isEmpty()) {
-		cachedDeviceDescription = device->serviceUid();
-	}
 }
 
 AggregateDeviceModel::DeviceInfo::~DeviceInfo()
@@ -33,6 +52,12 @@ QString AggregateDeviceModel::DeviceInfo::infoId(BaseDevice *device, BaseDeviceM
 	return sourceModel->modelId() + device->serviceUid();
 }
 
+void AggregateDeviceModel::DeviceInfo::setCachedDeviceDescription(const QString &description, const QCollator &collator)
+{
+	cachedDeviceDescription = description;
+	sortKey = collator.sortKey(description);
+}
+
 
 AggregateDeviceModel::AggregateDeviceModel(QObject *parent)
 	: QAbstractListModel(parent)
@@ -41,13 +66,59 @@ AggregateDeviceModel::AggregateDeviceModel(QObject *parent)
 	m_roleNames[SourceModelRole] = "sourceModel";
 	m_roleNames[ConnectedRole] = "connected";
 	m_roleNames[CachedDeviceDescriptionRole] = "cachedDeviceDescription";
+
+	m_saveCacheTimer.setSingleShot(true);
+	m_saveCacheTimer.setInterval(SaveCacheDelay);
+	connect(&m_saveCacheTimer, &QTimer::timeout, this, &AggregateDeviceModel::saveCache);
+
+	// The rows of the ids are no longer known once rows are inserted, removed or moved.
+	const auto clearRowById = [this]() { m_rowById.clear(); };
+	connect(this, &AggregateDeviceModel::rowsInserted, this, clearRowById);
+	connect(this, &AggregateDeviceModel::rowsRemoved, this, clearRowById);
+	connect(this, &AggregateDeviceModel::rowsMoved, this, clearRowById);
+	connect(this, &AggregateDeviceModel::modelReset, this, clearRowById);
 }
 
 AggregateDeviceModel::~AggregateDeviceModel()
 {
+	if (m_saveCacheTimer.isActive()) {
+		saveCache();
+	}
 	cleanUp();
 }
 
+void AggregateDeviceModel::componentComplete()
+{
+	ParserStatus::componentComplete();
+
+	// Show the cached devices first, then bind them to the devices of the source models.
+	loadCache();
+	const QVariantList models = m_sourceModels;
+	m_sourceModels.clear();
+	setSourceModels(models);
+}
+
+QString AggregateDeviceModel::cacheId() const
+{
+	return m_cacheId;
+}
+
+void AggregateDeviceModel::setCacheId(const QString &cacheId)
+{
+	if (m_cacheId != cacheId) {
+		if (m_saveCacheTimer.isActive()) {
+			saveCache();
+		}
+		m_cacheId = cacheId;
+		if (isComponentComplete()) {
+			// The devices that are still only cached belong to the previous site.
+			removeCachedDevices();
+			loadCache();
+		}
+		emit cacheIdChanged();
+	}
+}
+
 QVariantList AggregateDeviceModel::sourceModels() const
 {
 	return m_sourceModels;
@@ -58,13 +129,14 @@ void AggregateDeviceModel::setSourceModels(const QVariantList &models)
 	if (m_sourceModels == models) {
 		return;
 	}
+	if (!isComponentComplete()) {
+		// Wait until the cache is loaded in componentComplete().
+		m_sourceModels = models;
+		emit sourceModelsChanged();
+		return;
+	}
 
-	const bool wasEmpty = count() == 0;
-	const int prevDisconnectedDeviceCount = m_disconnectedDeviceCount;
-
-	beginResetModel();
-	cleanUp();
-
+	QVector<BaseDeviceModel *> newModels;
 	for (const QVariant &modelVariant : models) {
 		if (!modelVariant.canConvert<BaseDeviceModel*>()) {
 			qmlInfo(this) << "expected BaseDeviceModel* but model type is:" << modelVariant.userType() << " " << modelVariant.typeName();
@@ -75,29 +147,174 @@ void AggregateDeviceModel::setSourceModels(const QVariantList &models)
 			qmlInfo(this) << "cannot use BaseDeviceModel* with empty modelId value:" << modelVariant.userType() << " " << modelVariant.typeName();
 			continue;
 		}
-
-		for (int i = 0; i < model->count(); ++i) {
-			BaseDevice *device = model->deviceAt(i);
-			m_deviceInfos.insert(insertionIndex(device), DeviceInfo(device, model));
-			connect(device, &BaseDevice::descriptionChanged, this, &AggregateDeviceModel::deviceDescriptionChanged);
+		if (!newModels.contains(model)) {
+			newModels.append(model);
 		}
-		connect(model, &BaseDeviceModel::rowsInserted, this, &AggregateDeviceModel::sourceModelRowsInserted);
-		connect(model, &BaseDeviceModel::rowsAboutToBeRemoved, this, &AggregateDeviceModel::sourceModelRowsAboutToBeRemoved);
 	}
 	m_sourceModels = models;
 
-	endResetModel();
+	const int prevCount = count();
+	const int prevDisconnectedDeviceCount = m_disconnectedDeviceCount;
+
+	if (count() == 0) {
+		// Nothing to preserve, so build the list in one go.
+		beginResetModel();
+		cleanUp();
+		for (BaseDeviceModel *model : std::as_const(newModels)) {
+			addSourceModel(model, false);
+		}
+		// Sort once rather than inserting each device at its position. The sort is stable, so
+		// devices with the same description stay in the order of the source models.
+		std::stable_sort(m_deviceInfos.begin(), m_deviceInfos.end(), [](const DeviceInfo &a, const DeviceInfo &b) {
+			return a.sortKey.compare(b.sortKey) < 0;
+		});
+		endResetModel();
+	} else {
+		// Only remove and insert the rows of the models that were removed or added, so that the
+		// other rows (and their delegates and disconnected-device history) are kept.
+		for (const QPointer<BaseDeviceModel> &model : std::as_const(m_models)) {
+			if (!model || !newModels.contains(model.data())) {
+				removeSourceModel(model.data());
+			}
+		}
+		for (BaseDeviceModel *model : std::as_const(newModels)) {
+			if (!m_models.contains(model)) {
+				addSourceModel(model, true);
+			}
+		}
+	}
+
+	m_models.clear();
+	for (BaseDeviceModel *model : std::as_const(newModels)) {
+		m_models.append(model);
+	}
+
 	emit sourceModelsChanged();
+	if (prevCount != count()) {
+		emit countChanged();
+	}
+	if (prevDisconnectedDeviceCount != m_disconnectedDeviceCount) {
+		emit disconnectedDeviceCountChanged();
+	}
+}
+
+void AggregateDeviceModel::addSourceModel(BaseDeviceModel *model, bool insertRows)
+{
+	for (int i = 0; i < model->count(); ++i) {
+		BaseDevice *device = model->deviceAt(i);
+		if (!device) {
+			continue;
+		}
+		const int existingIndex = insertRows ? indexOf(DeviceInfo::infoId(device, model)) : -1;
+		if (existingIndex >= 0) {
+			// A device from the cache, or a disconnected device that is back.
+			bindDevice(existingIndex, device, model);
+			continue;
+		}
+		DeviceInfo deviceInfo(device, model, m_collator);
+		if (insertRows) {
+			const int index = insertionIndex(deviceInfo.sortKey, 0, count());
+			emit beginInsertRows(QModelIndex(), index, index);
+			m_deviceInfos.insert(index, deviceInfo);
+			emit endInsertRows();
+		} else {
+			m_deviceInfos.append(deviceInfo);
+		}
+		connect(device, &BaseDevice::descriptionChanged, this, &AggregateDeviceModel::deviceDescriptionChanged);
+	}
+	scheduleSaveCache();
+	connect(model, &BaseDeviceModel::rowsInserted, this, &AggregateDeviceModel::sourceModelRowsInserted);
+	connect(model, &BaseDeviceModel::rowsAboutToBeRemoved, this, &AggregateDeviceModel::sourceModelRowsAboutToBeRemoved);
+}
+
+void AggregateDeviceModel::removeSourceModel(BaseDeviceModel *model)
+{
+	if (model) {
+		model->disconnect(this);
+	}
 
-	if (wasEmpty) {
+	// Remove the rows of the model's devices, including disconnected ones. A null model removes
+	// the rows of deleted source models, but not the cached devices, which have no model yet.
+	removeDeviceInfos([model](const DeviceInfo &deviceInfo) {
+		return deviceInfo.sourceModel == model && !deviceInfo.cached;
+	});
+}
+
+void AggregateDeviceModel::removeCachedDevices()
+{
+	const int prevCount = count();
+	const int prevDisconnectedDeviceCount = m_disconnectedDeviceCount;
+	removeDeviceInfos([](const DeviceInfo &deviceInfo) {
+		return deviceInfo.cached;
+	});
+	if (prevCount != count()) {
 		emit countChanged();
 	}
-	m_disconnectedDeviceCount = 0;
 	if (prevDisconnectedDeviceCount != m_disconnectedDeviceCount) {
 		emit disconnectedDeviceCountChanged();
 	}
 }
 
+void AggregateDeviceModel::removeDeviceInfos(const std::function<bool(const DeviceInfo &)> &matches)
+{
+	// Remove the matching rows from the last to the first, in contiguous ranges.
+	for (int last = count() - 1; last >= 0; --last) {
+		if (!matches(m_deviceInfos.at(last))) {
+			continue;
+		}
+		int first = last;
+		while (first > 0 && matches(m_deviceInfos.at(first - 1))) {
+			--first;
+		}
+		emit beginRemoveRows(QModelIndex(), first, last);
+		for (int i = last; i >= first; --i) {
+			if (const BaseDevice *device = m_deviceInfos.at(i).device) {
+				device->disconnect(this);
+			}
+		}
+		m_deviceInfos.remove(first, last - first + 1);
+		emit endRemoveRows();
+		last = first;
+	}
+	// Recount rather than decrement, as the devices of a deleted model were never counted as
+	// disconnected.
+	m_disconnectedDeviceCount = static_cast<int>(std::count_if(m_deviceInfos.cbegin(), m_deviceInfos.cend(),
+			[](const DeviceInfo &deviceInfo) { return deviceInfo.device.isNull(); }));
+	scheduleSaveCache();
+}
+
+void AggregateDeviceModel::bindDevice(int index, BaseDevice *device, BaseDeviceModel *sourceModel)
+{
+	DeviceInfo &deviceInfo = m_deviceInfos[index];
+	deviceInfo.cached = false;
+	QList<int> roles = { ConnectedRole };
+	if (deviceInfo.device != device) {
+		if (deviceInfo.device) {
+			deviceInfo.device->disconnect(this);
+		} else {
+			m_disconnectedDeviceCount--;
+		}
+		deviceInfo.device = device;
+		roles << DeviceRole;
+	}
+	if (deviceInfo.sourceModel != sourceModel) {
+		deviceInfo.sourceModel = sourceModel;
+		roles << SourceModelRole;
+	}
+	const bool descriptionChanged = !device->description().isEmpty()
+			&& device->description() != deviceInfo.cachedDeviceDescription;
+	if (descriptionChanged) {
+		deviceInfo.setCachedDeviceDescription(device->description(), m_collator);
+		roles << CachedDeviceDescriptionRole;
+	}
+	emit dataChanged(createIndex(index, 0), createIndex(index, 0), roles);
+	connect(device, &BaseDevice::descriptionChanged, this, &AggregateDeviceModel::deviceDescriptionChanged, Qt::UniqueConnection);
+	if (descriptionChanged) {
+		moveToSortedIndex(index);
+		scheduleSaveCache();
+	}
+}
+
 int AggregateDeviceModel::count() const
 {
 	return static_cast<int>(m_deviceInfos.count());
@@ -177,16 +394,19 @@ void AggregateDeviceModel::removeDisconnectedDevices()
 	emit countChanged();
 	m_disconnectedDeviceCount = 0;
 	emit disconnectedDeviceCountChanged();
+	scheduleSaveCache();
 }
 
 int AggregateDeviceModel::indexOf(const QString &deviceInfoId) const
 {
-	for (int i = 0; i < m_deviceInfos.count(); ++i) {
-		if (deviceInfoId == m_deviceInfos[i].id) {
-			return i;
+	if (m_rowById.isEmpty() && !m_deviceInfos.isEmpty()) {
+		// Add the rows from the last to the first, so that the first row of an id is kept.
+		m_rowById.reserve(m_deviceInfos.count());
+		for (int i = count() - 1; i >= 0; --i) {
+			m_rowById.insert(m_deviceInfos.at(i).id, i);
 		}
 	}
-	return -1;
+	return m_rowById.value(deviceInfoId, -1);
 }
 
 int AggregateDeviceModel::indexOf(const BaseDevice *device) const
@@ -201,15 +421,15 @@ int AggregateDeviceModel::indexOf(const BaseDevice *device) const
 	return -1;
 }
 
-int AggregateDeviceModel::insertionIndex(BaseDevice *newDevice) const
+int AggregateDeviceModel::insertionIndex(const QCollatorSortKey &sortKey, int from, int to) const
 {
-	for (int i = 0; i < m_deviceInfos.count(); ++i) {
-		BaseDevice *device = m_deviceInfos[i].device;
-		if (device && newDevice->description().localeAwareCompare(m_deviceInfos[i].cachedDeviceDescription) < 0) {
-			return i;
-		}
-	}
-	return static_cast<int>(m_deviceInfos.count());
+	// The list is sorted by description, so return the index after the last entry in [from, to)
+	// that does not sort after the key.
+	const auto it = std::upper_bound(m_deviceInfos.cbegin() + from, m_deviceInfos.cbegin() + to, sortKey,
+			[](const QCollatorSortKey &key, const DeviceInfo &deviceInfo) {
+		return key.compare(deviceInfo.sortKey) < 0;
+	});
+	return static_cast<int>(std::distance(m_deviceInfos.cbegin(), it));
 }
 
 void AggregateDeviceModel::cleanUp()
@@ -218,11 +438,14 @@ void AggregateDeviceModel::cleanUp()
 		if (deviceInfo.device) {
 			deviceInfo.device->disconnect(this);
 		}
-		if (deviceInfo.sourceModel) {
-			deviceInfo.sourceModel->disconnect(this);
+	}
+	for (const QPointer<BaseDeviceModel> &model : std::as_const(m_models)) {
+		if (model) {
+			model->disconnect(this);
 		}
 	}
 	m_deviceInfos.clear();
+	m_disconnectedDeviceCount = 0;
 }
 
 void AggregateDeviceModel::sourceModelRowsInserted(const QModelIndex &, int first, int last)
@@ -246,29 +469,21 @@ void AggregateDeviceModel::sourceModelRowsInserted(const QModelIndex &, int firs
 
 		int index = indexOf(DeviceInfo::infoId(device, sourceModel));
 		if (index >= 0) {
-			// The device is already in the list, i.e. it was disconnected then reconnected.
-			QList<int> roles = { ConnectedRole };
-			if (m_deviceInfos[index].device != device) {
-				m_deviceInfos[index].device = device;
-				roles << DeviceRole;
-			}
-			if (!device->description().isEmpty()
-					&& device->description() != m_deviceInfos[index].cachedDeviceDescription) {
-				m_deviceInfos[index].cachedDeviceDescription = device->description();
-				roles << CachedDeviceDescriptionRole;
-			}
-			m_disconnectedDeviceCount--;
-			emit dataChanged(createIndex(index, 0), createIndex(index, 0), roles);
+			// The device is already in the list, i.e. it was disconnected then reconnected, or
+			// it was loaded from the cache.
+			bindDevice(index, device, sourceModel);
 		} else {
 			// Add the device to the list.
-			index = insertionIndex(device);
+			DeviceInfo deviceInfo(device, sourceModel, m_collator);
+			index = insertionIndex(deviceInfo.sortKey, 0, count());
 			emit beginInsertRows(QModelIndex(), index, index);
-			m_deviceInfos.insert(index, DeviceInfo(device, sourceModel));
+			m_deviceInfos.insert(index, deviceInfo);
 			emit endInsertRows();
-		}
 
-		// Be notified when the description changes, so that the list order can be updated.
-		connect(device, &BaseDevice::descriptionChanged, this, &AggregateDeviceModel::deviceDescriptionChanged);
+			// Be notified when the description changes, so that the list order can be updated.
+			connect(device, &BaseDevice::descriptionChanged, this, &AggregateDeviceModel::deviceDescriptionChanged);
+			scheduleSaveCache();
+		}
 	}
 
 	if (prevCount != count()) {
@@ -333,25 +548,18 @@ void AggregateDeviceModel::deviceDescriptionChanged()
 	}
 
 	// Update the cached description
-	m_deviceInfos[fromIndex].cachedDeviceDescription = newDescription;
+	m_deviceInfos[fromIndex].setCachedDeviceDescription(newDescription, m_collator);
 	static const QList<int> roles = { CachedDeviceDescriptionRole };
 	emit dataChanged(createIndex(fromIndex, 0), createIndex(fromIndex, 0), roles);
+	moveToSortedIndex(fromIndex);
+	scheduleSaveCache();
+}
 
-	// Update the list order if needed
-	int toIndex = count() - 1;
-	for (int i = 0; i < m_deviceInfos.count(); ++i) {
-		if (newDescription.localeAwareCompare(m_deviceInfos[i].cachedDeviceDescription) < 0) {
-			if (i > 0 && m_deviceInfos[i - 1].device == changedDevice) {
-				// The device at the previous index is this changed device, so it is already at
-				// the correct index.
-				return;
-			}
-			// Move the entry to be immediately before this item.
-			toIndex = i > fromIndex ? i - 1 : i;
-			break;
-		}
-	}
-
+void AggregateDeviceModel::moveToSortedIndex(int fromIndex)
+{
+	const int toIndex = sortedMoveIndex(m_deviceInfos, fromIndex, [](const DeviceInfo &a, const DeviceInfo &b) {
+		return a.sortKey.compare(b.sortKey) < 0;
+	});
 	if (fromIndex != toIndex) {
 		const int destIndex = toIndex > fromIndex ? toIndex + 1 : toIndex;
 		beginMoveRows(QModelIndex(), fromIndex, fromIndex, QModelIndex(), destIndex);
@@ -359,3 +567,83 @@ void AggregateDeviceModel::deviceDescriptionChanged()
 		endMoveRows();
 	}
 }
+
+QString AggregateDeviceModel::cacheFileName() const
+{
+	const QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+	return dir.isEmpty() || m_cacheId.isEmpty() ? QString() : QStringLiteral("%1/devicelist.ini").arg(dir);
+}
+
+void AggregateDeviceModel::loadCache()
+{
+	const QString fileName = cacheFileName();
+	if (fileName.isEmpty()) {
+		return;
+	}
+
+	QSettings cache(fileName, QSettings::IniFormat);
+	cache.beginGroup(m_cacheId);
+	const int size = cache.beginReadArray(QStringLiteral("devices"));
+	QVector<DeviceInfo> cachedInfos;
+	cachedInfos.reserve(size);
+	for (int i = 0; i < size; ++i) {
+		cache.setArrayIndex(i);
+		const QString id = cache.value(QStringLiteral("id")).toString();
+		// Skip the devices that are already in the list, e.g. when the site id is set after
+		// the devices were found.
+		if (!id.isEmpty() && indexOf(id) < 0) {
+			cachedInfos.append(DeviceInfo(id, cache.value(QStringLiteral("description")).toString(), m_collator));
+		}
+	}
+	if (cachedInfos.isEmpty()) {
+		return;
+	}
+
+	if (count() == 0) {
+		// Add all cached devices as disconnected devices in one go, rather than one row at a time.
+		beginResetModel();
+		m_deviceInfos = cachedInfos;
+		std::stable_sort(m_deviceInfos.begin(), m_deviceInfos.end(), [](const DeviceInfo &a, const DeviceInfo &b) {
+			return a.sortKey.compare(b.sortKey) < 0;
+		});
+		endResetModel();
+	} else {
+		// Keep the existing rows and their delegates, and insert the cached devices among them.
+		for (const DeviceInfo &deviceInfo : std::as_const(cachedInfos)) {
+			const int index = insertionIndex(deviceInfo.sortKey, 0, count());
+			emit beginInsertRows(QModelIndex(), index, index);
+			m_deviceInfos.insert(index, deviceInfo);
+			emit endInsertRows();
+		}
+	}
+	m_disconnectedDeviceCount += static_cast<int>(cachedInfos.count());
+	emit countChanged();
+	emit disconnectedDeviceCountChanged();
+}
+
+void AggregateDeviceModel::scheduleSaveCache()
+{
+	if (isComponentComplete() && !m_cacheId.isEmpty()) {
+		m_saveCacheTimer.start();
+	}
+}
+
+void AggregateDeviceModel::saveCache()
+{
+	m_saveCacheTimer.stop();
+	const QString fileName = cacheFileName();
+	if (fileName.isEmpty()) {
+		return;
+	}
+
+	QSettings cache(fileName, QSettings::IniFormat);
+	cache.beginGroup(m_cacheId);
+	cache.remove(QString());
+	cache.beginWriteArray(QStringLiteral("devices"), count());
+	for (int i = 0; i < count(); ++i) {
+		cache.setArrayIndex(i);
+		cache.setValue(QStringLiteral("id"), m_deviceInfos.at(i).id);
+		cache.setValue(QStringLiteral("description"), m_deviceInfos.at(i).cachedDeviceDescription);
+	}
+	cache.endArray();
+}
@@ -8,20 +8,43 @@
 
 #include <QObject>
 #include <QAbstractListModel>
+#include <QCollator>
+#include <QTimer>
+
+#include <functional>
 
 #include "basedevicemodel.h"
+#include "parserstatus.h"
 
 namespace Victron {
 
 namespace VenusOS {
 
-class AggregateDeviceModel : public QAbstractListModel
+/*
+  Aggregates the devices of the source models into one list, ordered by description.
+
+  If cacheId is set, the id and description of each device are saved to a cache file, and when the
+  model is created, the cached devices are shown straight away as disconnected devices. As the
+  devices are found on the system, they are bound to the existing rows rather than inserted, so
+  that the list does not reorder and grow while the device list page is open during startup.
+  The cacheId should identify the site, so that the devices of one site are not shown as
+  disconnected devices of another; when it changes, the cached devices that are not bound yet
+  are removed and the cached devices of the new site are added, so a site id that is only known
+  after the model is complete still uses the cache.
+
+  Rows are found by id through a hash of the row of each id. The hash is built when a row is
+  first looked up, and dropped when rows are inserted, removed or moved, so binding the devices
+  of a source model to the cached rows costs one pass over the list rather than one per device.
+*/
+class AggregateDeviceModel : public QAbstractListModel, public ParserStatus
 {
 	Q_OBJECT
 	QML_ELEMENT
+	Q_INTERFACES(QQmlParserStatus)
 	Q_PROPERTY(int count READ count NOTIFY countChanged)
 	Q_PROPERTY(int disconnectedDeviceCount READ disconnectedDeviceCount NOTIFY disconnectedDeviceCountChanged)
 	Q_PROPERTY(QVariantList sourceModels READ sourceModels WRITE setSourceModels NOTIFY sourceModelsChanged)
+	Q_PROPERTY(QString cacheId READ cacheId WRITE setCacheId NOTIFY cacheIdChanged)
 
 public:
 	enum RoleNames {
@@ -37,6 +60,9 @@ public:
 	QVariantList sourceModels() const;
 	void setSourceModels(const QVariantList &models);
 
+	QString cacheId() const;
+	void setCacheId(const QString &cacheId);
+
 	int count() const;
 	int disconnectedDeviceCount() const;
 
@@ -45,10 +71,13 @@ public:
 
 	Q_INVOKABLE void removeDisconnectedDevices();
 
+	void componentComplete() override;
+
 signals:
 	void countChanged();
 	void disconnectedDeviceCountChanged();
 	void sourceModelsChanged();
+	void cacheIdChanged();
 
 protected:
 	QHash<int, QByteArray> roleNames() const override;
@@ -57,11 +86,14 @@ private:
 	class DeviceInfo
 	{
 	public:
-		DeviceInfo(BaseDevice *d, BaseDeviceModel *m);
+		DeviceInfo(BaseDevice *d, BaseDeviceModel *m, const QCollator &collator);
+		DeviceInfo(const QString &infoId, const QString &description, const QCollator &collator);   // a cached device
 		~DeviceInfo();
 
 		static QString infoId(BaseDevice *device, BaseDeviceModel *sourceModel);
 
+		void setCachedDeviceDescription(const QString &description, const QCollator &collator);
+
 		// The id uniquely identifies the device even when it is disconnected. It is a combination
 		// of the sourceModel's modelId and the device serviceUid. (It cannot be just the device
 		// serviceUid, since e.g. a vebus device may appear in both the vebus and AC input models.)
@@ -69,19 +101,43 @@ private:
 		QPointer<BaseDevice> device;
 		QPointer<BaseDeviceModel> sourceModel;
 		QString cachedDeviceDescription;
+
+		// The collation key of the cached description, which orders the list. Comparing keys is
+		// much cheaper than comparing the descriptions with localeAwareCompare().
+		QCollatorSortKey sortKey;
+
+		// True for a device loaded from the cache that has not been bound to a device yet. Such
+		// a device has no source model, like the devices of a deleted source model.
+		bool cached = false;
 	};
 
+	void addSourceModel(BaseDeviceModel *model, bool insertRows);
+	void removeSourceModel(BaseDeviceModel *model);
+	void removeCachedDevices();
+	void removeDeviceInfos(const std::function<bool(const DeviceInfo &)> &matches);
+	void bindDevice(int index, BaseDevice *device, BaseDeviceModel *sourceModel);
 	void sourceModelRowsInserted(const QModelIndex &parent, int first, int last);
 	void sourceModelRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
 	int indexOf(const QString &deviceInfoId) const;
 	int indexOf(const BaseDevice *device) const;
-	int insertionIndex(BaseDevice *device) const;
+	int insertionIndex(const QCollatorSortKey &sortKey, int from, int to) const;
 	void deviceDescriptionChanged();
+	void moveToSortedIndex(int fromIndex);
 	void cleanUp();
 
+	QString cacheFileName() const;
+	void loadCache();
+	void scheduleSaveCache();
+	void saveCache();
+
 	QHash<int, QByteArray> m_roleNames;
 	QVector<DeviceInfo> m_deviceInfos;
 	QVariantList m_sourceModels;
+	QVector<QPointer<BaseDeviceModel> > m_models;   // the valid models in m_sourceModels
+	QCollator m_collator;
+	QString m_cacheId;
+	QTimer m_saveCacheTimer;
+	mutable QHash<QString, int> m_rowById;   // built by indexOf(), cleared when rows change
 	int m_disconnectedDeviceCount = 0;
 };
 
@@ -5,13 +5,29 @@
 
 #include "backendconnection.h"
 #include "veqitemmockproducer.h"
+#include "veqitemcoalescingproducer.h"
+#include "veqitemsnapshot.h"
+#include "veqitemrecorder.h"
+#include "veqitemreplayproducer.h"
+#include "mqttsubscriptionmanager.h"
+#include "uidregistry.h"
 #include "enums.h"
+#include "logging.h"
 
 #if !defined(VENUS_WEBASSEMBLY_BUILD)
+#include "dbusinitialfetcher.h"
 #include "veutil/qt/ve_dbus_connection.hpp"
 #include "veutil/qt/ve_qitems_dbus.hpp"
 #endif
 
+#include <QtCore/QCoreApplication>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QMetaEnum>
+#include <QtCore/QSettings>
+#include <QtCore/QStandardPaths>
+#include <QtQuick/QQuickWindow>
 #include <QtNetwork/QNetworkRequest>
 #include <QtNetwork/QNetworkReply>
 #include <QtCore/QJsonDocument>
@@ -19,9 +35,33 @@
 #include <QtCore/QJsonValue>
 #include <QtCore/QJsonArray>
 
+#include <algorithm>
+#include <iterator>
+
 namespace Victron {
 namespace VenusOS {
 
+namespace {
+
+const int SnapshotInterval = 5 * 60 * 1000;
+
+const QFileDevice::Permissions OwnerOnlyPermissions = QFileDevice::ReadOwner | QFileDevice::WriteOwner;
+
+// The mqtt_webhost of an installation is e.g. wss://webmqtt12.victronenergy.com, on shard 12.
+QString shardFromWebhost(const QString &webhost)
+{
+	const qsizetype prefixLength = QStringLiteral("wss://webmqtt").length();
+	return webhost.mid(prefixLength, webhost.indexOf('.') - prefixLength);
+}
+
+// The VRM login cache identifies the user by a hash, rather than by the e-mail address.
+QString vrmUserHash(const QString &user)
+{
+	return QString::fromLatin1(QCryptographicHash::hash(user.toLower().toUtf8(), QCryptographicHash::Sha256).toHex());
+}
+
+}
+
 BackendConnection* BackendConnection::create(QQmlEngine *, QJSEngine *)
 {
 	static BackendConnection* connection = nullptr;
@@ -35,6 +75,10 @@ BackendConnection* BackendConnection::create(QQmlEngine *, QJSEngine *)
 BackendConnection::BackendConnection(QObject *parent)
 	: QObject{parent}
 {
+	m_snapshotTimer.setInterval(SnapshotInterval);
+	connect(&m_snapshotTimer, &QTimer::timeout, this, &BackendConnection::saveSnapshot);
+	connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &BackendConnection::saveSnapshot);
+	resetConnectionMetrics();
 }
 
 BackendConnection::State BackendConnection::state() const
@@ -47,9 +91,111 @@ void BackendConnection::setState(State backendConnectionState)
 	qDebug() << "BackendConnection state:" << backendConnectionState;
 
 	if (m_state != backendConnectionState) {
+		const State previousState = m_state;
 		m_state = backendConnectionState;
+		updateConnectionMetrics(previousState);
+		if (m_coalescingProducer) {
+			// Keep the item tree and its values while reconnecting, and only apply what changed.
+			if (previousState == Ready && m_state != Failed) {
+				m_coalescingProducer->beginResync();
+			} else if (m_state == Ready || m_state == Failed) {
+				m_coalescingProducer->endResync();
+			}
+		}
 		emit stateChanged();
 	}
+
+	if (m_state == Ready) {
+		if (!m_snapshotTimer.isActive() && !snapshotFileName().isEmpty()) {
+			m_snapshotTimer.start();
+		}
+		setWarmStarting(false);
+	} else if (m_state == Failed) {
+		setWarmStarting(false);
+	}
+}
+
+void BackendConnection::resetConnectionMetrics()
+{
+	m_connectionTimer.start();
+	m_stateEnteredMsecs = 0;
+	std::fill(std::begin(m_stateDurations), std::end(m_stateDurations), 0);
+	m_timeToReady = -1;
+	m_reconnectStartMsecs = -1;
+	m_lastReconnectDuration = 0;
+	m_totalReconnectDuration = 0;
+	m_reconnectCount = 0;
+	emit connectionMetricsChanged();
+}
+
+void BackendConnection::updateConnectionMetrics(State previousState)
+{
+	const qint64 now = m_connectionTimer.elapsed();
+	const qint64 previousStateDuration = now - m_stateEnteredMsecs;
+	m_stateDurations[previousState] += previousStateDuration;
+	m_stateEnteredMsecs = now;
+
+	if (m_state == Ready) {
+		if (m_timeToReady < 0) {
+			m_timeToReady = now;
+		} else if (m_reconnectStartMsecs >= 0) {
+			m_lastReconnectDuration = now - m_reconnectStartMsecs;
+			m_totalReconnectDuration += m_lastReconnectDuration;
+			m_reconnectCount++;
+		}
+		m_reconnectStartMsecs = -1;
+	} else if (previousState == Ready) {
+		m_reconnectStartMsecs = now;
+	}
+
+	// One line per transition, in key=value form so that it can be collected and charted.
+	const QMetaEnum stateEnum = QMetaEnum::fromType<State>();
+	qCInfo(venusGui).noquote().nospace() << "connection-metrics"
+			<< " type=" << QMetaEnum::fromType<SourceType>().valueToKey(m_type)
+			<< " from=" << stateEnum.valueToKey(previousState)
+			<< " to=" << stateEnum.valueToKey(m_state)
+			<< " elapsed_ms=" << now
+			<< " state_ms=" << previousStateDuration
+			<< " time_to_ready_ms=" << m_timeToReady
+			<< " reconnects=" << m_reconnectCount
+			<< " last_reconnect_ms=" << m_lastReconnectDuration
+			<< " total_reconnect_ms=" << m_totalReconnectDuration;
+
+	emit connectionMetricsChanged();
+}
+
+qint64 BackendConnection::timeToReady() const
+{
+	return m_timeToReady;
+}
+
+QVariantMap BackendConnection::stateDurations() const
+{
+	const QMetaEnum stateEnum = QMetaEnum::fromType<State>();
+	QVariantMap durations;
+	for (int state = Idle; state <= Failed; ++state) {
+		qint64 duration = m_stateDurations[state];
+		if (state == m_state) {
+			duration += m_connectionTimer.elapsed() - m_stateEnteredMsecs;
+		}
+		durations.insert(QString::fromLatin1(stateEnum.valueToKey(state)), duration);
+	}
+	return durations;
+}
+
+int BackendConnection::reconnectCount() const
+{
+	return m_reconnectCount;
+}
+
+qint64 BackendConnection::lastReconnectDuration() const
+{
+	return m_lastReconnectDuration;
+}
+
+qint64 BackendConnection::totalReconnectDuration() const
+{
+	return m_totalReconnectDuration;
 }
 
 void BackendConnection::setState(VeQItemMqttProducer::ConnectionState backendConnectionState)
@@ -119,6 +265,9 @@ void BackendConnection::mqttErrorChanged()
 			m_mqttClientError = mqttProducer->error();
 			emit mqttClientErrorChanged();
 		}
+		if (m_mqttClientError == QMqttClient::BadUsernameOrPassword || m_mqttClientError == QMqttClient::NotAuthorized) {
+			vrmLoginCacheRejected();
+		}
 	}
 }
 
@@ -130,8 +279,13 @@ BackendConnection::SourceType BackendConnection::type() const
 #if !defined(VENUS_WEBASSEMBLY_BUILD)
 void BackendConnection::initDBusConnection(const QString &address)
 {
-	VeQItemDbusProducer *dbusProducer = new VeQItemDbusProducer(VeQItems::getRoot(), "dbus");
+	// When the initial values are fetched concurrently, the producer must not walk each new
+	// service as well, which would double the startup traffic.
+	const bool fetchInitialValues = m_dbusInitialFetchConcurrency > 0;
+	VeQItemDbusProducer *dbusProducer = new VeQItemDbusProducer(VeQItems::getRoot(), sourceProducerId("dbus"),
+			true, !fetchInitialValues);
 	m_producer = dbusProducer;
+	initCoalescingProducer("dbus");
 
 	if (address.isEmpty()) {
 		qWarning() << "Connecting to system bus...";
@@ -150,8 +304,22 @@ void BackendConnection::initDBusConnection(const QString &address)
 		return;
 	}
 
+	loadSnapshot();
+	startRecording("dbus");
 	dbusProducer->open(dbus);
 
+	if (fetchInitialValues) {
+		setState(Initializing);
+		m_dbusInitialFetcher = new DBusInitialFetcher(dbus,
+			VeQItems::getRoot()->itemGetOrCreate(sourceProducerId("dbus"), false),
+			m_dbusInitialFetchConcurrency, this);
+		connect(m_dbusInitialFetcher, &DBusInitialFetcher::finished, this, [this] {
+			setState(VeDbusConnection::getConnection().isConnected());
+		});
+		m_dbusInitialFetcher->start();
+		return;
+	}
+
 	setState(VeDbusConnection::getConnection().isConnected());
 }
 #endif
@@ -165,8 +333,9 @@ void BackendConnection::initMqttConnection(const QString &address)
 		return;
 	}
 
-	VeQItemMqttProducer *mqttProducer = new VeQItemMqttProducer(VeQItems::getRoot(), "mqtt", "gui-v2");
+	VeQItemMqttProducer *mqttProducer = new VeQItemMqttProducer(VeQItems::getRoot(), sourceProducerId("mqtt"), "gui-v2");
 	m_producer = mqttProducer;
+	initCoalescingProducer("mqtt");
 
 	connect(mqttProducer, &VeQItemMqttProducer::aboutToConnect,
 			mqttProducer, [this] {
@@ -187,6 +356,20 @@ void BackendConnection::initMqttConnection(const QString &address)
 	connect(mqttProducer, &VeQItemMqttProducer::errorChanged,
 		this, &BackendConnection::mqttErrorChanged);
 
+	m_subscriptionManager = new MqttSubscriptionManager(mqttProducer, m_coalescingProducer, this);
+	m_subscriptionManager->setDemandDriven(m_demandDrivenSubscriptionEnabled);
+	m_subscriptionManager->setBackground(!m_applicationVisible);
+	connect(m_subscriptionManager, &MqttSubscriptionManager::trafficChanged,
+		this, &BackendConnection::mqttTrafficChanged);
+
+	loadSnapshot();
+	startRecording("mqtt");
+
+	openMqttProducer(mqttProducer, address);
+}
+
+void BackendConnection::openMqttProducer(VeQItemMqttProducer *mqttProducer, const QString &address)
+{
 #if defined(VENUS_WEBASSEMBLY_BUILD)
 	mqttProducer->open(QUrl(address), QMqttClient::MQTT_3_1);
 #else
@@ -213,20 +396,137 @@ void BackendConnection::initMockConnection()
 	VeQItemMockProducer *producer = new VeQItemMockProducer(VeQItems::getRoot(), "mock");
 	m_producer = producer;
 	producer->initialize();
+	producer->startFleet(m_mockFleet);
+	if (!m_mockScenario.isEmpty()) {
+		QString error;
+		const MockScenario scenario = MockScenario::load(m_mockScenario, &error);
+		if (scenario.isEmpty()) {
+			qCWarning(venusGui) << "Unable to load mock scenario" << m_mockScenario << ":" << error;
+		} else {
+			producer->startScenario(scenario);
+		}
+	}
+	producer->setNetworkConditions(m_mockNetworkConditions);
 	setState(true);
 }
 
+void BackendConnection::initReplayConnection(const QString &id)
+{
+	VeQItemReplayProducer *producer = new VeQItemReplayProducer(VeQItems::getRoot(), sourceProducerId(id));
+	m_producer = producer;
+	initCoalescingProducer(id);
+
+	setState(Initializing);
+	if (!producer->open(m_replayFileName)) {
+		setState(Failed);
+		return;
+	}
+	producer->setSpeed(m_replaySpeed);
+	producer->start();
+	setState(Ready);
+}
+
+void BackendConnection::startRecording(const QString &id)
+{
+	if (m_recordFileName.isEmpty()) {
+		return;
+	}
+	VeQItem *sourceRoot = VeQItems::getRoot()->itemGetOrCreate(sourceProducerId(id), false);
+	m_recorder = new VeQItemRecorder(sourceRoot, id, this);
+	if (!m_recorder->open(m_recordFileName)) {
+		delete m_recorder;
+		m_recorder = nullptr;
+	}
+}
+
+void BackendConnection::setRecordFileName(const QString &fileName)
+{
+	m_recordFileName = fileName;
+}
+
+bool BackendConnection::startReplay(const QString &fileName, qreal speed)
+{
+	const QString recordedPrefix = VeQItemReplayProducer::recordedUidPrefix(fileName);
+	SourceType replayType = UnknownSource;
+	if (recordedPrefix == QStringLiteral("mqtt")) {
+		replayType = MqttSource;
+	} else if (recordedPrefix == QStringLiteral("dbus")) {
+		replayType = DBusSource;
+	} else {
+		qWarning() << "Unable to replay" << fileName << ": not a D-Bus or MQTT recording";
+		return false;
+	}
+
+	m_replayFileName = fileName;
+	m_replaySpeed = speed;
+	// Recording a replay would only produce a copy of the replayed file.
+	m_recordFileName.clear();
+	setType(replayType);
+	return true;
+}
+
+QString BackendConnection::sourceProducerId(const QString &id) const
+{
+	// When updates are coalesced, the backend producer populates a separate tree, and the tree
+	// under the usual "dbus" or "mqtt" id is populated by the coalescing producer instead.
+	return m_updateCoalescingEnabled ? QStringLiteral("%1-source").arg(id) : id;
+}
+
+void BackendConnection::initCoalescingProducer(const QString &id)
+{
+	if (!m_updateCoalescingEnabled) {
+		return;
+	}
+	VeQItem *sourceRoot = VeQItems::getRoot()->itemGetOrCreate(sourceProducerId(id), false);
+	m_coalescingProducer = new VeQItemCoalescingProducer(VeQItems::getRoot(), id, sourceRoot, this);
+	m_coalescingProducer->setWindow(m_window);
+	connect(m_coalescingProducer, &VeQItemCoalescingProducer::droppedUpdateCountChanged,
+		this, &BackendConnection::droppedUpdateCountChanged);
+}
+
 void BackendConnection::setType(const SourceType type, const QString &address)
 {
 	if (m_type == type) {
 		return;
 	}
+	saveSnapshot();
+	m_snapshotTimer.stop();
 	m_type = type;
+	m_address = address;
+	m_serviceUids.clear();
+	resetConnectionMetrics();
 
 	if (m_producer) {
 		m_producer->deleteLater();
 		m_producer = nullptr;
 	}
+	if (m_coalescingProducer) {
+		m_coalescingProducer->deleteLater();
+		m_coalescingProducer = nullptr;
+	}
+	if (m_recorder) {
+		delete m_recorder;
+		m_recorder = nullptr;
+	}
+	if (m_subscriptionManager) {
+		delete m_subscriptionManager;
+		m_subscriptionManager = nullptr;
+	}
+	removeAdditionalMqttSources();
+#if !defined(VENUS_WEBASSEMBLY_BUILD)
+	if (m_dbusInitialFetcher) {
+		delete m_dbusInitialFetcher;
+		m_dbusInitialFetcher = nullptr;
+	}
+#endif
+
+	if (!m_replayFileName.isEmpty() && (type == DBusSource || type == MqttSource)) {
+		initReplayConnection(uidPrefix());
+		emit typeChanged();
+		emit siteIdChanged();
+		emit uidPrefixesChanged();
+		return;
+	}
 
 	switch (type) {
 	case DBusSource:
@@ -238,6 +538,9 @@ void BackendConnection::setType(const SourceType type, const QString &address)
 		break;
 	case MqttSource:
 		initMqttConnection(address);
+		for (const QString &additionalAddress : std::as_const(m_additionalMqttAddresses)) {
+			connectAdditionalMqttSource(additionalAddress);
+		}
 		break;
 	case MockSource:
 		initMockConnection();
@@ -245,8 +548,13 @@ void BackendConnection::setType(const SourceType type, const QString &address)
 	default:
 		qWarning() << "Unsupported backend source type!" << type;
 	}
+	if (type != MqttSource && type != UnknownSource && !m_additionalMqttAddresses.isEmpty()) {
+		qWarning() << "Additional MQTT sources are not connected, as the backend is not MQTT";
+	}
 
 	emit typeChanged();
+	emit siteIdChanged();
+	emit uidPrefixesChanged();
 }
 
 QString BackendConnection::username() const
@@ -285,7 +593,23 @@ void BackendConnection::setPortalId(const QString &portalId)
 	if (m_portalId != portalId) {
 		m_portalId = portalId;
 		emit portalIdChanged();
+		emit siteIdChanged();
+	}
+}
+
+QString BackendConnection::siteId() const
+{
+	const QString prefix = uidPrefix();
+	if (prefix.isEmpty() || m_type == MockSource) {
+		return prefix;
 	}
+	QString site = m_portalId.isEmpty() ? m_address : m_portalId.toLower();
+	for (QChar &c : site) {
+		if (!c.isLetterOrNumber()) {
+			c = QLatin1Char('_');
+		}
+	}
+	return site.isEmpty() ? prefix : QStringLiteral("%1-%2").arg(prefix, site);
 }
 
 QString BackendConnection::shard() const
@@ -329,6 +653,21 @@ void BackendConnection::setIdUser(int id)
 
 void BackendConnection::loginVrmApi()
 {
+	QString webhost;
+	if (loadVrmLoginCache(&webhost)) {
+		// Connect straight away, and check in the background that the token is still accepted.
+		qCInfo(venusGui) << "Using cached VRM API login for portal" << m_portalId;
+		m_vrmLoginFromCache = true;
+		connectToVrmWebhost(webhost);
+		validateVrmLoginCache();
+		return;
+	}
+	requestVrmLogin();
+}
+
+void BackendConnection::requestVrmLogin()
+{
+	m_vrmLoginFromCache = false;
 	if (m_username.isEmpty() || m_password.isEmpty()) {
 		qWarning() << "Unable to login to VRM API: invalid credentials supplied";
 		return;
@@ -339,11 +678,8 @@ void BackendConnection::loginVrmApi()
 	}
 
 	const QByteArray loginData = QStringLiteral("{ \"username\": \"%1\", \"password\": \"%2\" }")
-			.arg(m_username.startsWith(QStringLiteral("vrmlogin_live_"), Qt::CaseInsensitive)
-					? m_username.mid(QStringLiteral("vrmlogin_live_").length())
-					: m_username,
-				m_password).toUtf8();
-	QNetworkRequest loginRequest(QUrl(QStringLiteral("https://vrmapi.victronenergy.com/v2/auth/login")));
+			.arg(plainVrmUsername(), m_password).toUtf8();
+	QNetworkRequest loginRequest(QUrl(QStringLiteral("%1/v2/auth/login").arg(m_vrmApiUrl)));
 	loginRequest.setHeader(QNetworkRequest::ContentTypeHeader, QStringLiteral("application/json").toUtf8());
 	loginRequest.setHeader(QNetworkRequest::ContentLengthHeader, loginData.size());
 	QNetworkReply *loginReply = m_network->post(loginRequest, loginData);
@@ -394,7 +730,7 @@ void BackendConnection::requestShardFromVrmApi()
 		m_network = new QNetworkAccessManager(this);
 	}
 
-	QNetworkRequest installationsRequest(QUrl(QStringLiteral("https://vrmapi.victronenergy.com/v2/users/%1/installations?extended=1").arg(m_idUser)));
+	QNetworkRequest installationsRequest(QUrl(QStringLiteral("%1/v2/users/%2/installations?extended=1").arg(m_vrmApiUrl).arg(m_idUser)));
 	installationsRequest.setRawHeader(QStringLiteral("x-authorization").toUtf8(),
 			QStringLiteral("Bearer %1").arg(m_token).toUtf8());
 	QNetworkReply *installationsReply = m_network->get(installationsRequest);
@@ -428,8 +764,7 @@ void BackendConnection::requestShardFromVrmApi()
 					const QString mqtt_webhost = record.value(QStringLiteral("mqtt_webhost")).toString();
 					const QString webhost = mqtt_webhost.startsWith(QStringLiteral("wss://"), Qt::CaseInsensitive)
 							? mqtt_webhost : QStringLiteral("wss://%1").arg(mqtt_webhost);
-					const qsizetype prefixLength = QStringLiteral("wss://webmqtt").length();
-					const QString shard = webhost.mid(prefixLength, webhost.indexOf('.') - prefixLength);
+					const QString shard = shardFromWebhost(webhost);
 					if (shard.isEmpty()) {
 						qWarning() << "Unable to determine shard from mqtt_webhost " << mqtt_webhost << " in record " << record.toVariantMap();
 						qWarning() << "Original response was: " << response;
@@ -438,10 +773,8 @@ void BackendConnection::requestShardFromVrmApi()
 
 					qDebug() << "Calculated shard: " << shard << " from webhost: " << webhost;
 					setShard(shard);
-					if (!m_username.startsWith(QStringLiteral("vrmlogin_live_"), Qt::CaseInsensitive)) {
-						setUsername(QStringLiteral("vrmlogin_live_%1").arg(m_username));
-					}
-					setType(MqttSource, webhost);
+					saveVrmLoginCache(webhost);
+					connectToVrmWebhost(webhost);
 					return;
 				}
 			}
@@ -450,6 +783,158 @@ void BackendConnection::requestShardFromVrmApi()
 		});
 }
 
+void BackendConnection::setVrmApiUrl(const QString &url)
+{
+	m_vrmApiUrl = url.endsWith(QLatin1Char('/')) ? url.chopped(1) : url;
+}
+
+void BackendConnection::connectToVrmWebhost(const QString &webhost)
+{
+	if (!m_username.startsWith(QStringLiteral("vrmlogin_live_"), Qt::CaseInsensitive)) {
+		setUsername(QStringLiteral("vrmlogin_live_%1").arg(m_username));
+	}
+	if (m_type == MqttSource) {
+		// Already connected with cached values that turned out to be stale; reconnect.
+		setType(UnknownSource);
+	}
+	setType(MqttSource, webhost);
+}
+
+QString BackendConnection::vrmLoginCacheFileName() const
+{
+#if defined(VENUS_WEBASSEMBLY_BUILD)
+	// The cache location is not persistent in a browser, and the token would be stored in the
+	// browser's storage for the site.
+	return QString();
+#else
+	const QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+	return dir.isEmpty() ? QString() : QStringLiteral("%1/vrmlogin.ini").arg(dir);
+#endif
+}
+
+bool BackendConnection::loadVrmLoginCache(QString *webhost)
+{
+	const QString fileName = vrmLoginCacheFileName();
+	if (fileName.isEmpty() || m_portalId.isEmpty() || !QFile::exists(fileName)) {
+		return false;
+	}
+
+	QSettings cache(fileName, QSettings::IniFormat);
+	cache.beginGroup(m_portalId.toLower());
+	const QString userHash = cache.value(QStringLiteral("userHash")).toString();
+	const QString token = cache.value(QStringLiteral("token")).toString();
+	const QString cachedWebhost = cache.value(QStringLiteral("webhost")).toString();
+	const QDateTime expiry = cache.value(QStringLiteral("expiry")).toDateTime();
+
+	// The cache is only valid for the user that logged in, not just for the portal.
+	if (userHash.isEmpty() || userHash != vrmUserHash(plainVrmUsername())
+			|| token.isEmpty() || cachedWebhost.isEmpty()) {
+		return false;
+	}
+	if (!expiry.isValid() || expiry <= QDateTime::currentDateTimeUtc()) {
+		qCInfo(venusGui) << "Cached VRM API login has expired";
+		return false;
+	}
+
+	setToken(token);
+	setShard(shardFromWebhost(cachedWebhost));
+	*webhost = cachedWebhost;
+	return true;
+}
+
+void BackendConnection::saveVrmLoginCache(const QString &webhost)
+{
+	const QString fileName = vrmLoginCacheFileName();
+	if (fileName.isEmpty()) {
+		return;
+	}
+
+	// Use the expiry time in the token (a JWT) if there is one, otherwise assume a day.
+	QDateTime expiry = QDateTime::currentDateTimeUtc().addDays(1);
+	const QByteArray tokenPayload = QByteArray::fromBase64(m_token.section(QLatin1Char('.'), 1, 1).toLatin1(),
+			QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals);
+	const qint64 exp = QJsonDocument::fromJson(tokenPayload).object().value(QStringLiteral("exp")).toVariant().toLongLong();
+	if (exp > 0) {
+		expiry = QDateTime::fromSecsSinceEpoch(exp, Qt::UTC);
+	}
+
+	// The file holds bearer tokens, so only the user may read it. Create it with those
+	// permissions, so that it is never readable by others, even briefly.
+	if (!QFile::exists(fileName)) {
+		QFile file(fileName);
+		if (!file.open(QIODevice::WriteOnly, OwnerOnlyPermissions)) {
+			qCWarning(venusGui) << "Unable to create VRM login cache" << fileName << ":" << file.errorString();
+			return;
+		}
+	}
+
+	// Only what is needed to connect again is stored: the token, and the webhost that the shard
+	// is derived from.
+	QSettings cache(fileName, QSettings::IniFormat);
+	cache.beginGroup(m_portalId.toLower());
+	cache.remove(QString());
+	cache.setValue(QStringLiteral("userHash"), vrmUserHash(plainVrmUsername()));
+	cache.setValue(QStringLiteral("token"), m_token);
+	cache.setValue(QStringLiteral("webhost"), webhost);
+	cache.setValue(QStringLiteral("expiry"), expiry);
+	cache.endGroup();
+	cache.sync();
+	QFile::setPermissions(fileName, OwnerOnlyPermissions);
+}
+
+void BackendConnection::clearVrmLoginCache()
+{
+	const QString fileName = vrmLoginCacheFileName();
+	if (!fileName.isEmpty() && !m_portalId.isEmpty()) {
+		QSettings cache(fileName, QSettings::IniFormat);
+		cache.remove(m_portalId.toLower());
+	}
+}
+
+void BackendConnection::validateVrmLoginCache()
+{
+	if (m_network == nullptr) {
+		m_network = new QNetworkAccessManager(this);
+	}
+
+	QNetworkRequest meRequest(QUrl(QStringLiteral("%1/v2/users/me").arg(m_vrmApiUrl)));
+	meRequest.setRawHeader(QStringLiteral("x-authorization").toUtf8(),
+			QStringLiteral("Bearer %1").arg(m_token).toUtf8());
+	QNetworkReply *meReply = m_network->get(meRequest);
+
+	connect(meReply, &QNetworkReply::finished,
+		this, [this, meReply] {
+			meReply->deleteLater();
+			const int status = meReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+			if (status == 401 || status == 403) {
+				qCInfo(venusGui) << "Cached VRM API login was rejected, logging in again";
+				vrmLoginCacheRejected();
+			} else if (meReply->error() != QNetworkReply::NoError) {
+				// E.g. no network; keep using the cached values.
+				qWarning() << "Unable to validate cached VRM API login:" << meReply->errorString();
+			}
+		});
+}
+
+void BackendConnection::vrmLoginCacheRejected()
+{
+	if (!m_vrmLoginFromCache) {
+		return;
+	}
+	m_vrmLoginFromCache = false;
+	clearVrmLoginCache();
+	setToken(QString());
+	setIdUser(-1);
+	requestVrmLogin();
+}
+
+QString BackendConnection::plainVrmUsername() const
+{
+	return m_username.startsWith(QStringLiteral("vrmlogin_live_"), Qt::CaseInsensitive)
+			? m_username.mid(QStringLiteral("vrmlogin_live_").length())
+			: m_username;
+}
+
 bool BackendConnection::isApplicationVisible() const
 {
 	return m_applicationVisible;
@@ -459,10 +944,156 @@ void BackendConnection::setApplicationVisible(bool v)
 {
 	if (m_applicationVisible != v) {
 		m_applicationVisible = v;
+		if (m_subscriptionManager) {
+			m_subscriptionManager->setBackground(!v);
+		}
+		for (const AdditionalMqttSource &source : std::as_const(m_additionalMqttSources)) {
+			if (source.subscriptionManager) {
+				source.subscriptionManager->setBackground(!v);
+			}
+		}
 		emit applicationVisibleChanged();
 	}
 }
 
+bool BackendConnection::isUpdateCoalescingEnabled() const
+{
+	return m_updateCoalescingEnabled;
+}
+
+void BackendConnection::setUpdateCoalescingEnabled(bool enabled)
+{
+	if (m_producer) {
+		qWarning() << "Update coalescing must be configured before the backend type is set";
+		return;
+	}
+	m_updateCoalescingEnabled = enabled;
+}
+
+qint64 BackendConnection::droppedUpdateCount() const
+{
+	return m_coalescingProducer ? m_coalescingProducer->droppedUpdateCount() : 0;
+}
+
+bool BackendConnection::isDemandDrivenSubscriptionEnabled() const
+{
+	return m_demandDrivenSubscriptionEnabled;
+}
+
+void BackendConnection::setDemandDrivenSubscriptionEnabled(bool enabled)
+{
+	m_demandDrivenSubscriptionEnabled = enabled;
+	if (m_subscriptionManager) {
+		m_subscriptionManager->setDemandDriven(enabled);
+	}
+	for (const AdditionalMqttSource &source : std::as_const(m_additionalMqttSources)) {
+		if (source.subscriptionManager) {
+			source.subscriptionManager->setDemandDriven(enabled);
+		}
+	}
+}
+
+int BackendConnection::dbusInitialFetchConcurrency() const
+{
+	return m_dbusInitialFetchConcurrency;
+}
+
+void BackendConnection::setDBusInitialFetchConcurrency(int concurrency)
+{
+	m_dbusInitialFetchConcurrency = qMax(0, concurrency);
+}
+
+int BackendConnection::mqttMessagesPerMinute() const
+{
+	return m_subscriptionManager ? m_subscriptionManager->messagesPerMinute() : 0;
+}
+
+qint64 BackendConnection::mqttBytesPerMinute() const
+{
+	return m_subscriptionManager ? m_subscriptionManager->bytesPerMinute() : 0;
+}
+
+void BackendConnection::setWindow(QQuickWindow *window)
+{
+	m_window = window;
+	if (m_coalescingProducer) {
+		m_coalescingProducer->setWindow(window);
+	}
+	for (const AdditionalMqttSource &source : m_additionalMqttSources) {
+		if (source.mirror) {
+			source.mirror->setWindow(window);
+		}
+	}
+}
+
+bool BackendConnection::isSnapshotEnabled() const
+{
+	return m_snapshotEnabled;
+}
+
+void BackendConnection::setSnapshotEnabled(bool enabled)
+{
+	m_snapshotEnabled = enabled;
+}
+
+bool BackendConnection::isWarmStarting() const
+{
+	return m_warmStarting;
+}
+
+void BackendConnection::setWarmStarting(bool warmStarting)
+{
+	if (m_warmStarting != warmStarting) {
+		m_warmStarting = warmStarting;
+		emit warmStartingChanged();
+	}
+}
+
+QString BackendConnection::snapshotFileName() const
+{
+#if defined(VENUS_WEBASSEMBLY_BUILD)
+	return QString();
+#else
+	if (!m_snapshotEnabled || (m_type != DBusSource && m_type != MqttSource)) {
+		return QString();
+	}
+	const QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+	if (dir.isEmpty()) {
+		return QString();
+	}
+	// Include the portal id so that snapshots from different MQTT brokers are not mixed up.
+	const QString baseName = m_portalId.isEmpty()
+			? uidPrefix()
+			: QStringLiteral("%1-%2").arg(uidPrefix(), m_portalId.toLower());
+	return QStringLiteral("%1/%2.snapshot").arg(dir, baseName);
+#endif
+}
+
+void BackendConnection::loadSnapshot()
+{
+	const QString fileName = snapshotFileName();
+	if (fileName.isEmpty()) {
+		return;
+	}
+	VeQItem *root = VeQItems::getRoot()->itemGetOrCreate(uidPrefix(), false);
+	if (VeQItemSnapshot::load(root, fileName) > 0 && m_state != Ready) {
+		setWarmStarting(true);
+	}
+}
+
+void BackendConnection::saveSnapshot()
+{
+	// Only save complete trees, and don't save values restored from a previous snapshot that
+	// were never confirmed by the backend (these are not in the Synchronized state anyway).
+	if (m_state != Ready) {
+		return;
+	}
+	const QString fileName = snapshotFileName();
+	if (!fileName.isEmpty()) {
+		VeQItemSnapshot::save(VeQItems::getRoot()->itemGetOrCreate(uidPrefix(), false), fileName);
+	}
+}
+
 QString BackendConnection::serviceUidForType(const QString &serviceType) const
 {
 	// Assumes the specified service has the equivalent of DeviceInstance = 0 on MQTT. That is,
@@ -474,28 +1105,128 @@ QString BackendConnection::serviceUidForType(const QString &serviceType) const
 	//  - MQTT: mqtt/system/0
 	//  - Mock: mock/com.victronenergy.system
 
-	return m_type == MqttSource
-			? QStringLiteral("mqtt/%1/0").arg(serviceType)
-			: QStringLiteral("%1/com.victronenergy.%2").arg(uidPrefix()).arg(serviceType);
+	QString &uid = m_serviceUids[serviceType];
+	if (uid.isEmpty()) {
+		uid = m_type == MqttSource
+				? QStringLiteral("mqtt/%1/0").arg(serviceType)
+				: QStringLiteral("%1/com.victronenergy.%2").arg(uidPrefix()).arg(serviceType);
+	}
+	return uid;
 }
 
 QString BackendConnection::serviceTypeFromUid(const QString &uid) const
 {
-	switch (type()) {
-	case UnknownSource:
-		break;
-	case DBusSource:
-	case MockSource:
-	{
-		// uid format is <dbus|mock>/com.victronenergy.<serviceType>.[suffx]/*
-		const QString serviceTypePart = uid.split('/').value(1);
-		return serviceTypePart.split('.').value(2);
+	// uid format is <dbus|mock>/com.victronenergy.<serviceType>.[suffx]/* or "mqtt/<serviceType>/*"
+	return UidRegistry::create()->serviceTypeFromUid(uid);
+}
+
+QStringList BackendConnection::uidPrefixes() const
+{
+	QStringList prefixes;
+	const QString prefix = uidPrefix();
+	if (!prefix.isEmpty()) {
+		prefixes.append(prefix);
 	}
-	case MqttSource:
-		// uid format is "mqtt/<serviceType>/*"
-		return uid.split('/').value(1);
+	for (const AdditionalMqttSource &source : m_additionalMqttSources) {
+		prefixes.append(source.id);
 	}
-	return QString();
+	return prefixes;
+}
+
+QString BackendConnection::addMqttSource(const QString &address)
+{
+	// While a VRM login is in progress the type is still unknown; the source is connected once the
+	// login sets the MQTT type.
+	if (m_type != UnknownSource && m_type != MqttSource) {
+		qWarning() << "Ignoring additional MQTT source" << address << "as the backend is not MQTT";
+		return QString();
+	}
+	if (m_additionalMqttAddresses.isEmpty()) {
+		qWarning() << "Snapshots and recordings do not include the additional MQTT sources";
+	}
+	m_additionalMqttAddresses.append(address);
+	if (m_type == MqttSource && m_replayFileName.isEmpty()) {
+		connectAdditionalMqttSource(address);
+	}
+	return QStringLiteral("mqtt-%1").arg(QLatin1Char(char('a' + m_additionalMqttAddresses.count())));
+}
+
+void BackendConnection::connectAdditionalMqttSource(const QString &address)
+{
+	AdditionalMqttSource source;
+	source.id = QStringLiteral("mqtt-%1").arg(QLatin1Char(char('b' + m_additionalMqttSources.count())));
+	qWarning() << "Connecting to additional MQTT source" << source.id << "at" << address << "...";
+
+	VeQItemMqttProducer *producer = new VeQItemMqttProducer(VeQItems::getRoot(), sourceProducerId(source.id), "gui-v2");
+	source.producer = producer;
+	if (m_updateCoalescingEnabled) {
+		VeQItem *sourceRoot = VeQItems::getRoot()->itemGetOrCreate(sourceProducerId(source.id), false);
+		source.mirror = new VeQItemCoalescingProducer(VeQItems::getRoot(), source.id, sourceRoot, this);
+		source.mirror->setWindow(m_window);
+	}
+
+	// The GX devices of a site are assumed to share the credentials of the main backend.
+	connect(producer, &VeQItemMqttProducer::aboutToConnect, producer, [this, producer] {
+		if (!m_token.isEmpty()) {
+			producer->setCredentials(m_username, m_token);
+		} else if (!m_username.isEmpty() || !m_password.isEmpty()) {
+			producer->setCredentials(m_username, m_password);
+		}
+		producer->continueConnect();
+	});
+	const QString id = source.id;
+	connect(producer, &VeQItemMqttProducer::connectionStateChanged, this, [this, producer, id] {
+		for (AdditionalMqttSource &s : m_additionalMqttSources) {
+			if (s.id != id) {
+				continue;
+			}
+			// Same as VeQItemMqttProducer::ConnectionState
+			const State previousState = s.state;
+			s.state = State(producer->connectionState());
+			if (s.mirror && previousState == Ready && s.state != Failed) {
+				s.mirror->beginResync();
+			} else if (s.mirror && (s.state == Ready || s.state == Failed)) {
+				s.mirror->endResync();
+			}
+		}
+		emit sourceStatesChanged();
+	});
+
+	source.subscriptionManager = new MqttSubscriptionManager(producer, source.mirror, this);
+	source.subscriptionManager->setDemandDriven(m_demandDrivenSubscriptionEnabled);
+	source.subscriptionManager->setBackground(!m_applicationVisible);
+
+	m_additionalMqttSources.append(source);
+	openMqttProducer(producer, address);
+	emit uidPrefixesChanged();
+}
+
+void BackendConnection::removeAdditionalMqttSources()
+{
+	if (m_additionalMqttSources.isEmpty()) {
+		return;
+	}
+	for (const AdditionalMqttSource &source : std::as_const(m_additionalMqttSources)) {
+		delete source.subscriptionManager;
+		if (source.mirror) {
+			source.mirror->deleteLater();
+		}
+		if (source.producer) {
+			source.producer->deleteLater();
+		}
+	}
+	m_additionalMqttSources.clear();
+	emit sourceStatesChanged();
+}
+
+BackendConnection::State BackendConnection::sourceState(const QString &uidPrefix) const
+{
+	for (const AdditionalMqttSource &source : m_additionalMqttSources) {
+		if (source.id == uidPrefix) {
+			return source.state;
+		}
+	}
+	return uidPrefix == this->uidPrefix() ? m_state : Idle;
 }
 
 QString BackendConnection::uidPrefix() const
@@ -513,6 +1244,38 @@ QString BackendConnection::uidPrefix() const
 	return QString();
 }
 
+void BackendConnection::setMockFleet(const MockFleetConfig &config)
+{
+	m_mockFleet = config;
+}
+
+QString BackendConnection::mockScenario() const
+{
+	return m_mockScenario;
+}
+
+void BackendConnection::setMockScenario(const QString &fileName)
+{
+	if (m_mockScenario != fileName) {
+		m_mockScenario = fileName;
+		emit mockScenarioChanged();
+	}
+}
+
+QVariantMap BackendConnection::mockNetworkConditions() const
+{
+	return m_mockNetworkConditions.toVariantMap();
+}
+
+void BackendConnection::setMockNetworkConditions(const QVariantMap &conditions)
+{
+	m_mockNetworkConditions = MockNetworkConditions::fromVariantMap(conditions);
+	if (VeQItemMockProducer *producer = qobject_cast<VeQItemMockProducer *>(m_producer)) {
+		producer->setNetworkConditions(m_mockNetworkConditions);
+	}
+	emit mockNetworkConditionsChanged();
+}
+
 void BackendConnection::setMockValue(const QString &uid, const QVariant &value)
 {
 	if (VeQItemMockProducer *producer = qobject_cast<VeQItemMockProducer *>(m_producer)) {
@@ -9,15 +9,25 @@
 #include <QObject>
 #include <QQmlEngine>
 #include <QNetworkAccessManager>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QTimer>
 
 #include "veutil/qt/ve_qitems_mqtt.hpp"
+#include "veqitemmockproducer.h"
 
 class VeQItemDbusProducer;
 class AlarmBusitem;
+class QQuickWindow;
 
 namespace Victron {
 namespace VenusOS {
 
+class VeQItemCoalescingProducer;
+class VeQItemRecorder;
+class MqttSubscriptionManager;
+class DBusInitialFetcher;
+
 class BackendConnection : public QObject
 {
 	Q_OBJECT
@@ -29,10 +39,23 @@ class BackendConnection : public QObject
 	Q_PROPERTY(QString username READ username WRITE setUsername NOTIFY usernameChanged)
 	Q_PROPERTY(QString password READ password WRITE setPassword NOTIFY passwordChanged)
 	Q_PROPERTY(QString portalId READ portalId WRITE setPortalId NOTIFY portalIdChanged)
+	Q_PROPERTY(QString siteId READ siteId NOTIFY siteIdChanged)
 	Q_PROPERTY(QString shard READ shard WRITE setShard NOTIFY shardChanged)
 	Q_PROPERTY(QString token READ token WRITE setToken NOTIFY tokenChanged)
 	Q_PROPERTY(int idUser READ idUser WRITE setIdUser NOTIFY idUserChanged)
 	Q_PROPERTY(bool applicationVisible READ isApplicationVisible WRITE setApplicationVisible NOTIFY applicationVisibleChanged)
+	Q_PROPERTY(qint64 droppedUpdateCount READ droppedUpdateCount NOTIFY droppedUpdateCountChanged)
+	Q_PROPERTY(bool warmStarting READ isWarmStarting NOTIFY warmStartingChanged)
+	Q_PROPERTY(int mqttMessagesPerMinute READ mqttMessagesPerMinute NOTIFY mqttTrafficChanged)
+	Q_PROPERTY(qint64 mqttBytesPerMinute READ mqttBytesPerMinute NOTIFY mqttTrafficChanged)
+	Q_PROPERTY(qint64 timeToReady READ timeToReady NOTIFY connectionMetricsChanged)
+	Q_PROPERTY(QVariantMap stateDurations READ stateDurations NOTIFY connectionMetricsChanged)
+	Q_PROPERTY(int reconnectCount READ reconnectCount NOTIFY connectionMetricsChanged)
+	Q_PROPERTY(qint64 lastReconnectDuration READ lastReconnectDuration NOTIFY connectionMetricsChanged)
+	Q_PROPERTY(qint64 totalReconnectDuration READ totalReconnectDuration NOTIFY connectionMetricsChanged)
+	Q_PROPERTY(QStringList uidPrefixes READ uidPrefixes NOTIFY uidPrefixesChanged)
+	Q_PROPERTY(QString mockScenario READ mockScenario NOTIFY mockScenarioChanged)
+	Q_PROPERTY(QVariantMap mockNetworkConditions READ mockNetworkConditions WRITE setMockNetworkConditions NOTIFY mockNetworkConditionsChanged)
 
 public:
 	enum SourceType {
@@ -89,6 +112,11 @@ public:
 	QString portalId() const;
 	void setPortalId(const QString &portalId);
 
+	// Identifies the backend type and the site it connects to (the portal id, or else the
+	// address), e.g. "mqtt-c0619ab4a585" or "dbus-tcp_host_localhost_port_3000", so that caches
+	// of different sites are kept apart. Empty until the backend type is set.
+	QString siteId() const;
+
 	QString shard() const;
 	void setShard(const QString &shard);
 
@@ -98,16 +126,95 @@ public:
 	int idUser() const;
 	void setIdUser(int id);
 
+	// Logs in to the VRM API and connects to the MQTT broker of the installation. The token and
+	// broker are cached on disk, so the next login connects immediately with the cached values,
+	// and only logs in again if the VRM API or broker rejects them.
 	void loginVrmApi();
 	void requestShardFromVrmApi();
+	void setVrmApiUrl(const QString &url);
 
 	bool isApplicationVisible() const;
 	void setApplicationVisible(bool v);
 
+	// When enabled (the default), MQTT and D-Bus value updates are coalesced and applied once per frame.
+	bool isUpdateCoalescingEnabled() const;
+	void setUpdateCoalescingEnabled(bool enabled);
+	qint64 droppedUpdateCount() const;
+
+	void setWindow(QQuickWindow *window);
+
+	// Connection lifecycle metrics, in milliseconds, measured with a monotonic clock since the
+	// last call to setType(). timeToReady is -1 until the connection first becomes Ready.
+	// stateDurations maps each state name to the total time spent in that state, including the
+	// time spent so far in the current state. A reconnect is counted when the connection becomes
+	// Ready again after leaving the Ready state, and lasts from leaving Ready until then.
+	qint64 timeToReady() const;
+	QVariantMap stateDurations() const;
+	int reconnectCount() const;
+	qint64 lastReconnectDuration() const;
+	qint64 totalReconnectDuration() const;
+
+	// When enabled (the default), the last-known item values are saved to disk, and restored on
+	// the next start so that pages can be shown before the backend is Ready.
+	bool isSnapshotEnabled() const;
+	void setSnapshotEnabled(bool enabled);
+	bool isWarmStarting() const;
+
+	// When enabled, MQTT topics are only subscribed while they are used by the UI. This is the
+	// default in WebAssembly builds, where all traffic goes through the VRM websocket.
+	bool isDemandDrivenSubscriptionEnabled() const;
+	void setDemandDrivenSubscriptionEnabled(bool enabled);
+
+	// When greater than zero, the D-Bus backend fetches the initial values of all services with up
+	// to this many concurrent calls, and only becomes Ready once they have been received.
+	int dbusInitialFetchConcurrency() const;
+	void setDBusInitialFetchConcurrency(int concurrency);
+
+	// The MQTT traffic received during the last complete minute.
+	int mqttMessagesPerMinute() const;
+	qint64 mqttBytesPerMinute() const;
+
+	// Records all value changes from the MQTT or D-Bus backend to the file, once the type is set.
+	void setRecordFileName(const QString &fileName);
+
+	// Generates a fleet of mock services when the mock backend is used, for scale testing.
+	void setMockFleet(const MockFleetConfig &config);
+
+	// Plays the scenario file when the mock backend is used. See MockScenario for the format.
+	QString mockScenario() const;
+	void setMockScenario(const QString &fileName);
+
+	// Simulates a slow or unreliable link when the mock backend is used, e.g.
+	// { "latency": 300, "jitter": 100, "drop": 0.05, "burst": 2000 }. See MockNetworkConditions.
+	QVariantMap mockNetworkConditions() const;
+	void setMockNetworkConditions(const QVariantMap &conditions);
+
+	// Plays back a recording made with setRecordFileName() instead of connecting to a backend.
+	// A speed of 0 plays the recording as fast as possible.
+	bool startReplay(const QString &fileName, qreal speed = 1.0);
+
 	Q_INVOKABLE QString serviceUidForType(const QString &serviceType) const;
 	Q_INVOKABLE QString serviceTypeFromUid(const QString &uid) const;
 	Q_INVOKABLE QString uidPrefix() const;
 
+	// The uid prefixes of all connected GX devices: the prefix of the backend, followed by the
+	// prefix of each additional MQTT source.
+	QStringList uidPrefixes() const;
+
+	// Connects to the MQTT broker of another GX device, whose items are added under a separate
+	// prefix ("mqtt-b", "mqtt-c", ...) so that device models can merge the devices of all GX
+	// devices. Returns the prefix, or an empty string if the backend is not MQTT.
+	//
+	// Only the MQTT data sources read uidPrefixes(), so extra sources are rejected for D-Bus and
+	// mock backends. The extra sources are disconnected whenever the backend type changes, and
+	// connected again when it changes back to MQTT. Each one gets its own subscription manager,
+	// so demand-driven subscriptions and the background pause apply to it; snapshots and
+	// recordings only cover the main GX device.
+	QString addMqttSource(const QString &address);
+
+	// Returns the connection state of the GX device with the given uid prefix.
+	Q_INVOKABLE BackendConnection::State sourceState(const QString &uidPrefix) const;
+
 	// Move this to some mock data manager when available
 	Q_INVOKABLE void setMockValue(const QString &uid, const QVariant &value);
 	Q_INVOKABLE QVariant mockValue(const QString &uid) const;
@@ -119,10 +226,19 @@ Q_SIGNALS:
 	void usernameChanged();
 	void passwordChanged();
 	void portalIdChanged();
+	void siteIdChanged();
 	void shardChanged();
 	void tokenChanged();
 	void idUserChanged();
 	void applicationVisibleChanged();
+	void droppedUpdateCountChanged();
+	void warmStartingChanged();
+	void mqttTrafficChanged();
+	void connectionMetricsChanged();
+	void uidPrefixesChanged();
+	void sourceStatesChanged();
+	void mockScenarioChanged();
+	void mockNetworkConditionsChanged();
 
 private:
 	explicit BackendConnection(QObject *parent = nullptr);
@@ -136,27 +252,93 @@ private:
 	void initDBusConnection(const QString &address);
 #endif
 	void initMqttConnection(const QString &address);
+	void openMqttProducer(VeQItemMqttProducer *producer, const QString &address);
+	void connectAdditionalMqttSource(const QString &address);
+	void removeAdditionalMqttSources();
 	void initMockConnection();
+	void initReplayConnection(const QString &id);
+	void startRecording(const QString &id);
+	QString sourceProducerId(const QString &id) const;
+	void initCoalescingProducer(const QString &id);
+	QString snapshotFileName() const;
+	void loadSnapshot();
+	void saveSnapshot();
+	void setWarmStarting(bool warmStarting);
+	void resetConnectionMetrics();
+	void updateConnectionMetrics(State previousState);
+	void requestVrmLogin();
+	void connectToVrmWebhost(const QString &webhost);
+	QString vrmLoginCacheFileName() const;
+	bool loadVrmLoginCache(QString *webhost);
+	void saveVrmLoginCache(const QString &webhost);
+	void clearVrmLoginCache();
+	void validateVrmLoginCache();
+	void vrmLoginCacheRejected();
+	QString plainVrmUsername() const;
 
 	QString m_username;
 	QString m_password;
 	QString m_portalId;
+	QString m_address;
 
 	QString m_shard;
 	QString m_token;
 	int m_idUser = -1;
+	QString m_vrmApiUrl = QStringLiteral("https://vrmapi.victronenergy.com");
+	bool m_vrmLoginFromCache = false;
 
 	bool m_applicationVisible = true;
+	bool m_updateCoalescingEnabled = true;
+	bool m_snapshotEnabled = true;
+	bool m_warmStarting = false;
+#if defined(VENUS_WEBASSEMBLY_BUILD)
+	bool m_demandDrivenSubscriptionEnabled = true;
+#else
+	bool m_demandDrivenSubscriptionEnabled = false;
+#endif
+	int m_dbusInitialFetchConcurrency = 0;
+
+	QString m_recordFileName;
+	QString m_replayFileName;
+	qreal m_replaySpeed = 1.0;
+	MockFleetConfig m_mockFleet;
+	MockNetworkConditions m_mockNetworkConditions;
+	QString m_mockScenario;
+	mutable QHash<QString, QString> m_serviceUids;
 
 	State m_state = BackendConnection::State::Idle;
+	QElapsedTimer m_connectionTimer;
+	qint64 m_stateEnteredMsecs = 0;
+	qint64 m_stateDurations[Failed + 1] = {};
+	qint64 m_timeToReady = -1;
+	qint64 m_reconnectStartMsecs = -1;
+	qint64 m_lastReconnectDuration = 0;
+	qint64 m_totalReconnectDuration = 0;
+	int m_reconnectCount = 0;
 	SourceType m_type = UnknownSource;
 	QMqttClient::ClientError m_mqttClientError = QMqttClient::NoError;
 
 	VeQItemProducer *m_producer = nullptr;
+	VeQItemCoalescingProducer *m_coalescingProducer = nullptr;
+	VeQItemRecorder *m_recorder = nullptr;
+	MqttSubscriptionManager *m_subscriptionManager = nullptr;
+	QPointer<QQuickWindow> m_window;
+	QTimer m_snapshotTimer;
 #if !defined(VENUS_WEBASSEMBLY_BUILD)
 	AlarmBusitem *m_alarmBusItem = nullptr;
+	DBusInitialFetcher *m_dbusInitialFetcher = nullptr;
 #endif
 	QNetworkAccessManager *m_network = nullptr;
+
+	struct AdditionalMqttSource {
+		QString id;
+		QPointer<VeQItemMqttProducer> producer;
+		QPointer<VeQItemCoalescingProducer> mirror;
+		QPointer<MqttSubscriptionManager> subscriptionManager;
+		State state = Idle;
+	};
+	QStringList m_additionalMqttAddresses;
+	QVector<AdditionalMqttSource> m_additionalMqttSources;
 };
 
 }
@@ -6,6 +6,10 @@
 #include "basedevicemodel.h"
 
 #include <QQmlInfo>
+#include <QSet>
+
+#include <algorithm>
+#include <iterator>
 
 using namespace Victron::VenusOS;
 
@@ -125,31 +129,75 @@ QHash<int, QByteArray> BaseDeviceModel::roleNames() const
 
 bool BaseDeviceModel::addDevice(BaseDevice *device)
 {
-	if (!device) {
-		qmlInfo(this) << "cannot add device, invalid device!";
-		return false;
+	return addDevices(QList<BaseDevice *>({ device })) == 1;
+}
+
+int BaseDeviceModel::addDevices(const QVariantList &devices)
+{
+	QList<BaseDevice *> deviceList;
+	deviceList.reserve(devices.count());
+	for (const QVariant &device : devices) {
+		deviceList.append(qobject_cast<BaseDevice *>(device.value<QObject *>()));
 	}
-	if (device->serviceUid().length() == 0) {
-		qmlInfo(this) << "cannot add device, no serviceUid!";
-		return false;
+	return addDevices(deviceList);
+}
+
+int BaseDeviceModel::addDevices(const QList<BaseDevice *> &devices)
+{
+	QList<BaseDevice *> newDevices;
+	QSet<QString> newServiceUids;
+	for (BaseDevice *device : devices) {
+		if (!canAddDevice(device)) {
+			continue;
+		}
+		if (newServiceUids.contains(device->serviceUid())) {
+			qmlInfo(this) << "model not adding device, already contains: " << device->serviceUid();
+			continue;
+		}
+		newServiceUids.insert(device->serviceUid());
+		newDevices.append(device);
 	}
-	if (device->deviceInstance() < 0) {
-		qmlInfo(this) << "model not adding device, invalid device instance for: " << device->serviceUid();
-		return false;
+	if (newDevices.isEmpty()) {
+		return 0;
 	}
-	if (indexOf(device->serviceUid()) >= 0) {
-		qmlInfo(this) << "model not adding device, already contains: " << device->serviceUid();
-		return false;
+
+	std::stable_sort(newDevices.begin(), newDevices.end(), [](const BaseDevice *a, const BaseDevice *b) {
+		return a->deviceInstance() < b->deviceInstance();
+	});
+
+	// Group the devices by their insertion index in the current list; devices added in order of
+	// deviceInstance, or after all existing devices, form a single group.
+	QVector<QPair<int, QList<BaseDevice *> > > groups;
+	for (BaseDevice *device : newDevices) {
+		const int index = insertionIndex(device);
+		if (groups.isEmpty() || groups.constLast().first != index) {
+			groups.append({ index, QList<BaseDevice *>() });
+		}
+		groups.last().second.append(device);
+	}
+
+	// Insert the last group first, so that the insertion indexes of the other groups stay valid.
+	for (auto it = groups.crbegin(); it != groups.crend(); ++it) {
+		const int index = it->first;
+		const QList<BaseDevice *> &group = it->second;
+		emit beginInsertRows(QModelIndex(), index, index + group.count() - 1);
+		m_devices.insert(index, group.count(), nullptr);
+		for (int i = 0; i < group.count(); ++i) {
+			m_devices[index + i] = group.at(i);
+		}
+		emit endInsertRows();
 	}
 
-	const int index = insertionIndex(device);
-	emit beginInsertRows(QModelIndex(), index, index);
-	m_devices.insert(index, device);
-	emit endInsertRows();
+	for (BaseDevice *device : newDevices) {
+		connect(device, &BaseDevice::serviceUidChanged, this, &BaseDeviceModel::rebuildIndexes, Qt::UniqueConnection);
+		connect(device, &BaseDevice::deviceInstanceChanged, this, &BaseDeviceModel::rebuildIndexes, Qt::UniqueConnection);
+		connect(device, &QObject::destroyed, this, &BaseDeviceModel::rebuildIndexes, Qt::UniqueConnection);
+	}
+	updateIndexes(groups.constFirst().first);
 	emit countChanged();
 	refreshFirstObject();
 
-	return true;
+	return newDevices.count();
 }
 
 bool BaseDeviceModel::removeDevice(const QString &serviceUid)
@@ -157,8 +205,15 @@ bool BaseDeviceModel::removeDevice(const QString &serviceUid)
 	const int index = indexOf(serviceUid);
 	if (index >= 0) {
 		emit beginRemoveRows(QModelIndex(), index, index);
+		BaseDevice *device = m_devices.at(index);
+		device->disconnect(this);
 		m_devices.removeAt(index);
 		emit endRemoveRows();
+		m_serviceUidRows.remove(serviceUid);
+		if (m_deviceInstanceRows.value(device->deviceInstance(), -1) == index) {
+			m_deviceInstanceRows.remove(device->deviceInstance());
+		}
+		updateIndexes(index);
 		emit countChanged();
 		refreshFirstObject();
 		return true;
@@ -173,29 +228,28 @@ void BaseDeviceModel::clear()
 		return;
 	}
 	emit beginResetModel();
+	for (BaseDevice *device : std::as_const(m_devices)) {
+		if (device) {
+			device->disconnect(this);
+		}
+	}
 	m_devices.clear();
+	m_serviceUidRows.clear();
+	m_deviceInstanceRows.clear();
 	emit endResetModel();
 	emit countChanged();
 }
 
 int BaseDeviceModel::indexOf(const QString &serviceUid) const
 {
-	for (int i = 0; i < m_devices.count(); ++i) {
-		if (m_devices[i] && m_devices[i]->serviceUid() == serviceUid) {
-			return i;
-		}
-	}
-	return -1;
+	const int row = m_serviceUidRows.value(serviceUid, -1);
+	return row >= 0 && m_devices.at(row) ? row : -1;
 }
 
 BaseDevice *BaseDeviceModel::deviceForDeviceInstance(int deviceInstance) const
 {
-	for (BaseDevice *device : m_devices) {
-		if (device && device->deviceInstance() == deviceInstance) {
-			return device;
-		}
-	}
-	return nullptr;
+	const int row = m_deviceInstanceRows.value(deviceInstance, -1);
+	return row >= 0 ? m_devices.at(row).data() : nullptr;
 }
 
 BaseDevice *BaseDeviceModel::deviceAt(int index) const
@@ -206,6 +260,27 @@ BaseDevice *BaseDeviceModel::deviceAt(int index) const
 	return m_devices.at(index);
 }
 
+bool BaseDeviceModel::canAddDevice(const BaseDevice *device) const
+{
+	if (!device) {
+		qmlInfo(this) << "cannot add device, invalid device!";
+		return false;
+	}
+	if (device->serviceUid().length() == 0) {
+		qmlInfo(this) << "cannot add device, no serviceUid!";
+		return false;
+	}
+	if (device->deviceInstance() < 0) {
+		qmlInfo(this) << "model not adding device, invalid device instance for: " << device->serviceUid();
+		return false;
+	}
+	if (indexOf(device->serviceUid()) >= 0) {
+		qmlInfo(this) << "model not adding device, already contains: " << device->serviceUid();
+		return false;
+	}
+	return true;
+}
+
 int BaseDeviceModel::insertionIndex(const BaseDevice *newDevice) const
 {
 	if (newDevice->deviceInstance() < 0) {
@@ -214,13 +289,39 @@ int BaseDeviceModel::insertionIndex(const BaseDevice *newDevice) const
 	}
 
 	// Sort device list from lowest to highest deviceInstance.
-	for (int i = 0; i < m_devices.count(); ++i) {
-		BaseDevice *device = m_devices[i];
-		if (device && device->deviceInstance() >= 0 && newDevice->deviceInstance() < device->deviceInstance()) {
-			return i;
+	const auto it = std::upper_bound(m_devices.cbegin(), m_devices.cend(), newDevice->deviceInstance(),
+			[](int deviceInstance, const QPointer<BaseDevice> &device) {
+		return device && device->deviceInstance() >= 0 && deviceInstance < device->deviceInstance();
+	});
+	return static_cast<int>(std::distance(m_devices.cbegin(), it));
+}
+
+void BaseDeviceModel::updateIndexes(int fromRow)
+{
+	// Rows before fromRow are unchanged, so only the entries of later rows need updating.
+	for (int i = fromRow; i < m_devices.count(); ++i) {
+		const BaseDevice *device = m_devices.at(i);
+		if (device && m_deviceInstanceRows.value(device->deviceInstance(), -1) >= fromRow) {
+			m_deviceInstanceRows.remove(device->deviceInstance());
 		}
 	}
-	return static_cast<int>(m_devices.count());
+	for (int i = fromRow; i < m_devices.count(); ++i) {
+		const BaseDevice *device = m_devices.at(i);
+		if (!device) {
+			continue;
+		}
+		m_serviceUidRows.insert(device->serviceUid(), i);
+		if (!m_deviceInstanceRows.contains(device->deviceInstance())) {
+			m_deviceInstanceRows.insert(device->deviceInstance(), i);
+		}
+	}
+}
+
+void BaseDeviceModel::rebuildIndexes()
+{
+	m_serviceUidRows.clear();
+	m_deviceInstanceRows.clear();
+	updateIndexes(0);
 }
 
 void BaseDeviceModel::refreshFirstObject()
@@ -9,6 +9,7 @@
 #include <QObject>
 #include <QPointer>
 #include <QAbstractListModel>
+#include <QHash>
 #include <qqmlintegration.h>
 
 namespace Victron {
@@ -78,6 +79,11 @@ public:
 
 	Q_INVOKABLE bool addDevice(BaseDevice *device);
 	Q_INVOKABLE bool removeDevice(const QString &serviceUid);
+
+	// Adds the devices with as few row insertions as possible, and emits countChanged() and
+	// firstObjectChanged() once. Returns the number of devices that were added.
+	Q_INVOKABLE int addDevices(const QVariantList &devices);
+	int addDevices(const QList<BaseDevice *> &devices);
 	Q_INVOKABLE void clear();
 
 	Q_INVOKABLE int indexOf(const QString &serviceUid) const;
@@ -93,11 +99,20 @@ protected:
 	QHash<int, QByteArray> roleNames() const override;
 
 private:
+	bool canAddDevice(const BaseDevice *device) const;
 	int insertionIndex(const BaseDevice *device) const;
 	void refreshFirstObject();
+	void updateIndexes(int fromRow);
+	void rebuildIndexes();
 
 	QHash<int, QByteArray> m_roleNames;
-	QVector<QPointer<BaseDevice> > m_devices;
+	QVector<QPointer<BaseDevice> > m_devices;   // ordered by deviceInstance
+
+	// Rows by serviceUid, and the first row of each deviceInstance. Rebuilt if a device in the
+	// model changes its serviceUid or deviceInstance.
+	QHash<QString, int> m_serviceUidRows;
+	QHash<int, int> m_deviceInstanceRows;
+
 	QPointer<BaseDevice> m_firstObject;
 	QString m_modelId;
 };
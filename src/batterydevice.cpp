@@ -0,0 +1,32 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include "batterydevice.h"
+
+#include <cstddef>
+#include <iterator>
+
+namespace Victron {
+
+namespace VenusOS {
+
+const ServiceDevice::Field BatteryDevice::Fields[] = {
+	{ "/Soc", RealField, offsetof(Values, stateOfCharge), static_cast<Notifier>(&BatteryDevice::stateOfChargeChanged) },
+	{ "/Dc/0/Voltage", RealField, offsetof(Values, voltage), static_cast<Notifier>(&BatteryDevice::voltageChanged) },
+	{ "/Dc/0/Power", RealField, offsetof(Values, power), static_cast<Notifier>(&BatteryDevice::powerChanged) },
+	{ "/Dc/0/Current", RealField, offsetof(Values, current), static_cast<Notifier>(&BatteryDevice::currentChanged) },
+	{ "/Dc/0/Temperature", RealField, offsetof(Values, temperature), static_cast<Notifier>(&BatteryDevice::temperatureChanged) },
+	{ "/TimeToGo", RealField, offsetof(Values, timeToGo), static_cast<Notifier>(&BatteryDevice::timeToGoChanged) },
+};
+
+BatteryDevice::BatteryDevice(QObject *parent)
+	: ServiceDevice(parent)
+{
+	addFields(Fields, static_cast<int>(std::size(Fields)), &m_values);
+}
+
+} /* VenusOS */
+
+} /* Victron */
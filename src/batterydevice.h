@@ -0,0 +1,68 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_BATTERYDEVICE_H
+#define VICTRON_VENUSOS_GUI_V2_BATTERYDEVICE_H
+
+#include "servicedevice.h"
+
+#include <QtCore/QtNumeric>
+
+namespace Victron {
+
+namespace VenusOS {
+
+/*
+  The values of a com.victronenergy.battery service, as used by Battery.qml.
+*/
+class BatteryDevice : public ServiceDevice
+{
+	Q_OBJECT
+	QML_ELEMENT
+	Q_PROPERTY(qreal stateOfCharge READ stateOfCharge NOTIFY stateOfChargeChanged)
+	Q_PROPERTY(qreal voltage READ voltage NOTIFY voltageChanged)
+	Q_PROPERTY(qreal power READ power NOTIFY powerChanged)
+	Q_PROPERTY(qreal current READ current NOTIFY currentChanged)
+	Q_PROPERTY(qreal temperature READ temperature NOTIFY temperatureChanged)
+	Q_PROPERTY(qreal timeToGo READ timeToGo NOTIFY timeToGoChanged)
+
+public:
+	explicit BatteryDevice(QObject *parent = nullptr);
+
+	qreal stateOfCharge() const { return m_values.stateOfCharge; }
+	qreal voltage() const { return m_values.voltage; }
+	qreal power() const { return m_values.power; }
+	qreal current() const { return m_values.current; }
+	qreal temperature() const { return m_values.temperature; }
+	qreal timeToGo() const { return m_values.timeToGo; }    // in seconds
+
+Q_SIGNALS:
+	void stateOfChargeChanged();
+	void voltageChanged();
+	void powerChanged();
+	void currentChanged();
+	void temperatureChanged();
+	void timeToGoChanged();
+
+private:
+	struct Values {
+		qreal stateOfCharge = qQNaN();
+		qreal voltage = qQNaN();
+		qreal power = qQNaN();
+		qreal current = qQNaN();
+		qreal temperature = qQNaN();
+		qreal timeToGo = qQNaN();
+	};
+
+	static const Field Fields[];
+
+	Values m_values;
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_BATTERYDEVICE_H
@@ -0,0 +1,72 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_DBUSDEMARSHALL_H
+#define VICTRON_VENUSOS_GUI_V2_DBUSDEMARSHALL_H
+
+#include <QtCore/QVariant>
+#include <QtDBus/QDBusArgument>
+#include <QtDBus/QDBusVariant>
+
+namespace Victron {
+
+namespace VenusOS {
+
+inline QVariant demarshallDBusValue(const QVariant &value);
+
+// Converts a D-Bus argument to plain QVariant types, e.g. a{sv} to a QVariantMap.
+inline QVariant demarshallDBusArgument(const QDBusArgument &argument)
+{
+	switch (argument.currentType()) {
+	case QDBusArgument::ArrayType:
+	{
+		QVariantList list;
+		argument.beginArray();
+		while (!argument.atEnd()) {
+			list.append(demarshallDBusValue(argument.asVariant()));
+		}
+		argument.endArray();
+		return list;
+	}
+	case QDBusArgument::MapType:
+	{
+		QVariantMap map;
+		argument.beginMap();
+		while (!argument.atEnd()) {
+			argument.beginMapEntry();
+			const QString key = argument.asVariant().toString();
+			map.insert(key, demarshallDBusValue(argument.asVariant()));
+			argument.endMapEntry();
+		}
+		argument.endMap();
+		return map;
+	}
+	default:
+		return argument.asVariant();
+	}
+}
+
+inline QVariant demarshallDBusValue(const QVariant &value)
+{
+	if (value.userType() == qMetaTypeId<QDBusVariant>()) {
+		return demarshallDBusValue(value.value<QDBusVariant>().variant());
+	}
+	if (value.userType() == qMetaTypeId<QDBusArgument>()) {
+		return demarshallDBusArgument(value.value<QDBusArgument>());
+	}
+	return value;
+}
+
+// Returns the value of a com.victronenergy.BusItem, which sends invalid values as an empty array.
+inline QVariant busItemValue(const QVariant &value)
+{
+	return value.userType() == QMetaType::QVariantList && value.toList().isEmpty() ? QVariant() : value;
+}
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_DBUSDEMARSHALL_H
@@ -0,0 +1,169 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include "dbusinitialfetcher.h"
+#include "dbusdemarshall.h"
+#include "logging.h"
+
+#include "veutil/qt/ve_qitem.hpp"
+
+#include <QtDBus/QDBusMessage>
+#include <QtDBus/QDBusPendingCallWatcher>
+#include <QtDBus/QDBusPendingReply>
+
+namespace Victron {
+
+namespace VenusOS {
+
+namespace {
+
+const QLatin1String ServicePrefix("com.victronenergy.");
+const QLatin1String BusItemInterface("com.victronenergy.BusItem");
+const QLatin1String GetItemsMethod("GetItems");
+const QLatin1String GetValueMethod("GetValue");
+const QLatin1String DBusService("org.freedesktop.DBus");
+const QLatin1String DBusPath("/org/freedesktop/DBus");
+
+// A service that does not reply in time is left to the producer.
+const int CallTimeout = 5000;
+
+}
+
+DBusInitialFetcher::DBusInitialFetcher(const QDBusConnection &connection, VeQItem *producerRoot, int maxInFlight, QObject *parent)
+	: QObject(parent)
+	, m_connection(connection)
+	, m_producerRoot(producerRoot)
+	, m_maxInFlight(qMax(1, maxInFlight))
+{
+}
+
+void DBusInitialFetcher::start()
+{
+	m_timer.start();
+	m_connection.connect(DBusService, DBusPath, DBusService, QStringLiteral("NameOwnerChanged"),
+			this, SLOT(nameOwnerChanged(QString,QString,QString)));
+	const QDBusMessage message = QDBusMessage::createMethodCall(DBusService, DBusPath, DBusService, QStringLiteral("ListNames"));
+	QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(m_connection.asyncCall(message, CallTimeout), this);
+	connect(watcher, &QDBusPendingCallWatcher::finished, this, &DBusInitialFetcher::namesReceived);
+}
+
+int DBusInitialFetcher::serviceCount() const
+{
+	return m_serviceCount;
+}
+
+int DBusInitialFetcher::valueCount() const
+{
+	return m_valueCount;
+}
+
+void DBusInitialFetcher::namesReceived(QDBusPendingCallWatcher *watcher)
+{
+	watcher->deleteLater();
+	m_namesReceived = true;
+
+	const QDBusPendingReply<QStringList> reply = *watcher;
+	if (reply.isError()) {
+		qCWarning(venusGui) << "D-Bus initial fetch: unable to list services:" << reply.error().message();
+	} else {
+		for (const QString &name : reply.value()) {
+			if (name.startsWith(ServicePrefix)) {
+				m_pendingServices.append(name);
+			}
+		}
+	}
+	m_serviceCount = m_pendingServices.count();
+	fetchNext();
+	finishIfDone();
+}
+
+void DBusInitialFetcher::nameOwnerChanged(const QString &name, const QString &oldOwner, const QString &newOwner)
+{
+	// A service that appears while ListNames is pending is in its reply as well.
+	if (!m_namesReceived || !name.startsWith(ServicePrefix) || !oldOwner.isEmpty() || newOwner.isEmpty()) {
+		return;
+	}
+	m_pendingServices.append(name);
+	m_serviceCount++;
+	fetchNext();
+}
+
+void DBusInitialFetcher::fetchNext()
+{
+	while (m_inFlight < m_maxInFlight && !m_pendingServices.isEmpty()) {
+		fetchService(m_pendingServices.takeFirst(), GetItemsMethod);
+	}
+}
+
+void DBusInitialFetcher::fetchService(const QString &service, const QString &method)
+{
+	const QDBusMessage message = QDBusMessage::createMethodCall(service, QStringLiteral("/"), BusItemInterface, method);
+	QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(m_connection.asyncCall(message, CallTimeout), this);
+	connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, service, method](QDBusPendingCallWatcher *watcher) {
+		serviceReceived(watcher, service, method);
+	});
+	m_inFlight++;
+}
+
+void DBusInitialFetcher::serviceReceived(QDBusPendingCallWatcher *watcher, const QString &service, const QString &method)
+{
+	watcher->deleteLater();
+	m_inFlight--;
+
+	const QDBusMessage reply = watcher->reply();
+	if (reply.type() == QDBusMessage::ErrorMessage || reply.arguments().isEmpty()) {
+		if (method == GetItemsMethod && reply.errorName() == QLatin1String("org.freedesktop.DBus.Error.UnknownMethod")) {
+			// Older services only support GetValue.
+			fetchService(service, GetValueMethod);
+		} else {
+			qCDebug(venusGui) << "D-Bus initial fetch:" << method << "failed for" << service << reply.errorMessage();
+			m_failedCount++;
+			fetchNext();
+			finishIfDone();
+		}
+		return;
+	}
+
+	// GetItems returns a{sa{sv}}, with a "Value" and "Text" for each path, and GetValue on the
+	// root returns a{sv} with the value of each path.
+	const QVariantMap items = demarshallDBusValue(reply.arguments().constFirst()).toMap();
+	for (auto it = items.constBegin(); it != items.constEnd(); ++it) {
+		const QVariant value = method == GetItemsMethod
+				? it.value().toMap().value(QStringLiteral("Value"))
+				: it.value();
+		produceValue(service, it.key(), value);
+	}
+
+	fetchNext();
+	finishIfDone();
+}
+
+void DBusInitialFetcher::produceValue(const QString &service, const QString &path, const QVariant &value)
+{
+	if (!m_producerRoot) {
+		return;
+	}
+	const QString relativePath = path.startsWith(QLatin1Char('/')) ? path.mid(1) : path;
+	VeQItem *item = m_producerRoot->itemGetOrCreate(service + QLatin1Char('/') + relativePath, true, true);
+
+	item->produceValue(busItemValue(value), VeQItem::Synchronized);
+	m_valueCount++;
+}
+
+void DBusInitialFetcher::finishIfDone()
+{
+	if (m_finished || !m_namesReceived || m_inFlight > 0 || !m_pendingServices.isEmpty()) {
+		return;
+	}
+	m_finished = true;
+	qCInfo(venusGui) << "D-Bus initial fetch:" << m_valueCount << "values from" << m_serviceCount
+			<< "services in" << m_timer.elapsed() << "ms with up to" << m_maxInFlight << "calls in flight,"
+			<< m_failedCount << "services failed";
+	emit finished();
+}
+
+} /* VenusOS */
+
+} /* Victron */
@@ -0,0 +1,81 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_DBUSINITIALFETCHER_H
+#define VICTRON_VENUSOS_GUI_V2_DBUSINITIALFETCHER_H
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtCore/QStringList>
+#include <QtDBus/QDBusConnection>
+
+class QDBusPendingCallWatcher;
+class VeQItem;
+
+namespace Victron {
+
+namespace VenusOS {
+
+/*
+  Fetches the initial values of all com.victronenergy.* services on a D-Bus connection, and
+  produces them in the tree of a D-Bus producer.
+
+  The services are listed with a single ListNames call, then GetItems is called on the root of
+  each service, with up to maxInFlight calls pending at a time. Services that do not implement
+  GetItems are asked for GetValue on their root instead, which returns the values of all paths.
+  finished() is emitted when every service has replied or failed, so that the backend can report
+  that it is Ready only once the initial values are in the tree.
+
+  The producer must be created without its own initial walk of new services (the
+  bulkInitOfNewService argument of VeQItemDbusProducer), otherwise every service is fetched twice.
+  Services that appear later are fetched here too, with GetItems, so they are not left to
+  per-path GetValue calls. The producer still discovers the services and monitors their values as
+  usual.
+*/
+class DBusInitialFetcher : public QObject
+{
+	Q_OBJECT
+
+public:
+	DBusInitialFetcher(const QDBusConnection &connection, VeQItem *producerRoot, int maxInFlight, QObject *parent = nullptr);
+
+	void start();
+
+	int serviceCount() const;
+	int valueCount() const;
+
+Q_SIGNALS:
+	void finished();
+
+private Q_SLOTS:
+	void nameOwnerChanged(const QString &name, const QString &oldOwner, const QString &newOwner);
+
+private:
+	void namesReceived(QDBusPendingCallWatcher *watcher);
+	void fetchNext();
+	void fetchService(const QString &service, const QString &method);
+	void serviceReceived(QDBusPendingCallWatcher *watcher, const QString &service, const QString &method);
+	void produceValue(const QString &service, const QString &path, const QVariant &value);
+	void finishIfDone();
+
+	QDBusConnection m_connection;
+	QPointer<VeQItem> m_producerRoot;
+	QStringList m_pendingServices;
+	QElapsedTimer m_timer;
+	int m_maxInFlight = 1;
+	int m_inFlight = 0;
+	int m_serviceCount = 0;
+	int m_failedCount = 0;
+	int m_valueCount = 0;
+	bool m_namesReceived = false;
+	bool m_finished = false;
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_DBUSINITIALFETCHER_H
@@ -0,0 +1,306 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include "deviceaggregate.h"
+
+#include <QtQml/QQmlInfo>
+#include <QtCore/QtMath>
+
+namespace Victron {
+
+namespace VenusOS {
+
+namespace {
+
+// The number of incremental updates before the sum is recalculated from the device values.
+const int SumRecalculationInterval = 1000;
+
+bool realChanged(qreal a, qreal b)
+{
+	return qIsNaN(a) ? !qIsNaN(b) : (qIsNaN(b) || a != b);
+}
+
+}
+
+DeviceAggregate::DeviceAggregate(QObject *parent)
+	: QObject(parent)
+	, m_deviceValueChangedSlot(staticMetaObject.method(staticMetaObject.indexOfSlot("deviceValueChanged()")))
+{
+}
+
+QAbstractItemModel *DeviceAggregate::model() const
+{
+	return m_model.data();
+}
+
+void DeviceAggregate::setModel(QAbstractItemModel *model)
+{
+	if (m_model == model) {
+		return;
+	}
+	if (m_model) {
+		m_model->disconnect(this);
+	}
+	m_model = model;
+	m_deviceRole = model ? model->roleNames().key(QByteArrayLiteral("device"), -1) : -1;
+	if (model) {
+		if (m_deviceRole < 0) {
+			qmlInfo(this) << "model has no 'device' role";
+		}
+		connect(model, &QAbstractItemModel::rowsInserted, this, &DeviceAggregate::modelRowsInserted);
+		connect(model, &QAbstractItemModel::rowsAboutToBeRemoved, this, &DeviceAggregate::modelRowsAboutToBeRemoved);
+		connect(model, &QAbstractItemModel::modelReset, this, &DeviceAggregate::rebuild);
+		connect(model, &QAbstractItemModel::destroyed, this, &DeviceAggregate::rebuild);
+	}
+	emit modelChanged();
+	rebuild();
+}
+
+QString DeviceAggregate::propertyName() const
+{
+	return m_propertyName;
+}
+
+void DeviceAggregate::setPropertyName(const QString &propertyName)
+{
+	if (m_propertyName != propertyName) {
+		m_propertyName = propertyName;
+		m_propertyNameData = propertyName.toUtf8();
+		emit propertyNameChanged();
+		rebuild();
+	}
+}
+
+qreal DeviceAggregate::sum() const
+{
+	return m_valueCounts.isEmpty() ? qQNaN() : m_sum;
+}
+
+qreal DeviceAggregate::minimum() const
+{
+	return m_valueCounts.isEmpty() ? qQNaN() : m_valueCounts.firstKey();
+}
+
+qreal DeviceAggregate::maximum() const
+{
+	return m_valueCounts.isEmpty() ? qQNaN() : m_valueCounts.lastKey();
+}
+
+qreal DeviceAggregate::average() const
+{
+	return m_validCount == 0 ? qQNaN() : m_sum / m_validCount;
+}
+
+int DeviceAggregate::count() const
+{
+	return m_validCount;
+}
+
+void DeviceAggregate::componentComplete()
+{
+	ParserStatus::componentComplete();
+	rebuild();
+}
+
+BaseDevice *DeviceAggregate::deviceAt(int row) const
+{
+	return m_model && m_deviceRole >= 0
+			? m_model->data(m_model->index(row, 0), m_deviceRole).value<BaseDevice *>()
+			: nullptr;
+}
+
+qreal DeviceAggregate::deviceValue(BaseDevice *device) const
+{
+	bool ok = false;
+	const qreal value = device->property(m_propertyNameData.constData()).toReal(&ok);
+	return ok ? value : qQNaN();
+}
+
+void DeviceAggregate::addValue(qreal value)
+{
+	if (!qIsNaN(value)) {
+		m_valueCounts[value]++;
+		m_sum += value;
+		m_validCount++;
+	}
+}
+
+void DeviceAggregate::removeValue(qreal value)
+{
+	if (qIsNaN(value)) {
+		return;
+	}
+	auto it = m_valueCounts.find(value);
+	if (it != m_valueCounts.end() && --it.value() == 0) {
+		m_valueCounts.erase(it);
+	}
+	m_sum -= value;
+	m_validCount--;
+	if (m_valueCounts.isEmpty()) {
+		m_sum = 0;
+	}
+}
+
+void DeviceAggregate::addDevice(BaseDevice *device)
+{
+	if (!device || m_values.contains(device)) {
+		return;
+	}
+	const QMetaObject *metaObject = device->metaObject();
+	const int propertyIndex = metaObject->indexOfProperty(m_propertyNameData.constData());
+	if (propertyIndex < 0) {
+		qmlInfo(this) << "device " << device->serviceUid() << " has no property: " << m_propertyName;
+		return;
+	}
+	const QMetaMethod notifySignal = metaObject->property(propertyIndex).notifySignal();
+	if (notifySignal.isValid()) {
+		connect(device, notifySignal, this, m_deviceValueChangedSlot);
+	}
+	connect(device, &QObject::destroyed, this, &DeviceAggregate::deviceDestroyed);
+
+	const qreal value = deviceValue(device);
+	m_values.insert(device, value);
+	addValue(value);
+}
+
+void DeviceAggregate::removeDevice(BaseDevice *device)
+{
+	const auto it = m_values.constFind(device);
+	if (it == m_values.constEnd()) {
+		return;
+	}
+	device->disconnect(this);
+	removeValue(it.value());
+	m_values.erase(it);
+}
+
+void DeviceAggregate::deviceDestroyed(QObject *object)
+{
+	// The device cannot be used any more, but its last value is known.
+	const auto it = m_values.constFind(object);
+	if (it != m_values.constEnd()) {
+		const Totals prevTotals = totals();
+		removeValue(it.value());
+		m_values.erase(it);
+		emitChanges(prevTotals);
+	}
+}
+
+void DeviceAggregate::deviceValueChanged()
+{
+	BaseDevice *device = qobject_cast<BaseDevice *>(sender());
+	const auto it = m_values.find(device);
+	if (it == m_values.end()) {
+		return;
+	}
+	const qreal value = deviceValue(device);
+	if (!realChanged(it.value(), value)) {
+		return;
+	}
+
+	const Totals prevTotals = totals();
+	removeValue(it.value());
+	addValue(value);
+	it.value() = value;
+
+	if (++m_updatesSinceSum >= SumRecalculationInterval) {
+		m_updatesSinceSum = 0;
+		m_sum = 0;
+		for (const qreal lastValue : std::as_const(m_values)) {
+			if (!qIsNaN(lastValue)) {
+				m_sum += lastValue;
+			}
+		}
+	}
+	emitChanges(prevTotals);
+}
+
+void DeviceAggregate::modelRowsInserted(const QModelIndex &, int first, int last)
+{
+	if (!isComponentComplete() || m_propertyName.isEmpty()) {
+		return;
+	}
+	const Totals prevTotals = totals();
+	for (int i = first; i <= last; ++i) {
+		addDevice(deviceAt(i));
+	}
+	emitChanges(prevTotals);
+}
+
+void DeviceAggregate::modelRowsAboutToBeRemoved(const QModelIndex &, int first, int last)
+{
+	if (!isComponentComplete() || m_propertyName.isEmpty()) {
+		return;
+	}
+	const Totals prevTotals = totals();
+	for (int i = first; i <= last; ++i) {
+		removeDevice(deviceAt(i));
+	}
+	emitChanges(prevTotals);
+}
+
+void DeviceAggregate::clear()
+{
+	for (auto it = m_values.constBegin(); it != m_values.constEnd(); ++it) {
+		it.key()->disconnect(this);
+	}
+	m_values.clear();
+	m_valueCounts.clear();
+	m_sum = 0;
+	m_validCount = 0;
+	m_updatesSinceSum = 0;
+}
+
+void DeviceAggregate::rebuild()
+{
+	if (!isComponentComplete()) {
+		return;
+	}
+
+	const Totals prevTotals = totals();
+	clear();
+	if (m_model && !m_propertyName.isEmpty()) {
+		const int rowCount = m_model->rowCount();
+		m_values.reserve(rowCount);
+		for (int i = 0; i < rowCount; ++i) {
+			addDevice(deviceAt(i));
+		}
+	}
+	emitChanges(prevTotals);
+}
+
+DeviceAggregate::Totals DeviceAggregate::totals() const
+{
+	Totals result;
+	result.sum = sum();
+	result.minimum = minimum();
+	result.maximum = maximum();
+	result.count = count();
+	return result;
+}
+
+void DeviceAggregate::emitChanges(const Totals &prevTotals)
+{
+	const Totals newTotals = totals();
+	if (realChanged(prevTotals.sum, newTotals.sum)) {
+		emit sumChanged();
+	}
+	if (realChanged(prevTotals.minimum, newTotals.minimum)) {
+		emit minimumChanged();
+	}
+	if (realChanged(prevTotals.maximum, newTotals.maximum)) {
+		emit maximumChanged();
+	}
+	if (prevTotals.count != newTotals.count) {
+		emit countChanged();
+	}
+	if (prevTotals.count != newTotals.count || realChanged(prevTotals.sum, newTotals.sum)) {
+		emit averageChanged();
+	}
+}
+
+} /* VenusOS */
+
+} /* Victron */
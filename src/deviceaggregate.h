@@ -0,0 +1,121 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_DEVICEAGGREGATE_H
+#define VICTRON_VENUSOS_GUI_V2_DEVICEAGGREGATE_H
+
+#include <QtCore/QAbstractItemModel>
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QMetaMethod>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtQml/qqmlintegration.h>
+
+#include "basedevicemodel.h"
+#include "parserstatus.h"
+
+namespace Victron {
+
+namespace VenusOS {
+
+/*
+  Keeps the sum, minimum, maximum, count and average of a real property of the devices in a model
+  (a BaseDeviceModel, or any model with a "device" role such as FilteredDeviceModel). For example:
+
+      DeviceAggregate {
+          model: Global.dcInputs.model
+          propertyName: "power"
+      }
+
+  NaN values are ignored, as in Units.sumRealNumbers(): the sum is NaN if no device has a valid
+  value, and count is the number of devices with a valid value.
+
+  The last value of each device is kept, so a value change only replaces that device's share of
+  the sum, and its entry in an ordered map of values for the minimum and maximum. That is O(log N)
+  per change rather than a pass over all devices. The sum is recalculated from the kept values now
+  and then, so that rounding errors do not build up.
+*/
+class DeviceAggregate : public QObject, public ParserStatus
+{
+	Q_OBJECT
+	QML_ELEMENT
+	Q_INTERFACES(QQmlParserStatus)
+	Q_PROPERTY(QAbstractItemModel *model READ model WRITE setModel NOTIFY modelChanged)
+	Q_PROPERTY(QString propertyName READ propertyName WRITE setPropertyName NOTIFY propertyNameChanged)
+	Q_PROPERTY(qreal sum READ sum NOTIFY sumChanged)
+	Q_PROPERTY(qreal minimum READ minimum NOTIFY minimumChanged)
+	Q_PROPERTY(qreal maximum READ maximum NOTIFY maximumChanged)
+	Q_PROPERTY(qreal average READ average NOTIFY averageChanged)
+	Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+	explicit DeviceAggregate(QObject *parent = nullptr);
+
+	QAbstractItemModel *model() const;
+	void setModel(QAbstractItemModel *model);
+
+	QString propertyName() const;
+	void setPropertyName(const QString &propertyName);
+
+	qreal sum() const;
+	qreal minimum() const;
+	qreal maximum() const;
+	qreal average() const;
+	int count() const;
+
+	void componentComplete() override;
+
+Q_SIGNALS:
+	void modelChanged();
+	void propertyNameChanged();
+	void sumChanged();
+	void minimumChanged();
+	void maximumChanged();
+	void averageChanged();
+	void countChanged();
+
+private Q_SLOTS:
+	void deviceValueChanged();
+
+private:
+	struct Totals {
+		qreal sum = qQNaN();
+		qreal minimum = qQNaN();
+		qreal maximum = qQNaN();
+		int count = 0;
+	};
+
+	BaseDevice *deviceAt(int row) const;
+	qreal deviceValue(BaseDevice *device) const;
+	void addDevice(BaseDevice *device);
+	void removeDevice(BaseDevice *device);
+	void addValue(qreal value);
+	void removeValue(qreal value);
+	void deviceDestroyed(QObject *object);
+	void modelRowsInserted(const QModelIndex &parent, int first, int last);
+	void modelRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+	void rebuild();
+	void clear();
+	Totals totals() const;
+	void emitChanges(const Totals &prevTotals);
+
+	QPointer<QAbstractItemModel> m_model;
+	QString m_propertyName;
+	QByteArray m_propertyNameData;
+	QMetaMethod m_deviceValueChangedSlot;
+	QHash<QObject *, qreal> m_values;   // the last value of each device in the model
+	QMap<qreal, int> m_valueCounts;     // the number of devices with each valid value
+	qreal m_sum = 0;                    // the sum of the valid values
+	int m_validCount = 0;               // the number of valid values
+	int m_deviceRole = -1;
+	int m_updatesSinceSum = 0;
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_DEVICEAGGREGATE_H
@@ -0,0 +1,451 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include "filtereddevicemodel.h"
+#include "sortedlist.h"
+#include "uidregistry.h"
+
+#include <QtQml/QQmlInfo>
+#include <QtCore/QtMath>
+
+#include <algorithm>
+
+namespace Victron {
+
+namespace VenusOS {
+
+namespace {
+
+// Invalid values, and NaN values of real properties, are sorted after all valid values.
+bool isSortable(const QVariant &value)
+{
+	if (!value.isValid() || value.isNull()) {
+		return false;
+	}
+	const int typeId = value.typeId();
+	if (typeId == QMetaType::Double || typeId == QMetaType::Float) {
+		return !qIsNaN(value.toDouble());
+	}
+	return true;
+}
+
+}
+
+FilteredDeviceModel::FilteredDeviceModel(QObject *parent)
+	: QAbstractListModel(parent)
+	, m_devicePropertyChangedSlot(staticMetaObject.method(staticMetaObject.indexOfSlot("devicePropertyChanged()")))
+{
+	m_roleNames[DeviceRole] = "device";
+
+	// The rows of the devices are no longer known once rows are inserted, removed or moved.
+	const auto clearRowByDevice = [this]() { m_rowByDevice.clear(); };
+	connect(this, &FilteredDeviceModel::rowsInserted, this, clearRowByDevice);
+	connect(this, &FilteredDeviceModel::rowsRemoved, this, clearRowByDevice);
+	connect(this, &FilteredDeviceModel::rowsMoved, this, clearRowByDevice);
+	connect(this, &FilteredDeviceModel::modelReset, this, clearRowByDevice);
+}
+
+int FilteredDeviceModel::count() const
+{
+	return static_cast<int>(m_devices.count());
+}
+
+BaseDevice *FilteredDeviceModel::firstObject() const
+{
+	return m_devices.isEmpty() ? nullptr : m_devices.constFirst().data();
+}
+
+BaseDeviceModel *FilteredDeviceModel::sourceModel() const
+{
+	return m_sourceModel.data();
+}
+
+void FilteredDeviceModel::setSourceModel(BaseDeviceModel *sourceModel)
+{
+	if (m_sourceModel == sourceModel) {
+		return;
+	}
+	if (m_sourceModel) {
+		m_sourceModel->disconnect(this);
+	}
+	m_sourceModel = sourceModel;
+	if (sourceModel) {
+		connect(sourceModel, &BaseDeviceModel::rowsInserted, this, &FilteredDeviceModel::sourceModelRowsInserted);
+		connect(sourceModel, &BaseDeviceModel::rowsAboutToBeRemoved, this, &FilteredDeviceModel::sourceModelRowsAboutToBeRemoved);
+		connect(sourceModel, &BaseDeviceModel::modelReset, this, &FilteredDeviceModel::rebuild);
+		connect(sourceModel, &BaseDeviceModel::destroyed, this, &FilteredDeviceModel::rebuild);
+	}
+	emit sourceModelChanged();
+	rebuild();
+}
+
+QStringList FilteredDeviceModel::serviceTypes() const
+{
+	return m_serviceTypes;
+}
+
+void FilteredDeviceModel::setServiceTypes(const QStringList &serviceTypes)
+{
+	if (m_serviceTypes != serviceTypes) {
+		m_serviceTypes = serviceTypes;
+		emit serviceTypesChanged();
+		rebuild();
+	}
+}
+
+QString FilteredDeviceModel::filterProperty() const
+{
+	return m_filterProperty;
+}
+
+void FilteredDeviceModel::setFilterProperty(const QString &filterProperty)
+{
+	if (m_filterProperty != filterProperty) {
+		m_filterProperty = filterProperty;
+		m_filterPropertyName = filterProperty.toUtf8();
+		emit filterPropertyChanged();
+		rebuild();
+	}
+}
+
+QVariantList FilteredDeviceModel::filterValues() const
+{
+	return m_filterValues;
+}
+
+void FilteredDeviceModel::setFilterValues(const QVariantList &filterValues)
+{
+	if (m_filterValues != filterValues) {
+		m_filterValues = filterValues;
+		emit filterValuesChanged();
+		rebuild();
+	}
+}
+
+QString FilteredDeviceModel::sortProperty() const
+{
+	return m_sortProperty;
+}
+
+void FilteredDeviceModel::setSortProperty(const QString &sortProperty)
+{
+	if (m_sortProperty != sortProperty) {
+		m_sortProperty = sortProperty;
+		m_sortPropertyName = sortProperty.toUtf8();
+		emit sortPropertyChanged();
+		rebuild();
+	}
+}
+
+Qt::SortOrder FilteredDeviceModel::sortOrder() const
+{
+	return m_sortOrder;
+}
+
+void FilteredDeviceModel::setSortOrder(Qt::SortOrder sortOrder)
+{
+	if (m_sortOrder != sortOrder) {
+		m_sortOrder = sortOrder;
+		emit sortOrderChanged();
+		rebuild();
+	}
+}
+
+int FilteredDeviceModel::rowCount(const QModelIndex &) const
+{
+	return count();
+}
+
+QVariant FilteredDeviceModel::data(const QModelIndex &index, int role) const
+{
+	const int row = index.row();
+
+	if (row < 0 || row >= m_devices.count()) {
+		return QVariant();
+	}
+	switch (role)
+	{
+	case DeviceRole:
+		return QVariant::fromValue<BaseDevice*>(m_devices.at(row).data());
+	default:
+		return QVariant();
+	}
+}
+
+QHash<int, QByteArray> FilteredDeviceModel::roleNames() const
+{
+	return m_roleNames;
+}
+
+BaseDevice *FilteredDeviceModel::deviceAt(int index) const
+{
+	if (index < 0 || index >= m_devices.count()) {
+		return nullptr;
+	}
+	return m_devices.at(index).data();
+}
+
+int FilteredDeviceModel::indexOf(const QString &serviceUid) const
+{
+	for (int i = 0; i < m_devices.count(); ++i) {
+		if (m_devices.at(i) && m_devices.at(i)->serviceUid() == serviceUid) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+QString FilteredDeviceModel::serviceType(const QString &serviceUid)
+{
+	return UidRegistry::create()->serviceTypeFromUid(serviceUid);
+}
+
+void FilteredDeviceModel::componentComplete()
+{
+	// Build the model once, rather than once for each property that was set.
+	ParserStatus::componentComplete();
+	rebuild();
+}
+
+bool FilteredDeviceModel::filterAcceptsDevice(BaseDevice *device) const
+{
+	if (!m_serviceTypes.isEmpty() && !m_serviceTypes.contains(serviceType(device->serviceUid()))) {
+		return false;
+	}
+	if (!m_filterPropertyName.isEmpty() && !m_filterValues.contains(device->property(m_filterPropertyName.constData()))) {
+		return false;
+	}
+	return true;
+}
+
+bool FilteredDeviceModel::lessThan(BaseDevice *a, BaseDevice *b) const
+{
+	if (!m_sortPropertyName.isEmpty()) {
+		const QVariant aValue = a->property(m_sortPropertyName.constData());
+		const QVariant bValue = b->property(m_sortPropertyName.constData());
+		const bool aSortable = isSortable(aValue);
+		if (aSortable != isSortable(bValue)) {
+			return aSortable;
+		}
+		if (aSortable) {
+			int order = 0;
+			if (aValue.typeId() == QMetaType::QString && bValue.typeId() == QMetaType::QString) {
+				order = QString::localeAwareCompare(aValue.toString(), bValue.toString());
+			} else {
+				const QPartialOrdering ordering = QVariant::compare(aValue, bValue);
+				order = ordering == QPartialOrdering::Less ? -1 : ordering == QPartialOrdering::Greater ? 1 : 0;
+			}
+			if (order != 0) {
+				return m_sortOrder == Qt::AscendingOrder ? order < 0 : order > 0;
+			}
+		}
+	}
+
+	// Otherwise, keep the order of the source model.
+	return m_sourceModel && m_sourceModel->indexOf(a->serviceUid()) < m_sourceModel->indexOf(b->serviceUid());
+}
+
+int FilteredDeviceModel::insertionIndex(BaseDevice *device, int from, int to) const
+{
+	const auto it = std::upper_bound(m_devices.cbegin() + from, m_devices.cbegin() + to, device,
+			[this](BaseDevice *key, const QPointer<BaseDevice> &other) {
+		return other && lessThan(key, other.data());
+	});
+	return static_cast<int>(std::distance(m_devices.cbegin(), it));
+}
+
+void FilteredDeviceModel::insertDevice(BaseDevice *device)
+{
+	const int index = insertionIndex(device, 0, count());
+	beginInsertRows(QModelIndex(), index, index);
+	m_devices.insert(index, device);
+	endInsertRows();
+}
+
+void FilteredDeviceModel::removeDeviceAt(int index)
+{
+	beginRemoveRows(QModelIndex(), index, index);
+	m_devices.removeAt(index);
+	endRemoveRows();
+}
+
+int FilteredDeviceModel::rowOf(const BaseDevice *device) const
+{
+	if (m_rowByDevice.isEmpty() && !m_devices.isEmpty()) {
+		m_rowByDevice.reserve(m_devices.count());
+		for (int i = 0; i < count(); ++i) {
+			m_rowByDevice.insert(m_devices.at(i).data(), i);
+		}
+	}
+	return m_rowByDevice.value(device, -1);
+}
+
+void FilteredDeviceModel::moveToSortedIndex(int fromIndex)
+{
+	const int toIndex = sortedMoveIndex(m_devices, fromIndex, [this](const QPointer<BaseDevice> &a, const QPointer<BaseDevice> &b) {
+		return a && b && lessThan(a.data(), b.data());
+	});
+	if (fromIndex != toIndex) {
+		beginMoveRows(QModelIndex(), fromIndex, fromIndex, QModelIndex(), toIndex > fromIndex ? toIndex + 1 : toIndex);
+		m_devices.move(fromIndex, toIndex);
+		endMoveRows();
+	}
+}
+
+void FilteredDeviceModel::connectDevice(BaseDevice *device)
+{
+	connect(device, &BaseDevice::serviceUidChanged, this, &FilteredDeviceModel::devicePropertyChanged, Qt::UniqueConnection);
+	connectNotifySignal(device, m_filterProperty);
+	connectNotifySignal(device, m_sortProperty);
+	m_connectedDevices.insert(device, device);
+}
+
+void FilteredDeviceModel::connectNotifySignal(BaseDevice *device, const QString &propertyName)
+{
+	if (propertyName.isEmpty()) {
+		return;
+	}
+	const QMetaObject *metaObject = device->metaObject();
+	const int propertyIndex = metaObject->indexOfProperty(propertyName.toUtf8().constData());
+	if (propertyIndex < 0) {
+		qmlInfo(this) << "device " << device->serviceUid() << " has no property: " << propertyName;
+		return;
+	}
+	const QMetaMethod notifySignal = metaObject->property(propertyIndex).notifySignal();
+	if (notifySignal.isValid()) {
+		connect(device, notifySignal, this, m_devicePropertyChangedSlot, Qt::UniqueConnection);
+	}
+}
+
+void FilteredDeviceModel::disconnectDevices()
+{
+	for (const QPointer<BaseDevice> &device : std::as_const(m_connectedDevices)) {
+		if (device) {
+			device->disconnect(this);
+		}
+	}
+	m_connectedDevices.clear();
+}
+
+void FilteredDeviceModel::rebuild()
+{
+	if (!isComponentComplete()) {
+		return;
+	}
+
+	const int prevCount = count();
+	BaseDevice *prevFirstObject = firstObject();
+
+	beginResetModel();
+	disconnectDevices();
+	m_devices.clear();
+	if (m_sourceModel) {
+		for (int i = 0; i < m_sourceModel->count(); ++i) {
+			BaseDevice *device = m_sourceModel->deviceAt(i);
+			if (!device) {
+				continue;
+			}
+			connectDevice(device);
+			if (filterAcceptsDevice(device)) {
+				m_devices.append(device);
+			}
+		}
+		// Sort once rather than inserting each device at its position.
+		std::stable_sort(m_devices.begin(), m_devices.end(), [this](const QPointer<BaseDevice> &a, const QPointer<BaseDevice> &b) {
+			return lessThan(a.data(), b.data());
+		});
+	}
+	endResetModel();
+
+	emitChanges(prevCount, prevFirstObject);
+}
+
+void FilteredDeviceModel::sourceModelRowsInserted(const QModelIndex &, int first, int last)
+{
+	if (!isComponentComplete()) {
+		return;
+	}
+
+	const int prevCount = count();
+	BaseDevice *prevFirstObject = firstObject();
+
+	for (int i = first; i <= last; ++i) {
+		BaseDevice *device = m_sourceModel->deviceAt(i);
+		if (!device) {
+			continue;
+		}
+		connectDevice(device);
+		if (filterAcceptsDevice(device)) {
+			insertDevice(device);
+		}
+	}
+
+	emitChanges(prevCount, prevFirstObject);
+}
+
+void FilteredDeviceModel::sourceModelRowsAboutToBeRemoved(const QModelIndex &, int first, int last)
+{
+	if (!isComponentComplete()) {
+		return;
+	}
+
+	const int prevCount = count();
+	BaseDevice *prevFirstObject = firstObject();
+
+	for (int i = first; i <= last; ++i) {
+		BaseDevice *device = m_sourceModel->deviceAt(i);
+		if (!device) {
+			continue;
+		}
+		device->disconnect(this);
+		m_connectedDevices.remove(device);
+		const int index = rowOf(device);
+		if (index >= 0) {
+			removeDeviceAt(index);
+		}
+	}
+
+	emitChanges(prevCount, prevFirstObject);
+}
+
+void FilteredDeviceModel::devicePropertyChanged()
+{
+	BaseDevice *device = qobject_cast<BaseDevice *>(sender());
+	if (!device) {
+		return;
+	}
+
+	const int prevCount = count();
+	BaseDevice *prevFirstObject = firstObject();
+
+	// Only this device needs to be checked: add or remove it, or move it to its new position.
+	const int index = rowOf(device);
+	const bool accepted = filterAcceptsDevice(device);
+	if (index < 0) {
+		if (accepted) {
+			insertDevice(device);
+		}
+	} else if (!accepted) {
+		removeDeviceAt(index);
+	} else {
+		moveToSortedIndex(index);
+	}
+
+	emitChanges(prevCount, prevFirstObject);
+}
+
+void FilteredDeviceModel::emitChanges(int prevCount, BaseDevice *prevFirstObject)
+{
+	if (prevCount != count()) {
+		emit countChanged();
+	}
+	if (prevFirstObject != firstObject()) {
+		emit firstObjectChanged();
+	}
+}
+
+} /* VenusOS */
+
+} /* Victron */
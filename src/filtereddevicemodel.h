@@ -0,0 +1,154 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_FILTEREDDEVICEMODEL_H
+#define VICTRON_VENUSOS_GUI_V2_FILTEREDDEVICEMODEL_H
+
+#include <QtCore/QAbstractListModel>
+#include <QtCore/QMetaMethod>
+#include <QtCore/QPointer>
+#include <QtQml/qqmlintegration.h>
+
+#include "basedevicemodel.h"
+#include "parserstatus.h"
+
+namespace Victron {
+
+namespace VenusOS {
+
+/*
+  A filtered and sorted view of the devices in a BaseDeviceModel, for use in place of JavaScript
+  loops over deviceAt(). For example, to list the EV chargers that are charging, by name:
+
+      FilteredDeviceModel {
+          sourceModel: Global.evChargers.model
+          filterProperty: "status"
+          filterValues: [ VenusOS.Evcs_Status_Charging ]
+          sortProperty: "name"
+      }
+
+  A device is accepted if the service type of its serviceUid (e.g. "battery" for
+  "dbus/com.victronenergy.battery.ttyUSB0") is in serviceTypes, and the value of its filterProperty
+  is in filterValues. An empty serviceTypes or filterProperty accepts all devices.
+
+  The devices are sorted by the value of sortProperty, or kept in the order of the source model if
+  sortProperty is not set. Devices without a valid value are sorted last.
+
+  The model is updated one row at a time as devices are added to or removed from the source model,
+  and when the filter or sort property of a device changes. The row of a changed device is found
+  in a hash of the row of each device, and its new row by a binary search, so a change does not
+  compare the device with all others. The hash is built when a row is first looked up, and is
+  cleared when rows are inserted, removed or moved, so it is rebuilt once after each such change.
+
+  The filter only tests whether the value of one property is in a list of values. Models that
+  need other filters, or that combine several properties, still need their own code.
+*/
+class FilteredDeviceModel : public QAbstractListModel, public ParserStatus
+{
+	Q_OBJECT
+	QML_ELEMENT
+	Q_INTERFACES(QQmlParserStatus)
+	Q_PROPERTY(int count READ count NOTIFY countChanged)
+	Q_PROPERTY(BaseDevice *firstObject READ firstObject NOTIFY firstObjectChanged)
+	Q_PROPERTY(BaseDeviceModel *sourceModel READ sourceModel WRITE setSourceModel NOTIFY sourceModelChanged)
+	Q_PROPERTY(QStringList serviceTypes READ serviceTypes WRITE setServiceTypes NOTIFY serviceTypesChanged)
+	Q_PROPERTY(QString filterProperty READ filterProperty WRITE setFilterProperty NOTIFY filterPropertyChanged)
+	Q_PROPERTY(QVariantList filterValues READ filterValues WRITE setFilterValues NOTIFY filterValuesChanged)
+	Q_PROPERTY(QString sortProperty READ sortProperty WRITE setSortProperty NOTIFY sortPropertyChanged)
+	Q_PROPERTY(Qt::SortOrder sortOrder READ sortOrder WRITE setSortOrder NOTIFY sortOrderChanged)
+
+public:
+	enum RoleNames {
+		DeviceRole = Qt::UserRole
+	};
+
+	explicit FilteredDeviceModel(QObject *parent = nullptr);
+
+	int count() const;
+	BaseDevice *firstObject() const;
+
+	BaseDeviceModel *sourceModel() const;
+	void setSourceModel(BaseDeviceModel *sourceModel);
+
+	QStringList serviceTypes() const;
+	void setServiceTypes(const QStringList &serviceTypes);
+
+	QString filterProperty() const;
+	void setFilterProperty(const QString &filterProperty);
+
+	QVariantList filterValues() const;
+	void setFilterValues(const QVariantList &filterValues);
+
+	QString sortProperty() const;
+	void setSortProperty(const QString &sortProperty);
+
+	Qt::SortOrder sortOrder() const;
+	void setSortOrder(Qt::SortOrder sortOrder);
+
+	int rowCount(const QModelIndex &parent) const override;
+	QVariant data(const QModelIndex& index, int role) const override;
+
+	Q_INVOKABLE BaseDevice *deviceAt(int index) const;
+	Q_INVOKABLE int indexOf(const QString &serviceUid) const;
+
+	// Returns the service type of a serviceUid, e.g. "battery" for
+	// "dbus/com.victronenergy.battery.ttyUSB0", "mqtt/battery/512" or "mqtt-b/battery/512", as
+	// parsed by UidRegistry.
+	Q_INVOKABLE static QString serviceType(const QString &serviceUid);
+
+	void componentComplete() override;
+
+Q_SIGNALS:
+	void countChanged();
+	void firstObjectChanged();
+	void sourceModelChanged();
+	void serviceTypesChanged();
+	void filterPropertyChanged();
+	void filterValuesChanged();
+	void sortPropertyChanged();
+	void sortOrderChanged();
+
+protected:
+	QHash<int, QByteArray> roleNames() const override;
+
+private Q_SLOTS:
+	void devicePropertyChanged();
+
+private:
+	bool filterAcceptsDevice(BaseDevice *device) const;
+	bool lessThan(BaseDevice *a, BaseDevice *b) const;
+	int insertionIndex(BaseDevice *device, int from, int to) const;
+	void insertDevice(BaseDevice *device);
+	void removeDeviceAt(int index);
+	int rowOf(const BaseDevice *device) const;
+	void moveToSortedIndex(int fromIndex);
+	void connectDevice(BaseDevice *device);
+	void connectNotifySignal(BaseDevice *device, const QString &propertyName);
+	void sourceModelRowsInserted(const QModelIndex &parent, int first, int last);
+	void sourceModelRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+	void rebuild();
+	void disconnectDevices();
+	void emitChanges(int prevCount, BaseDevice *prevFirstObject);
+
+	QHash<int, QByteArray> m_roleNames;
+	QVector<QPointer<BaseDevice> > m_devices;   // the accepted devices, in sorted order
+	mutable QHash<const BaseDevice *, int> m_rowByDevice;   // built by rowOf(), cleared when rows change
+	QHash<const BaseDevice *, QPointer<BaseDevice> > m_connectedDevices;   // all devices of the source model
+	QPointer<BaseDeviceModel> m_sourceModel;
+	QStringList m_serviceTypes;
+	QString m_filterProperty;
+	QByteArray m_filterPropertyName;
+	QVariantList m_filterValues;
+	QString m_sortProperty;
+	QByteArray m_sortPropertyName;
+	QMetaMethod m_devicePropertyChangedSlot;
+	Qt::SortOrder m_sortOrder = Qt::AscendingOrder;
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_FILTEREDDEVICEMODEL_H
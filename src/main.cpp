@@ -22,8 +22,11 @@
 #include <QQmlEngine>
 #include <QQuickWindow>
 #include <QCommandLineParser>
+#include <QElapsedTimer>
 #include <QStyleHints>
 
+#include <memory>
+
 #include <QtDebug>
 
 Q_LOGGING_CATEGORY(venusGui, "venus.gui")
@@ -102,6 +105,11 @@ void initBackend(bool *enableFpsCounter, bool *skipSplashScreen)
 		QGuiApplication::tr("Use D-Bus data source: connect to the default D-Bus address"));
 	parser.addOption(dbusDefault);
 
+	QCommandLineOption dbusInitialFetch("dbus-initial-fetch",
+		QGuiApplication::tr("Fetch the initial values of all D-Bus services with up to this many concurrent calls, before reporting that the backend is Ready"),
+		QGuiApplication::tr("calls", "Number of concurrent D-Bus calls"));
+	parser.addOption(dbusInitialFetch);
+
 	// If the MQTT Address is provided, then it's a local LAN MQTT broker (e.g. the CerboGX address).
 	QCommandLineOption mqttAddress({ "m", "mqtt" },
 		QGuiApplication::tr("Use MQTT data source: connect to the specified MQTT broker address."),
@@ -134,6 +142,16 @@ void initBackend(bool *enableFpsCounter, bool *skipSplashScreen)
 		QGuiApplication::tr("token", "MQTT broker auth token."));
 	parser.addOption(mqttToken);
 
+	QCommandLineOption mqttExtra("mqtt-extra",
+		QGuiApplication::tr("Also connect to the MQTT broker of another GX device at this address; can be given more than once"),
+		QGuiApplication::tr("address", "MQTT broker address"));
+	parser.addOption(mqttExtra);
+
+	QCommandLineOption vrmApi("vrm-api",
+		QGuiApplication::tr("VRM API base URL, used with --shard vrm (default: https://vrmapi.victronenergy.com)"),
+		QGuiApplication::tr("url", "VRM API URL"));
+	parser.addOption(vrmApi);
+
 	QCommandLineOption fpsCounter({ "f", "fpsCounter" },
 		QGuiApplication::tr("Enable FPS counter"));
 	parser.addOption(fpsCounter);
@@ -146,8 +164,88 @@ void initBackend(bool *enableFpsCounter, bool *skipSplashScreen)
 		QGuiApplication::tr("Use mock data source for testing."));
 	parser.addOption(mockMode);
 
+	QCommandLineOption mockFleet("mock-fleet",
+		QGuiApplication::tr("With --mock, generate a fleet of services, e.g. solarcharger=40,battery=20,tank=16"),
+		QGuiApplication::tr("services", "Service type counts"));
+	parser.addOption(mockFleet);
+
+	QCommandLineOption mockFleetRate("mock-fleet-rate",
+		QGuiApplication::tr("Updates per second for each value of the --mock-fleet services (default: 1)"),
+		QGuiApplication::tr("rate", "Update rate"), QStringLiteral("1"));
+	parser.addOption(mockFleetRate);
+
+	QCommandLineOption mockSeed("mock-seed",
+		QGuiApplication::tr("Random seed for the --mock-fleet values (default: 1)"),
+		QGuiApplication::tr("seed", "Random seed"), QStringLiteral("1"));
+	parser.addOption(mockSeed);
+
+	QCommandLineOption mockScenario("mock-scenario",
+		QGuiApplication::tr("With --mock, play the scenario file, e.g. data/mock/scenarios/battery-drain.json, instead of the QML mock timers"),
+		QGuiApplication::tr("file", "Scenario file"));
+	parser.addOption(mockScenario);
+
+	QCommandLineOption mockNetwork("mock-network",
+		QGuiApplication::tr("With --mock, simulate a slow link to the GX device, e.g. latency=300,jitter=100,drop=0.05,burst=2000 (milliseconds, drop rate 0-1)"),
+		QGuiApplication::tr("conditions", "Network conditions"));
+	parser.addOption(mockNetwork);
+
+	QCommandLineOption noUpdateCoalescing("no-update-coalescing",
+		QGuiApplication::tr("Apply each MQTT or D-Bus value update immediately, instead of once per frame"));
+	parser.addOption(noUpdateCoalescing);
+
+	QCommandLineOption record("record",
+		QGuiApplication::tr("Record all MQTT or D-Bus value changes to the specified file"),
+		QGuiApplication::tr("file", "Recording file"));
+	parser.addOption(record);
+
+	QCommandLineOption replay("replay",
+		QGuiApplication::tr("Play back a file written with --record, instead of connecting to a data source"),
+		QGuiApplication::tr("file", "Recording file"));
+	parser.addOption(replay);
+
+	QCommandLineOption replaySpeed("replay-speed",
+		QGuiApplication::tr("Replay speed multiplier for --replay; 0 replays as fast as possible (default: 1)"),
+		QGuiApplication::tr("speed", "Replay speed"), QStringLiteral("1"));
+	parser.addOption(replaySpeed);
+
+	QCommandLineOption demandSubscriptions("demand-subscriptions",
+		QGuiApplication::tr("Only subscribe to the MQTT topics that are used by the UI (default in WebAssembly builds)"));
+	parser.addOption(demandSubscriptions);
+
+	QCommandLineOption noSnapshot("no-snapshot",
+		QGuiApplication::tr("Do not restore or save the snapshot of last-known values"));
+	parser.addOption(noSnapshot);
+
 	parser.process(*QCoreApplication::instance());
 
+	if (parser.isSet(noUpdateCoalescing)) {
+		backend->setUpdateCoalescingEnabled(false);
+	}
+	if (parser.isSet(demandSubscriptions)) {
+		backend->setDemandDrivenSubscriptionEnabled(true);
+	}
+	if (parser.isSet(noSnapshot)) {
+		backend->setSnapshotEnabled(false);
+	}
+	if (parser.isSet(dbusInitialFetch)) {
+		backend->setDBusInitialFetchConcurrency(parser.value(dbusInitialFetch).toInt());
+	}
+	if (parser.isSet(record)) {
+		backend->setRecordFileName(parser.value(record));
+	}
+	if (parser.isSet(mockFleet)) {
+		Victron::VenusOS::MockFleetConfig config = Victron::VenusOS::MockFleetConfig::fromString(parser.value(mockFleet));
+		config.updateRate = parser.value(mockFleetRate).toDouble();
+		config.seed = parser.value(mockSeed).toUInt();
+		backend->setMockFleet(config);
+	}
+	if (parser.isSet(mockScenario)) {
+		backend->setMockScenario(parser.value(mockScenario));
+	}
+	if (parser.isSet(mockNetwork)) {
+		backend->setMockNetworkConditions(Victron::VenusOS::MockNetworkConditions::fromString(parser.value(mockNetwork)).toVariantMap());
+	}
+
 	if (parser.isSet(mqttAddress) || parser.isSet(mqttPortalId)) {
 		if (parser.isSet(mqttUser)) {
 			backend->setUsername(parser.value(mqttUser));
@@ -165,7 +263,14 @@ void initBackend(bool *enableFpsCounter, bool *skipSplashScreen)
 			backend->setShard(parser.value(mqttShard));
 		}
 	}
-	if (parser.isSet(mqttAddress)) {
+	if (parser.isSet(vrmApi)) {
+		backend->setVrmApiUrl(parser.value(vrmApi));
+	}
+	if (parser.isSet(replay)) {
+		// Don't overwrite the snapshot of the live system with replayed values.
+		backend->setSnapshotEnabled(false);
+		backend->startReplay(parser.value(replay), parser.value(replaySpeed).toDouble());
+	} else if (parser.isSet(mqttAddress)) {
 		backend->setType(Victron::VenusOS::BackendConnection::MqttSource, parser.value(mqttAddress));
 	} else if (parser.isSet(mqttShard)) {
 		const QString shard = parser.value(mqttShard);
@@ -206,6 +311,21 @@ void initBackend(bool *enableFpsCounter, bool *skipSplashScreen)
 #endif
 	}
 
+	// Only the MQTT data sources show the devices of additional GX devices.
+	const bool mqttOptionSet = parser.isSet(mqttAddress) || parser.isSet(mqttShard) || parser.isSet(mqttPortalId);
+#if defined(VENUS_WEBASSEMBLY_BUILD)
+	const bool mqttBackend = !parser.isSet(replay) && (mqttOptionSet || !parser.isSet(mockMode));
+#else
+	const bool mqttBackend = !parser.isSet(replay) && mqttOptionSet;
+#endif
+	if (parser.isSet(mqttExtra) && !mqttBackend) {
+		qCritical() << "--mqtt-extra requires an MQTT backend (--mqtt, --shard or --id)";
+	} else {
+		for (const QString &address : parser.values(mqttExtra)) {
+			backend->addMqttSource(address);
+		}
+	}
+
 	if (parser.isSet(fpsCounter) || queryFpsCounter.contains(QStringLiteral("enable"))) {
 		*enableFpsCounter = true;
 	}
@@ -214,11 +334,32 @@ void initBackend(bool *enableFpsCounter, bool *skipSplashScreen)
 	}
 }
 
+// Logs the time from startup until the first frame rendered after all pages are loaded, so that
+// cold starts can be compared with warm starts (i.e. with and without --no-snapshot).
+void reportTimeToFirstUsefulFrame(QQmlEngine *engine, QQuickWindow *window, const QElapsedTimer &startupTimer)
+{
+	std::shared_ptr<QMetaObject::Connection> connection = std::make_shared<QMetaObject::Connection>();
+	*connection = QObject::connect(window, &QQuickWindow::frameSwapped, window, [=]() {
+		QObject *global = engine->singletonInstance<QObject *>("Victron.VenusOS", "Global");
+		if (!global || !global->property("allPagesLoaded").toBool()) {
+			return;
+		}
+		QObject::disconnect(*connection);
+		const Victron::VenusOS::BackendConnection *backend = Victron::VenusOS::BackendConnection::create();
+		qCInfo(venusGui) << "Time to first useful frame:" << startupTimer.elapsed() << "ms"
+				<< "backend state:" << backend->state()
+				<< "warm start:" << backend->isWarmStarting();
+	});
+}
+
 } // namespace
 
 
 int main(int argc, char *argv[])
 {
+	QElapsedTimer startupTimer;
+	startupTimer.start();
+
 	qInfo().nospace() << "Victron gui version: v" << PROJECT_VERSION_MAJOR << "." << PROJECT_VERSION_MINOR << "." << PROJECT_VERSION_PATCH;
 
 #if !defined(VENUS_WEBASSEMBLY_BUILD) && !defined(VENUS_DESKTOP_BUILD)
@@ -269,6 +410,17 @@ int main(int argc, char *argv[])
 	fpsCounter->setWindow(window);
 	fpsCounter->setEnabled(enableFpsCounter);
 
+	Victron::VenusOS::BackendConnection::create()->setWindow(window);
+#if !defined(VENUS_WEBASSEMBLY_BUILD)
+	// WebAssembly builds are notified by the browser when the page is hidden. Elsewhere, treat a
+	// minimized window as not visible.
+	QObject::connect(window, &QWindow::visibilityChanged, [](QWindow::Visibility visibility) {
+		Victron::VenusOS::BackendConnection::create()->setApplicationVisible(
+			visibility != QWindow::Minimized && visibility != QWindow::Hidden);
+	});
+#endif
+	reportTimeToFirstUsefulFrame(&engine, window, startupTimer);
+
 #if defined(VENUS_DESKTOP_BUILD)
 	QSurfaceFormat format = window->format();
 	format.setSamples(4); // enable MSAA
@@ -0,0 +1,290 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include "mockscenario.h"
+#include "logging.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QtMath>
+
+#include <algorithm>
+
+namespace Victron {
+
+namespace VenusOS {
+
+namespace {
+
+const int AlarmOk = 0;
+const int AlarmAlarm = 2;
+
+MockValueBatch valuesFromJson(const QJsonObject &object)
+{
+	MockValueBatch values;
+	for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+		values.append({ it.key(), it.value().toVariant() });
+	}
+	return values;
+}
+
+bool curveFromJson(const QJsonObject &object, MockScenario::Curve *curve, QString *error)
+{
+	static const QHash<QString, MockScenario::Curve::Shape> shapes = {
+		{ QStringLiteral("sine"), MockScenario::Curve::Sine },
+		{ QStringLiteral("ramp"), MockScenario::Curve::Ramp },
+		{ QStringLiteral("square"), MockScenario::Curve::Square },
+		{ QStringLiteral("random"), MockScenario::Curve::Random },
+	};
+	curve->uid = object.value(QStringLiteral("uid")).toString();
+	const QString shape = object.value(QStringLiteral("shape")).toString(QStringLiteral("sine"));
+	curve->shape = shapes.value(shape, MockScenario::Curve::Sine);
+	curve->min = object.value(QStringLiteral("min")).toDouble();
+	curve->max = object.value(QStringLiteral("max")).toDouble();
+	curve->period = object.value(QStringLiteral("period")).toInt();
+	curve->phase = object.value(QStringLiteral("phase")).toInt();
+	curve->step = object.value(QStringLiteral("step")).toDouble((curve->max - curve->min) / 100);
+
+	if (curve->uid.isEmpty()) {
+		*error = QStringLiteral("curve without a uid");
+	} else if (!shapes.contains(shape)) {
+		*error = QStringLiteral("unknown shape '%1' for %2").arg(shape, curve->uid);
+	} else if (curve->shape != MockScenario::Curve::Random && curve->period <= 0) {
+		*error = QStringLiteral("curve %1 needs a period").arg(curve->uid);
+	} else {
+		return true;
+	}
+	return false;
+}
+
+// Expands an alarm storm into one event per toggle.
+QVector<MockScenario::Event> alarmStormFromJson(qint64 at, const QJsonObject &object)
+{
+	QVector<MockScenario::Event> events;
+	const QString service = object.value(QStringLiteral("service")).toString();
+	const QJsonArray paths = object.value(QStringLiteral("paths")).toArray();
+	const int count = object.value(QStringLiteral("count")).toInt(10);
+	const int interval = qMax(1, object.value(QStringLiteral("interval")).toInt(100));
+	for (int i = 0; i < count; ++i) {
+		MockScenario::Event event;
+		event.at = at + qint64(i) * interval;
+		for (const QJsonValue &path : paths) {
+			event.values.append({ service + path.toString(), i % 2 == 0 ? AlarmAlarm : AlarmOk });
+		}
+		events.append(event);
+	}
+	// Leave the alarms cleared at the end of the storm.
+	if (count % 2 != 0) {
+		MockScenario::Event event;
+		event.at = at + qint64(count) * interval;
+		for (const QJsonValue &path : paths) {
+			event.values.append({ service + path.toString(), AlarmOk });
+		}
+		events.append(event);
+	}
+	return events;
+}
+
+}
+
+MockScenario MockScenario::load(const QString &fileName, QString *error)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		*error = file.errorString();
+		return MockScenario();
+	}
+	QJsonParseError parseError;
+	const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+	if (!document.isObject()) {
+		*error = parseError.errorString();
+		return MockScenario();
+	}
+
+	const QJsonObject object = document.object();
+	MockScenario scenario;
+	scenario.name = object.value(QStringLiteral("name")).toString(fileName);
+	scenario.tickInterval = qMax(10, object.value(QStringLiteral("tick")).toInt(1000));
+	scenario.duration = object.value(QStringLiteral("duration")).toInteger();
+	scenario.loop = object.value(QStringLiteral("loop")).toBool() && scenario.duration > 0;
+	scenario.seed = quint32(object.value(QStringLiteral("seed")).toInteger(1));
+	scenario.initialValues = valuesFromJson(object.value(QStringLiteral("values")).toObject());
+
+	for (const QJsonValue &value : object.value(QStringLiteral("curves")).toArray()) {
+		Curve curve;
+		if (!curveFromJson(value.toObject(), &curve, error)) {
+			return MockScenario();
+		}
+		scenario.curves.append(curve);
+	}
+
+	for (const QJsonValue &value : object.value(QStringLiteral("events")).toArray()) {
+		const QJsonObject eventObject = value.toObject();
+		Event event;
+		event.at = eventObject.value(QStringLiteral("at")).toInteger();
+		event.values = valuesFromJson(eventObject.value(QStringLiteral("set")).toObject());
+		for (const QJsonValue &service : eventObject.value(QStringLiteral("remove")).toArray()) {
+			event.removedServices.append(service.toString());
+		}
+		if (!event.values.isEmpty() || !event.removedServices.isEmpty()) {
+			scenario.events.append(event);
+		}
+		if (eventObject.contains(QStringLiteral("alarmStorm"))) {
+			scenario.events += alarmStormFromJson(event.at, eventObject.value(QStringLiteral("alarmStorm")).toObject());
+		}
+	}
+	std::stable_sort(scenario.events.begin(), scenario.events.end(), [](const Event &a, const Event &b) {
+		return a.at < b.at;
+	});
+
+	if (scenario.isEmpty()) {
+		*error = QStringLiteral("the scenario has no values, curves or events");
+		return scenario;
+	}
+
+	QSet<QString> services;
+	const auto addService = [&services](const QString &uid) {
+		services.insert(uid.section(QLatin1Char('/'), 0, 0));
+	};
+	for (const QPair<QString, QVariant> &value : std::as_const(scenario.initialValues)) {
+		addService(value.first);
+	}
+	for (const Curve &curve : std::as_const(scenario.curves)) {
+		addService(curve.uid);
+	}
+	for (const Event &event : std::as_const(scenario.events)) {
+		for (const QPair<QString, QVariant> &value : event.values) {
+			addService(value.first);
+		}
+	}
+	for (const QString &service : std::as_const(services)) {
+		if (!service.section(QLatin1Char('.'), 3).startsWith(QStringLiteral("scenario"))) {
+			qCWarning(venusGui) << "Mock scenario service" << service
+					<< "is not named com.victronenergy.<type>.scenario, so it is not shown as a device";
+		}
+	}
+	return scenario;
+}
+
+bool MockScenario::isEmpty() const
+{
+	return initialValues.isEmpty() && curves.isEmpty() && events.isEmpty();
+}
+
+MockScenarioPlayer::MockScenarioPlayer(const MockScenario &scenario)
+	: m_scenario(scenario)
+	, m_random(scenario.seed)
+{
+	for (const MockScenario::Curve &curve : m_scenario.curves) {
+		m_randomValues.append((curve.min + curve.max) / 2);
+	}
+}
+
+void MockScenarioPlayer::start()
+{
+	// The timer is created here rather than in the constructor, so that it lives in the worker thread.
+	if (!m_timer) {
+		m_timer = new QTimer(this);
+		connect(m_timer, &QTimer::timeout, this, &MockScenarioPlayer::tick);
+	}
+	m_clock.start();
+	restart();
+	m_timer->start(m_scenario.tickInterval);
+}
+
+void MockScenarioPlayer::restart()
+{
+	m_startTime = m_clock.elapsed();
+	m_nextEvent = 0;
+	// The initial values add the removed services again.
+	m_removedServices.clear();
+	if (!m_scenario.initialValues.isEmpty()) {
+		emit valuesGenerated(m_scenario.initialValues);
+	}
+}
+
+void MockScenarioPlayer::tick()
+{
+	qint64 time = m_clock.elapsed() - m_startTime;
+	if (m_scenario.duration > 0 && time >= m_scenario.duration) {
+		if (!m_scenario.loop) {
+			m_timer->stop();
+			qCInfo(venusGui) << "Mock scenario" << m_scenario.name << "finished";
+			return;
+		}
+		restart();
+		time = 0;
+	}
+
+	// Apply the events first, so that the curves of services removed in this tick are skipped.
+	MockValueBatch eventValues;
+	QStringList removedServices;
+	for (; m_nextEvent < m_scenario.events.count() && m_scenario.events.at(m_nextEvent).at <= time; ++m_nextEvent) {
+		const MockScenario::Event &event = m_scenario.events.at(m_nextEvent);
+		for (const QPair<QString, QVariant> &value : event.values) {
+			m_removedServices.remove(serviceOf(value.first));
+		}
+		eventValues += event.values;
+		for (const QString &service : event.removedServices) {
+			m_removedServices.insert(service);
+		}
+		removedServices += event.removedServices;
+	}
+
+	MockValueBatch values;
+	values.reserve(m_scenario.curves.count() + eventValues.count());
+	for (int i = 0; i < m_scenario.curves.count(); ++i) {
+		// Calculate the value anyway, so that random curves do not depend on removals.
+		const double value = curveValue(i, time);
+		const QString &uid = m_scenario.curves.at(i).uid;
+		if (m_removedServices.isEmpty() || !m_removedServices.contains(serviceOf(uid))) {
+			values.append({ uid, value });
+		}
+	}
+	values += eventValues;
+
+	if (!values.isEmpty()) {
+		emit valuesGenerated(values);
+	}
+	if (!removedServices.isEmpty()) {
+		emit servicesRemoved(removedServices);
+	}
+}
+
+QString MockScenarioPlayer::serviceOf(const QString &uid)
+{
+	return uid.section(QLatin1Char('/'), 0, 0);
+}
+
+double MockScenarioPlayer::curveValue(int index, qint64 time)
+{
+	const MockScenario::Curve &curve = m_scenario.curves.at(index);
+	const double range = curve.max - curve.min;
+	const double position = curve.period > 0
+			? double((time + curve.phase) % curve.period) / curve.period
+			: 0;
+
+	switch (curve.shape) {
+	case MockScenario::Curve::Sine:
+		return curve.min + range * (1 + qSin(2 * M_PI * position)) / 2;
+	case MockScenario::Curve::Ramp:
+		return curve.min + range * position;
+	case MockScenario::Curve::Square:
+		return position < 0.5 ? curve.max : curve.min;
+	case MockScenario::Curve::Random:
+	{
+		double &value = m_randomValues[index];
+		value = qBound(curve.min, value + (m_random.generateDouble() * 2 - 1) * curve.step, curve.max);
+		return value;
+	}
+	}
+	return curve.min;
+}
+
+} /* VenusOS */
+
+} /* Victron */
@@ -0,0 +1,139 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_MOCKSCENARIO_H
+#define VICTRON_VENUSOS_GUI_V2_MOCKSCENARIO_H
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QObject>
+#include <QtCore/QPair>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+#include <QtCore/QTimer>
+#include <QtCore/QVariant>
+#include <QtCore/QVector>
+
+namespace Victron {
+
+namespace VenusOS {
+
+typedef QVector<QPair<QString, QVariant> > MockValueBatch;
+
+/*
+  A scenario for the mock backend, loaded from a JSON file such as:
+
+  {
+      "name": "Battery drain",
+      "tick": 200,
+      "duration": 60000,
+      "loop": true,
+      "seed": 1,
+      "values": {
+          "com.victronenergy.battery.sim/DeviceInstance": 512,
+          "com.victronenergy.battery.sim/Soc": 80
+      },
+      "curves": [
+          { "uid": "com.victronenergy.battery.sim/Dc/0/Power", "shape": "sine", "min": -2000, "max": 2000, "period": 20000 },
+          { "uid": "com.victronenergy.battery.sim/Soc", "shape": "ramp", "min": 20, "max": 80, "period": 60000, "phase": 30000 },
+          { "uid": "com.victronenergy.battery.sim/Dc/0/Temperature", "shape": "random", "min": 15, "max": 35, "step": 0.2 }
+      ],
+      "events": [
+          { "at": 10000, "set": { "com.victronenergy.battery.sim/Alarms/LowSoc": 1 } },
+          { "at": 20000, "remove": [ "com.victronenergy.battery.sim" ] },
+          { "at": 30000, "alarmStorm": { "service": "com.victronenergy.battery.sim", "paths": [ "/Alarms/LowVoltage" ], "count": 50, "interval": 100 } }
+      ]
+  }
+
+  The values are set when the scenario starts. On each tick (in milliseconds), the value of each
+  curve is calculated from the time since the start: "sine", "ramp" and "square" curves repeat
+  every period, and "random" curves follow a bounded random walk. Events set values (which also
+  adds devices), or remove whole services. Once a service is removed, its curves are skipped
+  until an event sets a value of the service again, so that the removal is not undone by the next
+  tick. An alarm storm toggles the given alarm paths between ok (0) and alarm (2), count times. If
+  the scenario loops, it starts again after the duration.
+
+  Services are named com.victronenergy.<type>.scenario, optionally followed by a suffix such as
+  "_2", as the mock battery, solar charger and tank data only create devices for services named
+  like that (or like the .fleet_<n> services of --mock-fleet). Loading a scenario warns about
+  other service names.
+*/
+struct MockScenario
+{
+	struct Curve {
+		enum Shape {
+			Sine,
+			Ramp,
+			Square,
+			Random
+		};
+		QString uid;
+		Shape shape = Sine;
+		double min = 0;
+		double max = 0;
+		int period = 0;     // milliseconds
+		int phase = 0;      // milliseconds
+		double step = 0;    // for random curves, the maximum change per tick
+	};
+
+	struct Event {
+		qint64 at = 0;      // milliseconds
+		MockValueBatch values;
+		QStringList removedServices;
+	};
+
+	// Returns an empty scenario and sets the error if the file cannot be loaded.
+	static MockScenario load(const QString &fileName, QString *error);
+
+	bool isEmpty() const;
+
+	QString name;
+	int tickInterval = 1000;
+	qint64 duration = 0;
+	bool loop = false;
+	quint32 seed = 1;
+	MockValueBatch initialValues;
+	QVector<Curve> curves;
+	QVector<Event> events;      // ordered by time
+};
+
+/*
+  Plays a MockScenario from a worker thread, so that simulating the backend does not take time
+  from the GUI thread.
+*/
+class MockScenarioPlayer : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit MockScenarioPlayer(const MockScenario &scenario);
+
+	void start();
+
+Q_SIGNALS:
+	void valuesGenerated(const MockValueBatch &values);
+	void servicesRemoved(const QStringList &services);
+
+private:
+	void tick();
+	void restart();
+	double curveValue(int index, qint64 time);
+	static QString serviceOf(const QString &uid);
+
+	MockScenario m_scenario;
+	QVector<double> m_randomValues;
+	QRandomGenerator m_random;
+	QElapsedTimer m_clock;
+	QTimer *m_timer = nullptr;
+	qint64 m_startTime = 0;
+	int m_nextEvent = 0;
+	QSet<QString> m_removedServices;
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_MOCKSCENARIO_H
@@ -0,0 +1,156 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include "mqttpayloaddecoder.h"
+
+#include <QtCore/QCborMap>
+#include <QtCore/QCborValue>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QTimer>
+
+namespace Victron {
+
+namespace VenusOS {
+
+namespace {
+
+// The number of batches that can be waiting in each direction. A batch holds the messages
+// received in one iteration of the GUI event loop, so this is only reached if the worker falls
+// far behind.
+const int QueueCapacity = 256;
+
+// How long to wait before retrying when a queue is full.
+const int QueueFullRetryInterval = 1;
+
+}
+
+MqttPayloadDecoder::MqttPayloadDecoder(QObject *parent)
+	: QObject(parent)
+	, m_worker(new QObject)
+	, m_messageQueue(QueueCapacity)
+	, m_valueQueue(QueueCapacity)
+{
+	m_thread.setObjectName(QStringLiteral("MqttPayloadDecoder"));
+	m_worker->moveToThread(&m_thread);
+	m_thread.start();
+}
+
+MqttPayloadDecoder::~MqttPayloadDecoder()
+{
+	// The worker may be waiting for room in the value queue, which is only made by this thread.
+	m_stopping.store(true);
+	m_thread.quit();
+	m_thread.wait();
+	delete m_worker;
+}
+
+void MqttPayloadDecoder::enqueue(const QMqttTopicName &topic, const QByteArray &payload)
+{
+	m_messages.append({ topic, payload });
+	if (!m_submitScheduled) {
+		m_submitScheduled = true;
+		QMetaObject::invokeMethod(this, &MqttPayloadDecoder::submitMessages, Qt::QueuedConnection);
+	}
+}
+
+MqttPayloadDecoder::Value MqttPayloadDecoder::decode(const Message &message)
+{
+	Value value;
+	value.message = message;
+
+	// Only N/<portalId>/<serviceType>/<instance>/<path> topics carry item values.
+	const QString name = message.topic.name();
+	if (message.topic.levelCount() < 5 || !name.startsWith(QLatin1String("N/"))) {
+		return value;
+	}
+	value.uid = name.mid(name.indexOf(QLatin1Char('/'), 2) + 1);
+	if (message.payload.isEmpty()) {
+		return value;
+	}
+
+	// A null value means that the item has no valid value.
+	if (isCbor(message.payload)) {
+		QCborValue cbor = QCborValue::fromCbor(message.payload);
+		if (cbor.isTag()) {
+			cbor = cbor.taggedValue();
+		}
+		const QCborValue cborValue = cbor.toMap().value(QLatin1String("value"));
+		if (!cborValue.isNull() && !cborValue.isUndefined() && !cborValue.isInvalid()) {
+			value.value = cborValue.toVariant();
+		}
+	} else {
+		const QJsonValue jsonValue = QJsonDocument::fromJson(message.payload).object().value(QLatin1String("value"));
+		if (!jsonValue.isNull() && !jsonValue.isUndefined()) {
+			value.value = jsonValue.toVariant();
+		}
+	}
+	return value;
+}
+
+bool MqttPayloadDecoder::isCbor(const QByteArray &payload)
+{
+	// CBOR major type 5 (map) is 0xa0-0xbf, and the self-describe tag 55799 starts with 0xd9d9f7.
+	// A JSON object starts with '{' or whitespace.
+	const quint8 first = payload.isEmpty() ? 0 : quint8(payload.at(0));
+	return (first & 0xe0) == 0xa0 || first == 0xd9;
+}
+
+void MqttPayloadDecoder::submitMessages()
+{
+	m_submitScheduled = false;
+	if (m_messages.isEmpty()) {
+		return;
+	}
+	if (!m_messageQueue.push(std::move(m_messages))) {
+		// The worker has fallen behind; keep collecting messages and try again shortly.
+		m_submitScheduled = true;
+		QTimer::singleShot(QueueFullRetryInterval, this, &MqttPayloadDecoder::submitMessages);
+		return;
+	}
+	m_messages = MessageBatch();
+	if (!m_decodeScheduled.exchange(true)) {
+		QMetaObject::invokeMethod(m_worker, [this] { decodeMessages(); }, Qt::QueuedConnection);
+	}
+}
+
+void MqttPayloadDecoder::decodeMessages()
+{
+	// Called on the worker thread. Clear the flag before draining the queue, so that a batch
+	// pushed while draining schedules another call rather than being missed.
+	m_decodeScheduled.store(false);
+
+	MessageBatch messages;
+	while (!m_stopping.load() && m_messageQueue.pop(&messages)) {
+		ValueBatch values;
+		values.reserve(messages.count());
+		for (const Message &message : messages) {
+			values.append(decode(message));
+		}
+		while (!m_valueQueue.push(std::move(values))) {
+			if (m_stopping.load()) {
+				return;
+			}
+			QThread::msleep(QueueFullRetryInterval);
+		}
+		if (!m_takeScheduled.exchange(true)) {
+			QMetaObject::invokeMethod(this, &MqttPayloadDecoder::takeDecodedBatches, Qt::QueuedConnection);
+		}
+	}
+}
+
+void MqttPayloadDecoder::takeDecodedBatches()
+{
+	m_takeScheduled.store(false);
+
+	ValueBatch values;
+	while (m_valueQueue.pop(&values)) {
+		emit batchDecoded(values);
+	}
+}
+
+} /* VenusOS */
+
+} /* Victron */
@@ -0,0 +1,99 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_MQTTPAYLOADDECODER_H
+#define VICTRON_VENUSOS_GUI_V2_MQTTPAYLOADDECODER_H
+
+#include "spscqueue.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QThread>
+#include <QtCore/QVariant>
+#include <QtCore/QVector>
+#include <QtMqtt/QMqttTopicName>
+
+#include <atomic>
+
+namespace Victron {
+
+namespace VenusOS {
+
+/*
+  Decodes the JSON or CBOR payloads of MQTT messages on a worker thread.
+
+  Messages are passed to enqueue() on the GUI thread. They are collected until control returns to
+  the event loop, then handed to the worker thread as one batch. The worker decodes each payload
+  of a N/<portalId>/<serviceType>/<instance>/<path> topic into a (uid, value) pair, where the uid
+  is <serviceType>/<instance>/<path>, and hands the decoded batch back. Both hand-overs go through
+  a lock-free single-producer/single-consumer queue, so the threads never wait for each other.
+
+  Payloads are JSON objects such as {"value": 12.34}, or CBOR maps with the same "value" key,
+  which are smaller and cheaper to decode. The encoding is detected from the first byte of each
+  payload, so publishers can switch to CBOR per topic, and JSON keeps working.
+
+  Other topics (e.g. N/<portalId>/full_publish_completed) are not decoded, but passed through as
+  control messages, so that they stay in order with the values.
+
+  Decoded batches are emitted by batchDecoded() on the thread that the decoder lives in.
+
+  The application does not use the decoder yet: VeQItemMqttProducer decodes the messages of its
+  own client, and has no API to take decoded values instead. Until veutil has one, the decoder is
+  only built by tst_mqttpayloaddecoder, which measures the GUI-thread time that it would save.
+*/
+class MqttPayloadDecoder : public QObject
+{
+	Q_OBJECT
+
+public:
+	struct Message {
+		QMqttTopicName topic;
+		QByteArray payload;
+	};
+
+	struct Value {
+		QString uid;            // empty for control messages
+		QVariant value;         // invalid if the payload was empty, i.e. the item was removed
+		Message message;        // the message that the value was decoded from
+	};
+
+	typedef QVector<Message> MessageBatch;
+	typedef QVector<Value> ValueBatch;
+
+	explicit MqttPayloadDecoder(QObject *parent = nullptr);
+	~MqttPayloadDecoder() override;
+
+	void enqueue(const QMqttTopicName &topic, const QByteArray &payload);
+
+	// Decodes a single message on the calling thread.
+	static Value decode(const Message &message);
+
+	// Returns true if the payload is CBOR-encoded, i.e. starts with a CBOR map or with the CBOR
+	// self-describe tag, rather than with a JSON object.
+	static bool isCbor(const QByteArray &payload);
+
+Q_SIGNALS:
+	void batchDecoded(const ValueBatch &batch);
+
+private:
+	void submitMessages();
+	void decodeMessages();
+	void takeDecodedBatches();
+
+	QObject *m_worker = nullptr;
+	QThread m_thread;
+	MessageBatch m_messages;
+	SpscQueue<MessageBatch> m_messageQueue;
+	SpscQueue<ValueBatch> m_valueQueue;
+	std::atomic<bool> m_decodeScheduled { false };
+	std::atomic<bool> m_takeScheduled { false };
+	std::atomic<bool> m_stopping { false };
+	bool m_submitScheduled = false;
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_MQTTPAYLOADDECODER_H
@@ -0,0 +1,399 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include "mqttsubscriptionmanager.h"
+#include "veqitemcoalescingproducer.h"
+#include "logging.h"
+
+#include "veutil/qt/ve_qitems_mqtt.hpp"
+
+#include <QtMqtt/QMqttClient>
+#include <QtMqtt/QMqttSubscription>
+
+namespace Victron {
+
+namespace VenusOS {
+
+namespace {
+
+// How long a subtree stays subscribed after its last consumer has gone away.
+const int GracePeriod = 30 * 1000;
+const int ReleaseCheckInterval = 5 * 1000;
+
+// Delay before asking the broker to republish values, so that the subscriptions made while a page
+// is being created are followed by a single request.
+const int RequestValuesDelay = 250;
+
+const int TrafficReportInterval = 60 * 1000;
+
+// Topics that are subscribed regardless of consumers. The DeviceInstance topic of each service
+// allows new services to be discovered, and the other services are used throughout the UI.
+const char *const FixedTopicFilters[] = {
+	"N/%1/+/+/DeviceInstance",
+	"N/%1/system/#",
+	"N/%1/settings/#",
+	"N/%1/platform/#",
+	"N/%1/heartbeat",
+	"N/%1/full_publish_completed",
+};
+
+// The only topics that are subscribed while the application is not visible.
+const char *const BackgroundTopicFilter = "N/%1/platform/0/Notifications/#";
+
+// Services that are covered by FixedTopicFilters.
+bool isFixedSubtree(const QString &serviceType, const QString &path)
+{
+	return serviceType == QLatin1String("system")
+			|| serviceType == QLatin1String("settings")
+			|| serviceType == QLatin1String("platform")
+			|| path == QLatin1String("DeviceInstance");
+}
+
+}
+
+MqttSubscriptionManager::MqttSubscriptionManager(VeQItemMqttProducer *producer, VeQItemCoalescingProducer *mirror, QObject *parent)
+	: QObject(parent)
+	, m_producer(producer)
+	, m_mirror(mirror)
+{
+	m_releaseTimer.setInterval(ReleaseCheckInterval);
+	connect(&m_releaseTimer, &QTimer::timeout, this, &MqttSubscriptionManager::releaseUnusedSubtrees);
+
+	m_requestValuesTimer.setSingleShot(true);
+	m_requestValuesTimer.setInterval(RequestValuesDelay);
+	connect(&m_requestValuesTimer, &QTimer::timeout, this, &MqttSubscriptionManager::requestValues);
+
+	m_trafficTimer.setInterval(TrafficReportInterval);
+	connect(&m_trafficTimer, &QTimer::timeout, this, &MqttSubscriptionManager::reportTraffic);
+
+	m_clock.start();
+	connect(producer, &VeQItemMqttProducer::connectionStateChanged,
+		this, &MqttSubscriptionManager::connectionStateChanged);
+	if (mirror) {
+		connect(mirror, &VeQItemCoalescingProducer::itemConsumed,
+			this, &MqttSubscriptionManager::itemConsumed);
+	}
+}
+
+bool MqttSubscriptionManager::isDemandDriven() const
+{
+	return m_demandDriven;
+}
+
+void MqttSubscriptionManager::setDemandDriven(bool demandDriven)
+{
+	if (demandDriven && !m_mirror) {
+		qCWarning(venusGui) << "Demand-driven MQTT subscriptions require update coalescing";
+		return;
+	}
+	m_demandDriven = demandDriven;
+}
+
+int MqttSubscriptionManager::messagesPerMinute() const
+{
+	return m_messagesPerMinute;
+}
+
+qint64 MqttSubscriptionManager::bytesPerMinute() const
+{
+	return m_bytesPerMinute;
+}
+
+int MqttSubscriptionManager::subscriptionCount() const
+{
+	if (!m_active) {
+		return 1;
+	}
+	int count = m_backgroundSubscription ? 1 : 0;
+	for (const QPointer<QMqttSubscription> &subscription : m_fixedSubscriptions) {
+		count += subscription ? 1 : 0;
+	}
+	for (const Subtree &entry : m_subtrees) {
+		count += entry.subscription ? 1 : 0;
+	}
+	return count;
+}
+
+bool MqttSubscriptionManager::findClient()
+{
+	if (!m_client && m_producer) {
+		// The producer does not expose its client, but owns it.
+		m_client = m_producer->findChild<QMqttClient *>();
+		if (m_client) {
+			connect(m_client, &QMqttClient::messageReceived, this, &MqttSubscriptionManager::messageReceived);
+			m_trafficTimer.start();
+		}
+	}
+	return m_client;
+}
+
+void MqttSubscriptionManager::connectionStateChanged()
+{
+	if (!findClient()) {
+		return;
+	}
+	if (m_producer->connectionState() == VeQItemMqttProducer::Ready) {
+		if (m_demandDriven && !m_active) {
+			start();
+		} else if (m_background) {
+			pause();
+		}
+	} else if (m_active || m_paused) {
+		// The client drops its subscriptions when the connection is lost, and the producer
+		// subscribes to everything again when it reconnects.
+		m_active = false;
+		m_paused = false;
+		m_releaseTimer.stop();
+		m_fixedSubscriptions.clear();
+		m_backgroundSubscription.clear();
+		for (Subtree &entry : m_subtrees) {
+			entry.subscription.clear();
+		}
+	}
+}
+
+void MqttSubscriptionManager::setBackground(bool background)
+{
+	if (m_background == background) {
+		return;
+	}
+	m_background = background;
+	if (!m_client || m_producer->connectionState() != VeQItemMqttProducer::Ready) {
+		// Applied when the producer is Ready.
+		return;
+	}
+	if (background) {
+		pause();
+	} else {
+		resume();
+	}
+}
+
+void MqttSubscriptionManager::itemConsumed(VeQItem *item)
+{
+	VeQItemCoalesced *mirrorItem = qobject_cast<VeQItemCoalesced *>(item);
+	if (!mirrorItem || !m_mirror) {
+		return;
+	}
+
+	// Subtrees are <serviceType>/<instance>/<first path component>, e.g. battery/512/Dc. Items
+	// above that level (e.g. a service, when its children are listed) are not tracked.
+	const QString uid = m_mirror->relativeUid(item);
+	const QStringList parts = uid.split(QLatin1Char('/'));
+	if (parts.count() < 3 || isFixedSubtree(parts.at(0), parts.at(2))) {
+		return;
+	}
+	const QString subtree = parts.mid(0, 3).join(QLatin1Char('/'));
+
+	Subtree &entry = m_subtrees[subtree];
+	if (!entry.items.contains(mirrorItem)) {
+		entry.items.append(mirrorItem);
+	}
+	entry.unusedSince = -1;
+	if (m_active && !m_paused && !entry.subscription) {
+		subscribe(subtree, &entry);
+		m_requestValuesTimer.start();
+	}
+}
+
+void MqttSubscriptionManager::messageReceived(const QByteArray &message, const QMqttTopicName &topic)
+{
+	m_messageCount++;
+	m_byteCount += message.size() + topic.name().size();
+}
+
+QMqttSubscription *MqttSubscriptionManager::findWildcardSubscription()
+{
+	// Find the subscription to all topics, i.e. N/<portalId>/#, made by the producer.
+	const QList<QMqttSubscription *> subscriptions = m_client->findChildren<QMqttSubscription *>();
+	for (QMqttSubscription *subscription : subscriptions) {
+		if (subscription->state() != QMqttSubscription::Subscribed
+				&& subscription->state() != QMqttSubscription::SubscriptionPending) {
+			continue;
+		}
+		const QStringList levels = subscription->topic().filter().split(QLatin1Char('/'));
+		if (levels.count() == 3 && levels.at(0) == QLatin1String("N") && levels.at(2) == QLatin1String("#")
+				&& levels.at(1) != QLatin1String("+")) {
+			m_portalId = levels.at(1);
+			return subscription;
+		}
+	}
+	return nullptr;
+}
+
+void MqttSubscriptionManager::start()
+{
+	QMqttSubscription *wildcard = findWildcardSubscription();
+	if (!wildcard) {
+		qCWarning(venusGui) << "Cannot find the MQTT subscription to all topics; demand-driven subscriptions are disabled";
+		return;
+	}
+
+	m_active = true;
+	if (m_background) {
+		subscribeBackgroundTopics();
+	} else {
+		subscribeInUse();
+	}
+
+	// Subscribe before unsubscribing, so that no values are missed in between.
+	wildcard->unsubscribe();
+	qCInfo(venusGui) << "Replaced the MQTT subscription to all topics with" << subscriptionCount() << "subscriptions";
+}
+
+void MqttSubscriptionManager::pause()
+{
+	if (m_paused) {
+		return;
+	}
+	QMqttSubscription *wildcard = m_active ? nullptr : findWildcardSubscription();
+	if (!m_active && !wildcard) {
+		qCWarning(venusGui) << "Cannot find the MQTT subscription to all topics; background mode is disabled";
+		return;
+	}
+
+	subscribeBackgroundTopics();
+	if (m_active) {
+		unsubscribeInUse();
+	} else {
+		wildcard->unsubscribe();
+	}
+	qCInfo(venusGui) << "Application is not visible, only subscribed to notifications";
+}
+
+void MqttSubscriptionManager::resume()
+{
+	if (!m_paused) {
+		return;
+	}
+	if (m_active) {
+		subscribeInUse();
+	} else {
+		m_client->subscribe(QMqttTopicFilter(QStringLiteral("N/%1/#").arg(m_portalId)));
+	}
+	if (m_backgroundSubscription) {
+		m_backgroundSubscription->unsubscribe();
+		m_backgroundSubscription.clear();
+	}
+	m_paused = false;
+
+	// Values may have changed while paused; resynchronize them all with a single request.
+	m_requestValuesTimer.stop();
+	requestValues();
+	qCInfo(venusGui) << "Application is visible, resubscribed with" << subscriptionCount() << "subscriptions";
+}
+
+void MqttSubscriptionManager::subscribeBackgroundTopics()
+{
+	m_backgroundSubscription = m_client->subscribe(QMqttTopicFilter(QString::fromLatin1(BackgroundTopicFilter).arg(m_portalId)));
+	m_paused = true;
+}
+
+void MqttSubscriptionManager::subscribeInUse()
+{
+	for (const char *filter : FixedTopicFilters) {
+		m_fixedSubscriptions.append(m_client->subscribe(QMqttTopicFilter(QString::fromLatin1(filter).arg(m_portalId))));
+	}
+	for (auto it = m_subtrees.begin(); it != m_subtrees.end(); ++it) {
+		for (const QPointer<VeQItemCoalesced> &item : it.value().items) {
+			if (item && item->hasConsumers()) {
+				subscribe(it.key(), &it.value());
+				break;
+			}
+		}
+	}
+	m_releaseTimer.start();
+}
+
+void MqttSubscriptionManager::unsubscribeInUse()
+{
+	m_releaseTimer.stop();
+	for (const QPointer<QMqttSubscription> &subscription : m_fixedSubscriptions) {
+		if (subscription) {
+			subscription->unsubscribe();
+		}
+	}
+	m_fixedSubscriptions.clear();
+	for (Subtree &entry : m_subtrees) {
+		unsubscribe(&entry);
+	}
+}
+
+void MqttSubscriptionManager::subscribe(const QString &subtree, Subtree *entry)
+{
+	entry->subscription = m_client->subscribe(QMqttTopicFilter(topicFilter(subtree)));
+	entry->unusedSince = -1;
+	qCDebug(venusGui) << "Subscribed to" << topicFilter(subtree);
+}
+
+void MqttSubscriptionManager::unsubscribe(Subtree *entry)
+{
+	if (entry->subscription) {
+		qCDebug(venusGui) << "Unsubscribed from" << entry->subscription->topic().filter();
+		entry->subscription->unsubscribe();
+		entry->subscription.clear();
+	}
+}
+
+void MqttSubscriptionManager::releaseUnusedSubtrees()
+{
+	const qint64 now = m_clock.elapsed();
+	for (auto it = m_subtrees.begin(); it != m_subtrees.end(); ) {
+		Subtree &entry = it.value();
+		entry.items.removeAll(QPointer<VeQItemCoalesced>());
+
+		bool consumed = false;
+		for (const QPointer<VeQItemCoalesced> &item : entry.items) {
+			if (item->hasConsumers()) {
+				consumed = true;
+				break;
+			}
+		}
+
+		if (consumed) {
+			entry.unusedSince = -1;
+		} else if (entry.unusedSince < 0) {
+			entry.unusedSince = now;
+		} else if (now - entry.unusedSince >= GracePeriod) {
+			unsubscribe(&entry);
+		}
+
+		if (entry.items.isEmpty() && !entry.subscription) {
+			it = m_subtrees.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void MqttSubscriptionManager::requestValues()
+{
+	// The values of newly subscribed subtrees may be stale or missing. A keepalive makes the
+	// broker publish all values again, and only the subscribed topics are delivered.
+	if (m_client && !m_portalId.isEmpty()) {
+		m_client->publish(QMqttTopicName(QStringLiteral("R/%1/keepalive").arg(m_portalId)), QByteArray());
+	}
+}
+
+void MqttSubscriptionManager::reportTraffic()
+{
+	m_messagesPerMinute = m_messageCount;
+	m_bytesPerMinute = m_byteCount;
+	m_messageCount = 0;
+	m_byteCount = 0;
+	qCInfo(venusGui) << "MQTT traffic:" << m_messagesPerMinute << "messages," << m_bytesPerMinute
+			<< "bytes per minute with" << subscriptionCount()
+			<< (m_paused ? "background subscriptions" : m_active ? "demand-driven subscriptions" : "subscription to all topics");
+	emit trafficChanged();
+}
+
+QString MqttSubscriptionManager::topicFilter(const QString &subtree) const
+{
+	return QStringLiteral("N/%1/%2/#").arg(m_portalId, subtree);
+}
+
+} /* VenusOS */
+
+} /* Victron */
@@ -0,0 +1,127 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_MQTTSUBSCRIPTIONMANAGER_H
+#define VICTRON_VENUSOS_GUI_V2_MQTTSUBSCRIPTIONMANAGER_H
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
+
+class QMqttClient;
+class QMqttSubscription;
+class QMqttTopicName;
+class VeQItem;
+class VeQItemMqttProducer;
+
+namespace Victron {
+
+namespace VenusOS {
+
+class VeQItemCoalescingProducer;
+class VeQItemCoalesced;
+
+/*
+  Measures the MQTT traffic received by a VeQItemMqttProducer and, when demand-driven
+  subscriptions are enabled, limits the producer's subscriptions to the topics that are in use.
+
+  The producer subscribes to N/<portalId>/# so that the initial full publish populates the whole
+  item tree. Once the producer is Ready, that subscription is replaced by:
+    - a fixed set of subscriptions that are always needed, e.g. N/<portalId>/+/+/DeviceInstance so
+      that new services are still discovered, and the system and settings services;
+    - one N/<portalId>/<serviceType>/<instance>/<path component>/# subscription for each subtree
+      that has a consumer, i.e. a VeQuickItem or VeQItemTableModel connected to an item in the
+      mirrored tree of the VeQItemCoalescingProducer.
+
+  Subtrees whose consumers have all gone away are unsubscribed after a grace period, so that
+  navigating back and forth between pages does not cause subscription churn. When new subtrees
+  are subscribed, a keepalive is published so that the broker publishes their current values.
+
+  VeQItemMqttProducer does not expose its QMqttClient or its subscriptions, so the client is
+  found as a child of the producer, and the subscription to all topics by its N/<portalId>/#
+  filter. If either is not found, a warning is logged and subscriptions are left to the producer.
+
+  While the application is not visible (e.g. a remote console in a background browser tab), all
+  subscriptions except notifications are dropped, whether or not subscriptions are demand-driven.
+  When it becomes visible again, the subscriptions are restored and the values are resynchronized
+  with a single keepalive. The producer's own periodic keepalive continues, as the broker stops
+  publishing notifications without it.
+*/
+class MqttSubscriptionManager : public QObject
+{
+	Q_OBJECT
+
+public:
+	MqttSubscriptionManager(VeQItemMqttProducer *producer, VeQItemCoalescingProducer *mirror, QObject *parent = nullptr);
+
+	bool isDemandDriven() const;
+	void setDemandDriven(bool demandDriven);
+
+	// The MQTT traffic received during the last complete minute.
+	int messagesPerMinute() const;
+	qint64 bytesPerMinute() const;
+
+	int subscriptionCount() const;
+
+	// In background mode, only notification topics are subscribed.
+	void setBackground(bool background);
+
+Q_SIGNALS:
+	void trafficChanged();
+
+private:
+	struct Subtree {
+		QVector<QPointer<VeQItemCoalesced> > items;
+		QPointer<QMqttSubscription> subscription;
+		qint64 unusedSince = -1;
+	};
+
+	bool findClient();
+	void connectionStateChanged();
+	void itemConsumed(VeQItem *item);
+	void messageReceived(const QByteArray &message, const QMqttTopicName &topic);
+	QMqttSubscription *findWildcardSubscription();
+	void start();
+	void pause();
+	void resume();
+	void subscribeBackgroundTopics();
+	void subscribeInUse();
+	void unsubscribeInUse();
+	void subscribe(const QString &subtree, Subtree *entry);
+	void unsubscribe(Subtree *entry);
+	void releaseUnusedSubtrees();
+	void requestValues();
+	void reportTraffic();
+	QString topicFilter(const QString &subtree) const;
+
+	QPointer<VeQItemMqttProducer> m_producer;
+	QPointer<VeQItemCoalescingProducer> m_mirror;
+	QPointer<QMqttClient> m_client;
+	QHash<QString, Subtree> m_subtrees;
+	QVector<QPointer<QMqttSubscription> > m_fixedSubscriptions;
+	QPointer<QMqttSubscription> m_backgroundSubscription;
+	QString m_portalId;
+	QTimer m_releaseTimer;
+	QTimer m_requestValuesTimer;
+	QTimer m_trafficTimer;
+	QElapsedTimer m_clock;
+	int m_messageCount = 0;
+	qint64 m_byteCount = 0;
+	int m_messagesPerMinute = 0;
+	qint64 m_bytesPerMinute = 0;
+	bool m_demandDriven = false;
+	bool m_active = false;
+	bool m_background = false;
+	bool m_paused = false;
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_MQTTSUBSCRIPTIONMANAGER_H
@@ -0,0 +1,38 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_PARSERSTATUS_H
+#define VICTRON_VENUSOS_GUI_V2_PARSERSTATUS_H
+
+#include <QtQml/QQmlParserStatus>
+
+namespace Victron {
+
+namespace VenusOS {
+
+/*
+  A QQmlParserStatus that records whether the component is complete, so that a type can wait
+  until all of its properties are set before building its state. Objects created from C++ are
+  complete straight away. Subclasses that override componentComplete() call this implementation
+  first.
+*/
+class ParserStatus : public QQmlParserStatus
+{
+public:
+	void classBegin() override { m_componentComplete = false; }
+	void componentComplete() override { m_componentComplete = true; }
+
+protected:
+	bool isComponentComplete() const { return m_componentComplete; }
+
+private:
+	bool m_componentComplete = true;
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_PARSERSTATUS_H
@@ -0,0 +1,210 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include "servicedevice.h"
+
+#include <QtCore/QtMath>
+
+#include <cstddef>
+#include <iterator>
+
+namespace Victron {
+
+namespace VenusOS {
+
+const ServiceDevice::Field ServiceDevice::Fields[] = {
+	{ "/DeviceInstance", IntField, offsetof(Values, deviceInstance), &ServiceDevice::updateIdentity },
+	{ "/CustomName", StringField, offsetof(Values, customName), &ServiceDevice::customNameFieldChanged },
+	{ "/ProductName", StringField, offsetof(Values, productName), &ServiceDevice::productNameFieldChanged },
+};
+
+ServiceDevice::ServiceDevice(QObject *parent)
+	: BaseDevice(parent)
+{
+	addFields(Fields, static_cast<int>(std::size(Fields)), &m_values);
+	connect(this, &BaseDevice::serviceUidChanged, this, &ServiceDevice::bindItems);
+	connect(this, &BaseDevice::deviceInstanceChanged, this, &ServiceDevice::updateValid);
+}
+
+bool ServiceDevice::isValid() const
+{
+	return m_valid;
+}
+
+QString ServiceDevice::customName() const
+{
+	return m_values.customName;
+}
+
+QString ServiceDevice::productName() const
+{
+	return m_values.productName;
+}
+
+void ServiceDevice::addFields(const Field *fields, int count, void *values)
+{
+	m_fieldSets.append({ fields, count, values });
+	m_items.reserve(m_items.count() + count);
+	if (!serviceUid().isEmpty()) {
+		bindFieldSet(VeQItems::getRoot()->itemGetOrCreate(serviceUid(), false), m_fieldSets.count() - 1);
+	}
+}
+
+void ServiceDevice::bindItems()
+{
+	unbindItems();
+	if (serviceUid().isEmpty()) {
+		return;
+	}
+	VeQItem *serviceItem = VeQItems::getRoot()->itemGetOrCreate(serviceUid(), false);
+	for (int i = 0; i < m_fieldSets.count(); ++i) {
+		bindFieldSet(serviceItem, i);
+	}
+}
+
+void ServiceDevice::bindFieldSet(VeQItem *serviceItem, int fieldSetIndex)
+{
+	for (int i = 0; i < m_fieldSets.at(fieldSetIndex).count; ++i) {
+		m_items.append(bindField(serviceItem, fieldSetIndex, i));
+	}
+}
+
+VeQItem *ServiceDevice::bindField(VeQItem *serviceItem, int fieldSetIndex, int fieldIndex)
+{
+	// The paths start with a slash, which is not part of the uid relative to the service.
+	const Field &field = m_fieldSets.at(fieldSetIndex).fields[fieldIndex];
+	VeQItem *item = serviceItem->itemGetOrCreate(QString::fromLatin1(field.path + 1));
+	connect(item, &VeQItem::valueChanged, this, [this, fieldSetIndex, fieldIndex, item] {
+		setFieldValue(fieldSetIndex, fieldIndex, item->getValue());
+	});
+	connect(item, &QObject::destroyed, this, &ServiceDevice::itemDestroyed);
+	setFieldValue(fieldSetIndex, fieldIndex, item->getValue());
+	return item;
+}
+
+void ServiceDevice::itemDestroyed()
+{
+	// Rebind once the deletion is complete, as the whole service may be being deleted.
+	if (!m_rebindPending) {
+		m_rebindPending = true;
+		QMetaObject::invokeMethod(this, &ServiceDevice::rebindDeletedItems, Qt::QueuedConnection);
+	}
+}
+
+void ServiceDevice::rebindDeletedItems()
+{
+	m_rebindPending = false;
+	if (serviceUid().isEmpty()) {
+		return;
+	}
+	VeQItem *serviceItem = VeQItems::getRoot()->itemGetOrCreate(serviceUid(), false);
+	int itemIndex = 0;
+	for (int fieldSetIndex = 0; fieldSetIndex < m_fieldSets.count(); ++fieldSetIndex) {
+		for (int i = 0; i < m_fieldSets.at(fieldSetIndex).count && itemIndex < m_items.count(); ++i, ++itemIndex) {
+			if (!m_items.at(itemIndex)) {
+				m_items[itemIndex] = bindField(serviceItem, fieldSetIndex, i);
+			}
+		}
+	}
+}
+
+void ServiceDevice::unbindItems()
+{
+	for (const QPointer<VeQItem> &item : std::as_const(m_items)) {
+		if (item) {
+			item->disconnect(this);
+		}
+	}
+	m_items.clear();
+
+	for (int fieldSetIndex = 0; fieldSetIndex < m_fieldSets.count(); ++fieldSetIndex) {
+		for (int i = 0; i < m_fieldSets.at(fieldSetIndex).count; ++i) {
+			setFieldValue(fieldSetIndex, i, QVariant());
+		}
+	}
+}
+
+void ServiceDevice::setFieldValue(int fieldSetIndex, int fieldIndex, const QVariant &value)
+{
+	const FieldSet &fieldSet = m_fieldSets.at(fieldSetIndex);
+	const Field &field = fieldSet.fields[fieldIndex];
+	char *member = static_cast<char *>(fieldSet.values) + field.offset;
+	bool ok = false;
+	bool changed = false;
+
+	switch (field.type) {
+	case RealField:
+	{
+		qreal newValue = value.isValid() ? value.toReal(&ok) : qQNaN();
+		if (!ok) {
+			newValue = qQNaN();
+		}
+		qreal &currentValue = *reinterpret_cast<qreal *>(member);
+		changed = qIsNaN(currentValue) ? !qIsNaN(newValue) : (qIsNaN(newValue) || currentValue != newValue);
+		if (changed) {
+			currentValue = newValue;
+		}
+		break;
+	}
+	case IntField:
+	{
+		int newValue = value.isValid() ? value.toInt(&ok) : -1;
+		if (!ok) {
+			newValue = -1;
+		}
+		int &currentValue = *reinterpret_cast<int *>(member);
+		changed = currentValue != newValue;
+		currentValue = newValue;
+		break;
+	}
+	case StringField:
+	{
+		const QString newValue = value.toString();
+		QString &currentValue = *reinterpret_cast<QString *>(member);
+		changed = currentValue != newValue;
+		if (changed) {
+			currentValue = newValue;
+		}
+		break;
+	}
+	}
+
+	if (changed && field.notify) {
+		(this->*field.notify)();
+	}
+}
+
+void ServiceDevice::customNameFieldChanged()
+{
+	emit customNameChanged();
+	updateIdentity();
+}
+
+void ServiceDevice::productNameFieldChanged()
+{
+	emit productNameChanged();
+	updateIdentity();
+}
+
+void ServiceDevice::updateIdentity()
+{
+	setDeviceInstance(m_values.deviceInstance);
+	const QString displayName = m_values.customName.isEmpty() ? m_values.productName : m_values.customName;
+	setName(displayName);
+	setDescription(displayName);
+}
+
+void ServiceDevice::updateValid()
+{
+	const bool valid = deviceInstance() >= 0;
+	if (m_valid != valid) {
+		m_valid = valid;
+		emit validChanged();
+	}
+}
+
+} /* VenusOS */
+
+} /* Victron */
@@ -0,0 +1,132 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_SERVICEDEVICE_H
+#define VICTRON_VENUSOS_GUI_V2_SERVICEDEVICE_H
+
+#include "veutil/qt/ve_qitem.hpp"
+
+#include <QtCore/QPointer>
+#include <QtCore/QVarLengthArray>
+#include <QtQml/qqmlintegration.h>
+
+#include "basedevicemodel.h"
+
+namespace Victron {
+
+namespace VenusOS {
+
+/*
+  A device whose values are read directly from the VeQItems of its service, as a C++ replacement
+  for the Device.qml pattern of one VeQuickItem (and one QObject, binding and connection) per path.
+
+  A subclass declares, once, a static table that maps each path (relative to the service) to a
+  member of a plain values struct and to the notify signal of the matching Q_PROPERTY, e.g.:
+
+      const ServiceDevice::Field BatteryDevice::Fields[] = {
+          { "/Soc", ServiceDevice::RealField, offsetof(Values, stateOfCharge),
+                static_cast<ServiceDevice::Notifier>(&BatteryDevice::stateOfChargeChanged) },
+          ...
+      };
+
+  and passes the table and its values struct to addFields() from its constructor. When serviceUid
+  is set, the items of the service are looked up once, and each item's valueChanged() updates the
+  typed member and emits the notify signal. No QObject is created per path, and the values live
+  in the device itself. The properties are generated by moc as usual, so QML bindings to them
+  work as with any other device.
+
+  Like Device.qml, this provides the customName, productName and valid properties, and sets
+  deviceInstance from /DeviceInstance, and name and description from /CustomName or /ProductName.
+  Unlike in Device.qml, valid is read-only: it is true when the device has a device instance, and
+  QML that assigned or bound it must use deviceInstance instead.
+
+  An item may be deleted and created again while the device exists, e.g. when the backend
+  resynchronizes or a service is removed and published again. When a bound item is deleted, its
+  field is bound to the item at the same path once control returns to the event loop, so that the
+  device follows the new item.
+
+  Invalid values become NaN for real fields, -1 for int fields, and an empty string for string
+  fields, matching the "value === undefined ? NaN : value" bindings in QML.
+*/
+class ServiceDevice : public BaseDevice
+{
+	Q_OBJECT
+	QML_ELEMENT
+	Q_PROPERTY(bool valid READ isValid NOTIFY validChanged)
+	Q_PROPERTY(QString customName READ customName NOTIFY customNameChanged)
+	Q_PROPERTY(QString productName READ productName NOTIFY productNameChanged)
+
+public:
+	explicit ServiceDevice(QObject *parent = nullptr);
+
+	bool isValid() const;
+	QString customName() const;
+	QString productName() const;
+
+Q_SIGNALS:
+	void validChanged();
+	void customNameChanged();
+	void productNameChanged();
+
+protected:
+	enum FieldType {
+		RealField,      // qreal
+		IntField,       // int
+		StringField     // QString
+	};
+
+	// Called when the value of a field changes; usually the notify signal of its property.
+	typedef void (ServiceDevice::*Notifier)();
+
+	struct Field {
+		const char *path;
+		FieldType type;
+		size_t offset;          // the offset of the member in the values struct
+		Notifier notify;
+	};
+
+	// Binds the fields to the items of the service. The fields must be a static table, and the
+	// values struct a member of the device.
+	void addFields(const Field *fields, int count, void *values);
+
+private:
+	struct FieldSet {
+		const Field *fields = nullptr;
+		int count = 0;
+		void *values = nullptr;
+	};
+
+	struct Values {
+		int deviceInstance = -1;
+		QString customName;
+		QString productName;
+	};
+
+	static const Field Fields[];
+
+	void bindItems();
+	void bindFieldSet(VeQItem *serviceItem, int fieldSetIndex);
+	VeQItem *bindField(VeQItem *serviceItem, int fieldSetIndex, int fieldIndex);
+	void itemDestroyed();
+	void rebindDeletedItems();
+	void unbindItems();
+	void setFieldValue(int fieldSetIndex, int fieldIndex, const QVariant &value);
+	void customNameFieldChanged();
+	void productNameFieldChanged();
+	void updateIdentity();
+	void updateValid();
+
+	QVarLengthArray<FieldSet, 2> m_fieldSets;
+	QVector<QPointer<VeQItem> > m_items;    // the items that are connected to this device
+	Values m_values;
+	bool m_valid = false;
+	bool m_rebindPending = false;
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_SERVICEDEVICE_H
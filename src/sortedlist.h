@@ -0,0 +1,39 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_SORTEDLIST_H
+#define VICTRON_VENUSOS_GUI_V2_SORTEDLIST_H
+
+#include <algorithm>
+#include <iterator>
+
+namespace Victron {
+
+namespace VenusOS {
+
+/*
+  Returns the index that the entry at fromIndex should move to, when its sort key has changed
+  and the other entries of the list are still sorted by lessThan. Only the entries on the side
+  that it moves to are searched, as the list is usually long and the move short.
+*/
+template<typename List, typename LessThan>
+int sortedMoveIndex(const List &list, int fromIndex, LessThan lessThan)
+{
+	const auto &entry = list.at(fromIndex);
+	const auto begin = list.cbegin();
+	if (fromIndex > 0 && lessThan(entry, list.at(fromIndex - 1))) {
+		return static_cast<int>(std::distance(begin, std::upper_bound(begin, begin + fromIndex, entry, lessThan)));
+	}
+	if (fromIndex < list.count() - 1 && lessThan(list.at(fromIndex + 1), entry)) {
+		return static_cast<int>(std::distance(begin, std::upper_bound(begin + fromIndex + 1, list.cend(), entry, lessThan))) - 1;
+	}
+	return fromIndex;
+}
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_SORTEDLIST_H
@@ -0,0 +1,87 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_SPSCQUEUE_H
+#define VICTRON_VENUSOS_GUI_V2_SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace Victron {
+
+namespace VenusOS {
+
+/*
+  A bounded, lock-free queue for passing values from exactly one producer thread to exactly one
+  consumer thread.
+
+  push() must only be called from the producer thread, and pop() and isEmpty() from the consumer
+  thread. The capacity is rounded up to a power of two.
+*/
+template <typename T>
+class SpscQueue
+{
+public:
+	explicit SpscQueue(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity) {
+			size *= 2;
+		}
+		m_slots.resize(size);
+		m_mask = size - 1;
+	}
+
+	SpscQueue(const SpscQueue &) = delete;
+	SpscQueue &operator=(const SpscQueue &) = delete;
+
+	size_t capacity() const { return m_slots.size(); }
+
+	// Returns false if the queue is full, in which case the value is not moved from.
+	bool push(T &&value)
+	{
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_head.load(std::memory_order_acquire) == m_slots.size()) {
+			return false;
+		}
+		m_slots[tail & m_mask] = std::move(value);
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Returns false if the queue is empty.
+	bool pop(T *value)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		*value = std::move(m_slots[head & m_mask]);
+		m_slots[head & m_mask] = T();
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool isEmpty() const
+	{
+		return m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_acquire);
+	}
+
+private:
+	std::vector<T> m_slots;
+	size_t m_mask = 0;
+
+	// Kept on separate cache lines, so that the two threads do not contend for the same line.
+	alignas(64) std::atomic<size_t> m_head { 0 };
+	alignas(64) std::atomic<size_t> m_tail { 0 };
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_SPSCQUEUE_H
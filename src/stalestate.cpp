@@ -0,0 +1,82 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include "stalestate.h"
+
+#include <memory>
+
+namespace Victron {
+
+namespace VenusOS {
+
+namespace {
+
+const char *const StaleProperty = "_stale";
+
+}
+
+StaleState::StaleState(QObject *parent)
+	: QObject(parent)
+{
+}
+
+QString StaleState::uid() const
+{
+	return m_uid;
+}
+
+void StaleState::setUid(const QString &uid)
+{
+	if (m_uid == uid) {
+		return;
+	}
+	if (m_item) {
+		m_item->disconnect(this);
+	}
+	m_uid = uid;
+	m_item = uid.isEmpty() ? nullptr : VeQItems::getRoot()->itemGetOrCreate(uid);
+	if (m_item) {
+		connect(m_item, &VeQItem::stateChanged, this, &StaleState::update);
+	}
+	emit uidChanged();
+	update();
+}
+
+bool StaleState::isStale() const
+{
+	return m_stale;
+}
+
+void StaleState::markStale(VeQItem *item)
+{
+	item->setProperty(StaleProperty, true);
+
+	// Clear the mark once the backend produces a value, and stop watching the item.
+	auto connection = std::make_shared<QMetaObject::Connection>();
+	*connection = connect(item, &VeQItem::stateChanged, item, [item, connection] {
+		if (item->getState() != VeQItem::Requested) {
+			item->setProperty(StaleProperty, QVariant());
+			QObject::disconnect(*connection);
+		}
+	});
+}
+
+bool StaleState::isStaleItem(VeQItem *item)
+{
+	return item && item->getState() == VeQItem::Requested && item->property(StaleProperty).toBool();
+}
+
+void StaleState::update()
+{
+	const bool stale = isStaleItem(m_item.data());
+	if (m_stale != stale) {
+		m_stale = stale;
+		emit staleChanged();
+	}
+}
+
+} /* VenusOS */
+
+} /* Victron */
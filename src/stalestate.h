@@ -0,0 +1,67 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_STALESTATE_H
+#define VICTRON_VENUSOS_GUI_V2_STALESTATE_H
+
+#include "veutil/qt/ve_qitem.hpp"
+
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtQml/qqmlintegration.h>
+
+namespace Victron {
+
+namespace VenusOS {
+
+/*
+  Tells QML whether the value of an item was restored from a snapshot and has not been confirmed
+  by the backend yet, e.g. to show it dimmed during a warm start:
+
+      VeQuickItem { id: powerItem; uid: root.bindPrefix + "/Dc/0/Power" }
+      StaleState { id: powerState; uid: powerItem.uid }
+
+  A restored value is produced with the VeQItem::Requested state, like an item whose value is
+  being fetched, so the state alone does not tell the two apart. Restored items are marked
+  with markStale(), and an item is stale while it is marked and still in the Requested state.
+  The mark is cleared when the backend produces a value for the item, so a later fetch of the
+  item is not taken for a restored value.
+*/
+class StaleState : public QObject
+{
+	Q_OBJECT
+	QML_ELEMENT
+	Q_PROPERTY(QString uid READ uid WRITE setUid NOTIFY uidChanged)
+	Q_PROPERTY(bool stale READ isStale NOTIFY staleChanged)
+
+public:
+	explicit StaleState(QObject *parent = nullptr);
+
+	QString uid() const;
+	void setUid(const QString &uid);
+
+	bool isStale() const;
+
+	// Marks the value of the item as restored. Call before producing the restored value.
+	static void markStale(VeQItem *item);
+	static bool isStaleItem(VeQItem *item);
+
+signals:
+	void uidChanged();
+	void staleChanged();
+
+private:
+	void update();
+
+	QString m_uid;
+	QPointer<VeQItem> m_item;
+	bool m_stale = false;
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_STALESTATE_H
@@ -0,0 +1,214 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include "uidregistry.h"
+
+#include <algorithm>
+
+namespace Victron {
+
+namespace VenusOS {
+
+UidRegistry* UidRegistry::create(QQmlEngine *, QJSEngine *)
+{
+	static UidRegistry* registry = new UidRegistry(nullptr);
+	return registry;
+}
+
+UidRegistry::UidRegistry(QObject *parent)
+	: QObject(parent)
+{
+	// Handle 0 is the root of all uids, and is also used as the invalid handle.
+	m_nodes.append(Node());
+}
+
+int UidRegistry::handle(const QString &uid)
+{
+	return walk(0, uid);
+}
+
+int UidRegistry::find(const QString &uid) const
+{
+	int handle = 0;
+	for (QStringView segment : QStringView(uid).split(QLatin1Char('/'), Qt::SkipEmptyParts)) {
+		handle = findChild(handle, segment);
+		if (handle == 0) {
+			break;
+		}
+	}
+	return handle;
+}
+
+int UidRegistry::childHandle(int parent, const QString &path)
+{
+	return parent > 0 && parent < m_nodes.count() ? walk(parent, path) : 0;
+}
+
+QString UidRegistry::uid(int handle) const
+{
+	const Node *n = node(handle);
+	if (!n) {
+		return QString();
+	}
+	if (n->uid.isNull()) {
+		n->uid = n->parent > 0
+				? uid(n->parent) + QLatin1Char('/') + n->segment
+				: n->segment;
+	}
+	return n->uid;
+}
+
+int UidRegistry::parentHandle(int handle) const
+{
+	const Node *n = node(handle);
+	return n ? n->parent : 0;
+}
+
+QString UidRegistry::childUid(const QString &parentUid, const QString &path)
+{
+	return uid(walk(walk(0, parentUid), path));
+}
+
+QString UidRegistry::serviceType(int handle) const
+{
+	const Node *n = node(handle);
+	return n ? n->serviceType : QString();
+}
+
+QString UidRegistry::serviceTypeFromUid(const QString &uid) const
+{
+	if (const int h = find(uid)) {
+		return serviceType(h);
+	}
+
+	// Not registered: parse the uid, but do not register it.
+	const QList<QStringView> segments = QStringView(uid).split(QLatin1Char('/'), Qt::SkipEmptyParts);
+	return segments.count() >= 2
+			? serviceTypeOf(segments.at(1), segments.at(0).startsWith(QLatin1String("mqtt")))
+			: QString();
+}
+
+QString UidRegistry::serviceUid(int handle) const
+{
+	const Node *n = node(handle);
+	return n && n->service > 0 ? uid(n->service) : QString();
+}
+
+int UidRegistry::deviceInstance(int handle) const
+{
+	const Node *n = node(handle);
+	return n ? n->deviceInstance : -1;
+}
+
+int UidRegistry::count() const
+{
+	return m_nodes.count() - 1;
+}
+
+qint64 UidRegistry::memoryUsage() const
+{
+	qint64 bytes = m_nodes.capacity() * qint64(sizeof(Node));
+	for (const Node &n : m_nodes) {
+		// The service type is shared with the node that it was parsed from, so it is not counted.
+		bytes += (n.segment.capacity() + n.uid.capacity()) * qint64(sizeof(QChar))
+				+ n.children.capacity() * qint64(sizeof(int));
+	}
+	return bytes;
+}
+
+QString UidRegistry::serviceTypeOf(QStringView serviceSegment, bool mqtt)
+{
+	// MQTT: the segment is the service type. D-Bus and mock: com.victronenergy.<serviceType>.<suffix>
+	return mqtt ? serviceSegment.toString() : serviceSegment.toString().section(QLatin1Char('.'), 2, 2);
+}
+
+QVector<int>::const_iterator UidRegistry::lowerBound(int parent, QStringView segment) const
+{
+	const QVector<int> &children = m_nodes.at(parent).children;
+	return std::lower_bound(children.cbegin(), children.cend(), segment,
+			[this](int child, QStringView s) { return QStringView(m_nodes.at(child).segment).compare(s) < 0; });
+}
+
+int UidRegistry::findChild(int parent, QStringView segment) const
+{
+	const auto it = lowerBound(parent, segment);
+	return it != m_nodes.at(parent).children.cend() && QStringView(m_nodes.at(*it).segment) == segment ? *it : 0;
+}
+
+int UidRegistry::findOrAddChild(int parent, QStringView segment)
+{
+	const auto it = lowerBound(parent, segment);
+	if (it != m_nodes.at(parent).children.cend() && QStringView(m_nodes.at(*it).segment) == segment) {
+		return *it;
+	}
+	const int insertIndex = it - m_nodes.at(parent).children.cbegin();
+
+	// Uids have one of these formats:
+	//  - D-Bus and mock: <prefix>/com.victronenergy.<serviceType>.<suffix>/<path>
+	//  - MQTT: mqtt/<serviceType>/<deviceInstance>/<path>
+	// The service fields are worked out once, when the service segment is added, and copied to
+	// the nodes below it.
+	Node child;
+	child.segment = segment.toString();
+	child.parent = parent;
+	if (parent != 0) {
+		const Node &p = m_nodes.at(parent);
+		child.service = p.service;
+		child.serviceType = p.serviceType;
+		child.deviceInstance = p.deviceInstance;
+
+		const bool mqtt = m_nodes.at(rootOf(parent)).segment.startsWith(QLatin1String("mqtt"));
+		const bool parentIsPrefix = p.parent == 0;
+		if (!mqtt && parentIsPrefix) {
+			child.service = m_nodes.count();
+			child.serviceType = serviceTypeOf(segment, mqtt);
+		} else if (mqtt && parentIsPrefix) {
+			child.serviceType = serviceTypeOf(segment, mqtt);
+		} else if (mqtt && m_nodes.at(p.parent).parent == 0) {
+			bool ok = false;
+			const int instance = child.segment.toInt(&ok);
+			child.service = m_nodes.count();
+			child.deviceInstance = ok ? instance : -1;
+		}
+	}
+
+	const int handle = m_nodes.count();
+	m_nodes.append(child);
+	m_nodes[parent].children.insert(insertIndex, handle);
+	return handle;
+}
+
+int UidRegistry::walk(int handle, QStringView path)
+{
+	qsizetype start = 0;
+	while (start < path.size()) {
+		qsizetype end = path.indexOf(QLatin1Char('/'), start);
+		if (end < 0) {
+			end = path.size();
+		}
+		if (end > start) {
+			handle = findOrAddChild(handle, path.mid(start, end - start));
+		}
+		start = end + 1;
+	}
+	return handle;
+}
+
+int UidRegistry::rootOf(int handle) const
+{
+	while (m_nodes.at(handle).parent > 0) {
+		handle = m_nodes.at(handle).parent;
+	}
+	return handle;
+}
+
+const UidRegistry::Node *UidRegistry::node(int handle) const
+{
+	return handle > 0 && handle < m_nodes.count() ? &m_nodes.at(handle) : nullptr;
+}
+
+} /* VenusOS */
+
+} /* Victron */
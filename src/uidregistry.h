@@ -0,0 +1,112 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_UIDREGISTRY_H
+#define VICTRON_VENUSOS_GUI_V2_UIDREGISTRY_H
+
+#include <QObject>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+#include <qqmlintegration.h>
+
+class QQmlEngine;
+class QJSEngine;
+
+namespace Victron {
+
+namespace VenusOS {
+
+/*
+  Interns uids, e.g. "mqtt/battery/512/Dc/0/Voltage", as a tree of path segments, and gives each
+  uid a stable integer handle.
+
+  Each node stores its own segment, and uids that share a parent share its node. The full uid of
+  a node is composed from its parent's uid the first time uid() is called for it, and is then
+  cached with the node, so later calls return a shared copy without allocating. Only the uids
+  that are asked for are cached. Looking up a uid walks its segments without allocating, and the
+  service type, device instance and parent of a handle are stored with it, so they are found
+  without splitting strings.
+
+  childHandle() composes a child from a parent handle without building the parent uid, so QML
+  that binds to many children of one uid (e.g. a history day and its trackers) should keep the
+  parent handle and compose from it, rather than concatenate uid strings.
+
+  handle(), childHandle() and childUid() register the uids that they are given. Queries such as
+  find() and serviceTypeFromUid() never do, so passing arbitrary uids to them does not grow the
+  registry.
+
+  Handle 0 is the invalid handle. Handles are never released, as the set of uids registered by the
+  UI is bounded by the item tree of the backend.
+*/
+class UidRegistry : public QObject
+{
+	Q_OBJECT
+	QML_ELEMENT
+	QML_SINGLETON
+
+public:
+	static UidRegistry* create(QQmlEngine *engine = nullptr, QJSEngine *jsEngine = nullptr);
+
+	// Returns the handle of the uid, registering it first if needed.
+	Q_INVOKABLE int handle(const QString &uid);
+
+	// Returns the handle of the uid if it is registered, or 0 otherwise.
+	Q_INVOKABLE int find(const QString &uid) const;
+
+	// Returns the handle of <parent uid>/<path>, where the path may have several segments.
+	Q_INVOKABLE int childHandle(int parent, const QString &path);
+
+	Q_INVOKABLE QString uid(int handle) const;
+	Q_INVOKABLE int parentHandle(int handle) const;
+
+	// Returns the uid of <parentUid>/<path>, e.g. childUid(bindPrefix, "History/Daily/3").
+	Q_INVOKABLE QString childUid(const QString &parentUid, const QString &path);
+
+	// Returns the service type (e.g. "battery") of the service that the uid belongs to.
+	Q_INVOKABLE QString serviceType(int handle) const;
+	Q_INVOKABLE QString serviceTypeFromUid(const QString &uid) const;
+
+	// Returns the uid of the service that the uid belongs to, e.g. "mqtt/battery/512".
+	Q_INVOKABLE QString serviceUid(int handle) const;
+
+	// Returns the device instance in the uid (MQTT uids only), or -1 if it is not known.
+	Q_INVOKABLE int deviceInstance(int handle) const;
+
+	Q_INVOKABLE int count() const;
+
+	// An estimate of the heap memory used by the registry, in bytes.
+	Q_INVOKABLE qint64 memoryUsage() const;
+
+private:
+	struct Node {
+		QString segment;
+		QString serviceType;
+		mutable QString uid;       // composed and cached by uid()
+		QVector<int> children;     // sorted by segment
+		int parent = 0;
+		int service = 0;
+		int deviceInstance = -1;
+	};
+
+	explicit UidRegistry(QObject *parent = nullptr);
+
+	static QString serviceTypeOf(QStringView serviceSegment, bool mqtt);
+
+	QVector<int>::const_iterator lowerBound(int parent, QStringView segment) const;
+	int findChild(int parent, QStringView segment) const;
+	int findOrAddChild(int parent, QStringView segment);
+	int walk(int handle, QStringView path);
+	int rootOf(int handle) const;
+	const Node *node(int handle) const;
+
+	QVector<Node> m_nodes;
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_UIDREGISTRY_H
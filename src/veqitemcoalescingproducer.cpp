@@ -0,0 +1,496 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include "veqitemcoalescingproducer.h"
+#include "logging.h"
+
+#include <QQuickWindow>
+#include <QtCore/QMetaMethod>
+
+#include <utility>
+
+namespace Victron {
+
+namespace VenusOS {
+
+namespace {
+
+// Used when frames are being rendered, in case the window stops rendering while changes are pending.
+const int FrameFlushTimeout = 250;
+
+// Used when there is no window, or it is not exposed.
+const int TimerFlushInterval = 16;
+
+// How long to wait for the source value to change after a write, before sending the next one.
+const int WriteTimeout = 1000;
+
+bool isConsumerSignal(const QMetaMethod &signal)
+{
+	static const QMetaMethod valueChangedSignal = QMetaMethod::fromSignal(&VeQItem::valueChanged);
+	static const QMetaMethod stateChangedSignal = QMetaMethod::fromSignal(&VeQItem::stateChanged);
+	static const QMetaMethod childAddedSignal = QMetaMethod::fromSignal(&VeQItem::childAdded);
+	return signal == valueChangedSignal || signal == stateChangedSignal || signal == childAddedSignal;
+}
+
+}
+
+VeQItemCoalesced::VeQItemCoalesced(VeQItemCoalescingProducer *producer)
+	: VeQItem(producer)
+	, m_producer(producer)
+{
+}
+
+int VeQItemCoalesced::setValue(QVariant const &value)
+{
+	if (!m_sourceItem) {
+		// The item was created from QML and the backend has not published it yet; create it in
+		// the source tree so that the backend can handle the write.
+		m_producer->createSourceItem(this);
+		m_producer->bindToSource(this);
+	}
+	if (!m_sourceItem) {
+		return -1;
+	}
+
+	produceValue(value);
+	if (m_writeInFlight) {
+		if (m_hasQueuedWrite) {
+			m_producer->m_coalescedWriteCount++;
+		}
+		m_queuedWrite = value;
+		m_hasQueuedWrite = true;
+		return 0;
+	}
+	return sendWrite(value);
+}
+
+int VeQItemCoalesced::sendWrite(const QVariant &value)
+{
+	if (m_sourceItem->getValue() == value) {
+		// The source will not change, so there is nothing to wait for.
+		return m_sourceItem->setValue(value);
+	}
+	m_writeInFlight = true;
+	m_writtenValue = value;
+	const int serial = ++m_writeSerial;
+	QTimer::singleShot(WriteTimeout, this, [this, serial] {
+		if (serial == m_writeSerial) {
+			m_hasUnconfirmedWrite = false;
+			writeFinished();
+		}
+	});
+	return m_sourceItem->setValue(value);
+}
+
+void VeQItemCoalesced::sourceValueChanged()
+{
+	const QVariant value = m_sourceItem->getValue();
+	if (value == m_writtenValue) {
+		m_hasUnconfirmedWrite = false;
+		writeFinished();
+	} else if (m_hasUnconfirmedWrite && value == m_unconfirmedWrite) {
+		// The late confirmation of the previous write.
+		m_hasUnconfirmedWrite = false;
+	} else if (m_hasQueuedWrite) {
+		// The backend answered the write in flight with another value; the queued write replaces
+		// it anyway, so send it now.
+		m_hasUnconfirmedWrite = true;
+		m_unconfirmedWrite = m_writtenValue;
+		writeFinished();
+	}
+	// Otherwise, keep showing the written value until it is confirmed or the write times out.
+}
+
+void VeQItemCoalesced::writeFinished()
+{
+	m_writeInFlight = false;
+	m_writeSerial++;
+	if (m_hasQueuedWrite && m_sourceItem) {
+		m_hasQueuedWrite = false;
+		sendWrite(std::exchange(m_queuedWrite, QVariant()));
+	} else {
+		// Show the source value, in case the backend did not accept the written value.
+		m_hasQueuedWrite = false;
+		m_producer->queueUpdate(this);
+	}
+}
+
+VeQItem *VeQItemCoalesced::sourceItem() const
+{
+	return m_sourceItem.data();
+}
+
+void VeQItemCoalesced::setSourceItem(VeQItem *sourceItem)
+{
+	m_sourceItem = sourceItem;
+}
+
+bool VeQItemCoalesced::hasConsumers() const
+{
+	return isSignalConnected(QMetaMethod::fromSignal(&VeQItem::valueChanged))
+			|| isSignalConnected(QMetaMethod::fromSignal(&VeQItem::stateChanged))
+			|| isSignalConnected(QMetaMethod::fromSignal(&VeQItem::childAdded));
+}
+
+void VeQItemCoalesced::connectNotify(const QMetaMethod &signal)
+{
+	VeQItem::connectNotify(signal);
+	if (!isConsumerSignal(signal)) {
+		return;
+	}
+	if (!m_sourceItem && m_producer->bindToSource(this)) {
+		// Show the source value straight away, as the consumer reads it after connecting.
+		applySourceValue();
+	}
+	if (signal == QMetaMethod::fromSignal(&VeQItem::childAdded) && !m_mirrorChildren) {
+		// Mirror the children later rather than while the consumer is connecting, so that it
+		// does not see them both through childAdded() and in itemChildren().
+		m_mirrorChildren = true;
+		QPointer<VeQItemCoalesced> item(this);
+		QMetaObject::invokeMethod(m_producer, [item] {
+			if (item) {
+				item->m_producer->mirrorChildren(item);
+			}
+		}, Qt::QueuedConnection);
+	}
+	emit m_producer->itemConsumed(this);
+}
+
+bool VeQItemCoalesced::applySourceValue()
+{
+	m_pending = false;
+	if (!m_sourceItem || m_writeInFlight || m_hasQueuedWrite || m_producer->holdUpdate(this)) {
+		return false;
+	}
+	m_held = false;
+	const QVariant value = m_sourceItem->getValue();
+	const State state = m_sourceItem->getState();
+	if (value == getValue() && state == getState()) {
+		return false;
+	}
+	if (m_producer->m_resyncing) {
+		m_producer->m_resyncChangeCount++;
+	}
+	produceValue(value, state);
+	return true;
+}
+
+
+VeQItemCoalescingProducer::VeQItemCoalescingProducer(VeQItem *root, const QString &id, VeQItem *sourceRoot, QObject *parent)
+	: VeQItemProducer(root, id, parent)
+	, m_sourceRoot(sourceRoot)
+{
+	m_flushTimer.setSingleShot(true);
+	connect(&m_flushTimer, &QTimer::timeout, this, &VeQItemCoalescingProducer::flush);
+
+	if (sourceRoot) {
+		mirrorItem(sourceRoot, mProducerRoot);
+	}
+}
+
+VeQItem *VeQItemCoalescingProducer::createItem()
+{
+	return new VeQItemCoalesced(this);
+}
+
+void VeQItemCoalescingProducer::setWindow(QQuickWindow *window)
+{
+	if (m_window == window) {
+		return;
+	}
+	if (m_window) {
+		m_window->disconnect(this);
+	}
+	m_window = window;
+	if (m_window) {
+		connect(m_window, &QQuickWindow::afterAnimating, this, &VeQItemCoalescingProducer::flush);
+	}
+}
+
+qint64 VeQItemCoalescingProducer::droppedUpdateCount() const
+{
+	return m_droppedUpdateCount;
+}
+
+qint64 VeQItemCoalescingProducer::coalescedWriteCount() const
+{
+	return m_coalescedWriteCount;
+}
+
+void VeQItemCoalescingProducer::flush()
+{
+	m_flushTimer.stop();
+	if (m_pendingItems.isEmpty()) {
+		return;
+	}
+
+	// Applying a value may cause QML to write values or create items, which can queue further
+	// updates; those are applied in the next flush.
+	QVector<QPointer<VeQItemCoalesced> > items;
+	items.swap(m_pendingItems);
+	for (const QPointer<VeQItemCoalesced> &item : items) {
+		if (item) {
+			item->applySourceValue();
+		}
+	}
+
+	if (m_lastReportedDroppedUpdateCount != m_droppedUpdateCount) {
+		m_lastReportedDroppedUpdateCount = m_droppedUpdateCount;
+		emit droppedUpdateCountChanged();
+	}
+}
+
+void VeQItemCoalescingProducer::mirrorItem(VeQItem *sourceItem, VeQItem *mirrorItem)
+{
+	VeQItemCoalesced *mirror = qobject_cast<VeQItemCoalesced *>(mirrorItem);
+	if (mirror) {
+		mirror->setSourceItem(sourceItem);
+		connect(sourceItem, &VeQItem::valueChanged, mirror, [this, mirror] {
+			if (mirror->m_writeInFlight) {
+				mirror->sourceValueChanged();
+			}
+			queueUpdate(mirror);
+		});
+		connect(sourceItem, &VeQItem::stateChanged, mirror, [this, mirror] {
+			if (mirror->m_writeInFlight) {
+				mirror->writeFinished();
+			}
+			queueUpdate(mirror);
+		});
+		if (sourceItem->getState() != VeQItem::Idle) {
+			queueUpdate(mirror);
+		}
+	}
+
+	connect(sourceItem, &VeQItem::childAdded, mirrorItem, [this, mirrorItem](VeQItem *child) {
+		if (mirrorsChild(mirrorItem, child->id())) {
+			mirrorChild(child, mirrorItem);
+		}
+	});
+	connect(sourceItem, &VeQItem::childAboutToBeRemoved, mirrorItem, [this, mirrorItem](VeQItem *child) {
+		unmirrorChild(child, mirrorItem);
+	});
+
+	for (VeQItem *child : sourceItem->itemChildren()) {
+		if (mirrorsChild(mirrorItem, child->id())) {
+			mirrorChild(child, mirrorItem);
+		}
+	}
+}
+
+bool VeQItemCoalescingProducer::mirrorsChild(VeQItem *mirrorItem, const QString &childId) const
+{
+	// The services are always mirrored. Below them, a child is mirrored if something consumes the
+	// children of its parent, or if it was already created in the mirror tree, e.g. by QML.
+	if (mirrorItem == mProducerRoot) {
+		return true;
+	}
+	const VeQItemCoalesced *mirror = qobject_cast<VeQItemCoalesced *>(mirrorItem);
+	return (mirror && mirror->m_mirrorChildren) || mirrorItem->itemChildren().contains(childId);
+}
+
+void VeQItemCoalescingProducer::mirrorChild(VeQItem *sourceChild, VeQItem *mirrorParent)
+{
+	// If QML has already requested this uid, the item exists in the mirror tree and is reused.
+	VeQItem *mirrorChild = mirrorParent->itemGetOrCreate(sourceChild->id(), sourceChild->isLeaf());
+	const VeQItemCoalesced *mirror = qobject_cast<VeQItemCoalesced *>(mirrorChild);
+	if (mirror && mirror->m_sourceItem == sourceChild) {
+		return;
+	}
+	mirrorItem(sourceChild, mirrorChild);
+}
+
+void VeQItemCoalescingProducer::mirrorChildren(VeQItemCoalesced *mirrorItem)
+{
+	mirrorItem->m_mirrorChildren = true;
+	if (VeQItem *source = bindToSource(mirrorItem)) {
+		for (VeQItem *child : source->itemChildren()) {
+			mirrorChild(child, mirrorItem);
+		}
+	}
+}
+
+VeQItem *VeQItemCoalescingProducer::bindToSource(VeQItem *mirrorItem)
+{
+	if (mirrorItem == mProducerRoot) {
+		return m_sourceRoot;
+	}
+	VeQItemCoalesced *mirror = qobject_cast<VeQItemCoalesced *>(mirrorItem);
+	if (!mirror) {
+		return nullptr;
+	}
+	if (mirror->m_sourceItem) {
+		return mirror->m_sourceItem;
+	}
+
+	// Bind the parents first, so that the removal of the source is seen. Binding a parent also
+	// binds its existing children, including this one.
+	VeQItem *parentSource = bindToSource(mirror->itemParent());
+	if (mirror->m_sourceItem) {
+		return mirror->m_sourceItem;
+	}
+	VeQItem *source = parentSource ? parentSource->itemChildren().value(mirror->id()) : nullptr;
+	if (source) {
+		this->mirrorItem(source, mirror);
+	}
+	return source;
+}
+
+void VeQItemCoalescingProducer::unmirrorChild(VeQItem *sourceChild, VeQItem *mirrorParent)
+{
+	VeQItem *mirrorChild = mirrorParent->itemChildren().value(sourceChild->id());
+	if (!mirrorChild) {
+		return;
+	}
+	if (VeQItemCoalesced *mirror = qobject_cast<VeQItemCoalesced *>(mirrorChild)) {
+		mirror->setSourceItem(nullptr);
+		if (mirror->m_pending) {
+			mirror->m_pending = false;
+			m_pendingItems.removeOne(mirror);
+		}
+	}
+	if (m_resyncing) {
+		// Keep the item until the resync ends, in case the source publishes it again; the
+		// source of its descendants is cleared when the source items are deleted.
+		m_detachedItems.append(mirrorChild);
+		return;
+	}
+	mirrorChild->itemDelete();
+}
+
+VeQItem *VeQItemCoalescingProducer::createSourceItem(VeQItemCoalesced *mirrorItem)
+{
+	if (!m_sourceRoot) {
+		return nullptr;
+	}
+	const QString uid = relativeUid(mirrorItem);
+	if (uid.isEmpty()) {
+		return nullptr;
+	}
+
+	// Creating the source item emits childAdded() in the source tree, which sets the source of
+	// the mirror item via mirrorChild().
+	return m_sourceRoot->itemGetOrCreate(uid, true, true);
+}
+
+QString VeQItemCoalescingProducer::relativeUid(VeQItem *item) const
+{
+	const QString rootUid = mProducerRoot->uniqueId();
+	const QString uid = item->uniqueId();
+	return uid.startsWith(rootUid + QLatin1Char('/')) ? uid.mid(rootUid.length() + 1) : QString();
+}
+
+void VeQItemCoalescingProducer::beginResync()
+{
+	if (m_resyncing) {
+		return;
+	}
+	m_resyncing = true;
+	m_resyncChangeCount = 0;
+	m_resyncTimer.start();
+}
+
+void VeQItemCoalescingProducer::endResync()
+{
+	if (!m_resyncing) {
+		return;
+	}
+	flush();
+	m_resyncing = false;
+
+	// Items that were published again during the resync are no longer held; the others take
+	// the value of their source now, which only counts as invalidated if it differs from the
+	// value that was held.
+	QVector<QPointer<VeQItemCoalesced> > heldItems;
+	heldItems.swap(m_heldItems);
+	int invalidatedCount = 0;
+	for (const QPointer<VeQItemCoalesced> &item : heldItems) {
+		if (item && item->m_held) {
+			item->m_held = false;
+			if (item->m_sourceItem && item->applySourceValue()) {
+				invalidatedCount++;
+			}
+		}
+	}
+
+	int removedCount = 0;
+	QVector<QPointer<VeQItem> > detachedItems;
+	detachedItems.swap(m_detachedItems);
+	for (const QPointer<VeQItem> &item : detachedItems) {
+		if (item) {
+			removedCount += removeDetached(item);
+		}
+	}
+
+	qCInfo(venusGui) << "Resynchronized" << mProducerRoot->uniqueId() << "in" << m_resyncTimer.elapsed() << "ms:"
+			<< m_resyncChangeCount << "changed values," << invalidatedCount << "invalidated and"
+			<< removedCount << "removed items";
+}
+
+bool VeQItemCoalescingProducer::isResyncing() const
+{
+	return m_resyncing;
+}
+
+bool VeQItemCoalescingProducer::holdUpdate(VeQItemCoalesced *mirrorItem)
+{
+	if (!m_resyncing) {
+		return false;
+	}
+	VeQItem *source = mirrorItem->m_sourceItem;
+	if (source->getValue().isValid() && source->getState() != VeQItem::Offline) {
+		return false;
+	}
+	if (!mirrorItem->m_held) {
+		mirrorItem->m_held = true;
+		m_heldItems.append(mirrorItem);
+	}
+	return true;
+}
+
+int VeQItemCoalescingProducer::removeDetached(VeQItem *mirrorItem)
+{
+	// An item is still detached if its source was not published again during the resync. Its
+	// children may have been published again if the item itself was, so only they are checked.
+	VeQItemCoalesced *mirror = qobject_cast<VeQItemCoalesced *>(mirrorItem);
+	if (mirror && !mirror->m_sourceItem) {
+		mirrorItem->itemDelete();
+		return 1;
+	}
+	int removedCount = 0;
+	const QList<VeQItem *> children = mirrorItem->itemChildren().values();
+	for (VeQItem *child : children) {
+		removedCount += removeDetached(child);
+	}
+	return removedCount;
+}
+
+void VeQItemCoalescingProducer::queueUpdate(VeQItemCoalesced *mirrorItem)
+{
+	if (mirrorItem->m_pending) {
+		m_droppedUpdateCount++;
+		return;
+	}
+	mirrorItem->m_pending = true;
+	m_pendingItems.append(mirrorItem);
+	scheduleFlush();
+}
+
+void VeQItemCoalescingProducer::scheduleFlush()
+{
+	if (m_flushTimer.isActive()) {
+		return;
+	}
+	if (m_window && m_window->isExposed()) {
+		m_window->update();
+		m_flushTimer.start(FrameFlushTimeout);
+	} else {
+		m_flushTimer.start(TimerFlushInterval);
+	}
+}
+
+} /* VenusOS */
+
+} /* Victron */
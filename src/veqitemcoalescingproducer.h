@@ -0,0 +1,177 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_VEQITEMCOALESCINGPRODUCER_H
+#define VICTRON_VENUSOS_GUI_V2_VEQITEMCOALESCINGPRODUCER_H
+
+#include "veutil/qt/ve_qitem.hpp"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QPointer>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
+
+class QQuickWindow;
+
+namespace Victron {
+
+namespace VenusOS {
+
+class VeQItemCoalescingProducer;
+
+/*
+  An item in the GUI-facing tree. It mirrors an item from the source producer (which may not
+  exist yet, if the item was requested from QML before the backend published it) and forwards
+  writes to that source item.
+
+  Writes are coalesced, so that e.g. dragging a slider does not cause a round trip to the backend
+  for every intermediate value. At most one write is in flight at a time: it completes when the
+  source takes the written value or changes state, or after a timeout. Writing the current source
+  value completes straight away, as the source does not change. Writes made in the meantime
+  replace each other, and only the newest one is sent when the write in flight completes, so the
+  final value is always written.
+
+  The written value is shown straight away, and is kept until the write is confirmed or times out,
+  so a source change in between (e.g. a value clamped by the backend, or published by another
+  client) does not make the item flicker back to it. Such a change only sends the queued write
+  early, as the backend has answered the write in flight; the late confirmation of that write
+  then neither completes the queued write nor is shown.
+*/
+class VeQItemCoalesced : public VeQItem
+{
+	Q_OBJECT
+
+public:
+	VeQItemCoalesced(VeQItemCoalescingProducer *producer);
+
+	int setValue(QVariant const &value) override;
+
+	VeQItem *sourceItem() const;
+	void setSourceItem(VeQItem *sourceItem);
+
+	// Returns true if anything (e.g. a VeQuickItem or VeQItemTableModel) is connected to the
+	// value, state or children of this item.
+	bool hasConsumers() const;
+
+protected:
+	void connectNotify(const QMetaMethod &signal) override;
+
+private:
+	friend class VeQItemCoalescingProducer;
+	bool applySourceValue();     // returns true if the value or state changed
+	int sendWrite(const QVariant &value);
+	void sourceValueChanged();
+	void writeFinished();
+
+	VeQItemCoalescingProducer *m_producer = nullptr;
+	QPointer<VeQItem> m_sourceItem;
+	QVariant m_writtenValue;
+	QVariant m_queuedWrite;
+	QVariant m_unconfirmedWrite;
+	int m_writeSerial = 0;
+	bool m_pending = false;
+	bool m_held = false;
+	bool m_writeInFlight = false;
+	bool m_hasQueuedWrite = false;
+	bool m_hasUnconfirmedWrite = false;
+	bool m_mirrorChildren = false;     // true once something consumes the children
+};
+
+/*
+  Sits between a backend producer (MQTT or D-Bus) and the QML layer.
+
+  The backend producer populates its own "source" tree, and this producer mirrors that tree under
+  its own id, which is the tree seen by VeQuickItem and VeQItemTableModel.
+
+  Only the part of the tree that is used is mirrored, so the coalescing does not double the number
+  of items. The services are always mirrored; below them, an item is mirrored when it is created
+  in the mirror tree (e.g. by a VeQuickItem or ServiceDevice), and the children of an item are
+  mirrored once something connects to its childAdded() signal (e.g. a VeQItemTableModel). An item
+  created before its source exists is bound to the source when the backend publishes it.
+
+  Value and state changes from the source are collected per item and only the latest one is kept,
+  then they are applied together once per frame. A burst of 50 updates to /Dc/Battery/Power
+  between two frames therefore causes a single valueChanged() on the mirrored item, and a single
+  binding re-evaluation.
+
+  Frames are detected with QQuickWindow::afterAnimating(), which is emitted on the GUI thread just
+  before the scene graph is synchronized. If there is no window, or the window is not rendering
+  (e.g. it is hidden), pending changes are flushed from a timer instead.
+
+  When the backend reconnects, it publishes all values again and may invalidate or remove source
+  items in the meantime. Between beginResync() and endResync(), the mirrored tree keeps its last
+  known values instead: source items that become invalid are held back, and mirrored items whose
+  source is removed are kept. Values that are published again unchanged do not cause any change
+  in the mirrored tree. When the resync ends, held items take the current value of their source,
+  and kept items whose source was not published again are removed, so only items that really
+  disappeared while disconnected are invalidated.
+*/
+class VeQItemCoalescingProducer : public VeQItemProducer
+{
+	Q_OBJECT
+
+public:
+	VeQItemCoalescingProducer(VeQItem *root, const QString &id, VeQItem *sourceRoot, QObject *parent = nullptr);
+
+	VeQItem *createItem() override;
+
+	void setWindow(QQuickWindow *window);
+
+	// The number of source updates that were replaced by a newer update before being applied.
+	qint64 droppedUpdateCount() const;
+
+	// The number of writes that were replaced by a newer write before being sent.
+	qint64 coalescedWriteCount() const;
+
+	void flush();
+
+	// Returns the uid of the item relative to the root of this producer, e.g. "battery/512/Soc".
+	QString relativeUid(VeQItem *item) const;
+
+	void beginResync();
+	void endResync();
+	bool isResyncing() const;
+
+Q_SIGNALS:
+	void droppedUpdateCountChanged();
+
+	// Emitted when something connects to the value, state or children of a mirrored item.
+	void itemConsumed(VeQItem *item);
+
+private:
+	friend class VeQItemCoalesced;
+
+	void mirrorItem(VeQItem *sourceItem, VeQItem *mirrorItem);
+	bool mirrorsChild(VeQItem *mirrorItem, const QString &childId) const;
+	void mirrorChild(VeQItem *sourceChild, VeQItem *mirrorParent);
+	void mirrorChildren(VeQItemCoalesced *mirrorItem);
+	VeQItem *bindToSource(VeQItem *mirrorItem);
+	void unmirrorChild(VeQItem *sourceChild, VeQItem *mirrorParent);
+	VeQItem *createSourceItem(VeQItemCoalesced *mirrorItem);
+	void queueUpdate(VeQItemCoalesced *mirrorItem);
+	void scheduleFlush();
+	bool holdUpdate(VeQItemCoalesced *mirrorItem);
+	int removeDetached(VeQItem *mirrorItem);
+
+	QPointer<VeQItem> m_sourceRoot;
+	QPointer<QQuickWindow> m_window;
+	QVector<QPointer<VeQItemCoalesced> > m_pendingItems;
+	QTimer m_flushTimer;
+	qint64 m_droppedUpdateCount = 0;
+	qint64 m_lastReportedDroppedUpdateCount = 0;
+	qint64 m_coalescedWriteCount = 0;
+
+	QVector<QPointer<VeQItemCoalesced> > m_heldItems;
+	QVector<QPointer<VeQItem> > m_detachedItems;
+	QElapsedTimer m_resyncTimer;
+	int m_resyncChangeCount = 0;
+	bool m_resyncing = false;
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_VEQITEMCOALESCINGPRODUCER_H
@@ -6,11 +6,218 @@
 #include "veqitemmockproducer.h"
 #include "enums.h"
 #include "theme.h"
+#include "logging.h"
+
+#include <QtCore/QStringList>
+#include <QtCore/QTimer>
+
+#include <algorithm>
 
 namespace Victron {
 
 namespace VenusOS {
 
+namespace {
+
+struct MockPathRange {
+	const char *path;
+	double min;
+	double max;
+	double step;    // maximum change per update
+};
+
+// The paths that change over time for each generated service type, and their value ranges.
+const QHash<QString, QVector<MockPathRange> > &fleetDynamicPaths()
+{
+	static const QHash<QString, QVector<MockPathRange> > paths = {
+		{ QStringLiteral("battery"), {
+			{ "/Soc", 0, 100, 0.5 },
+			{ "/Dc/0/Voltage", 46, 57, 0.1 },
+			{ "/Dc/0/Current", -100, 100, 5 },
+			{ "/Dc/0/Power", -5000, 5000, 250 },
+			{ "/Dc/0/Temperature", 5, 40, 0.2 },
+			{ "/TimeToGo", 0, 864000, 600 },
+		} },
+		{ QStringLiteral("solarcharger"), {
+			{ "/Yield/Power", 0, 4000, 100 },
+			{ "/Dc/0/Voltage", 24, 29, 0.1 },
+			{ "/Dc/0/Current", 0, 100, 3 },
+			{ "/Dc/0/Temperature", 10, 60, 0.2 },
+			{ "/Pv/V", 0, 150, 2 },
+		} },
+		{ QStringLiteral("tank"), {
+			{ "/Level", 0, 100, 0.5 },
+			{ "/Remaining", 0, 0.2, 0.001 },
+			{ "/Temperature", 0, 40, 0.2 },
+		} },
+	};
+	return paths;
+}
+
+QString fleetServiceUid(const QString &serviceType, int index)
+{
+	return QStringLiteral("com.victronenergy.%1.fleet_%2").arg(serviceType).arg(index);
+}
+
+}
+
+MockFleetConfig MockFleetConfig::fromString(const QString &serviceCounts)
+{
+	MockFleetConfig config;
+	const QStringList entries = serviceCounts.split(QLatin1Char(','), Qt::SkipEmptyParts);
+	for (const QString &entry : entries) {
+		const QStringList parts = entry.split(QLatin1Char('='));
+		bool ok = false;
+		const int count = parts.count() == 2 ? parts.at(1).trimmed().toInt(&ok) : 0;
+		const QString serviceType = parts.value(0).trimmed();
+		if (!ok || count < 0 || !fleetDynamicPaths().contains(serviceType)) {
+			qCWarning(venusGui) << "Ignoring invalid mock fleet entry:" << entry
+					<< "- supported service types are" << fleetDynamicPaths().keys();
+			continue;
+		}
+		config.serviceCounts.insert(serviceType, count);
+	}
+	return config;
+}
+
+bool MockFleetConfig::isEmpty() const
+{
+	for (int count : serviceCounts) {
+		if (count > 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+MockNetworkConditions MockNetworkConditions::fromString(const QString &conditions)
+{
+	QVariantMap map;
+	const QStringList entries = conditions.split(QLatin1Char(','), Qt::SkipEmptyParts);
+	for (const QString &entry : entries) {
+		const QStringList parts = entry.split(QLatin1Char('='));
+		if (parts.count() != 2) {
+			qCWarning(venusGui) << "Ignoring invalid mock network condition:" << entry;
+			continue;
+		}
+		map.insert(parts.at(0).trimmed(), parts.at(1).trimmed());
+	}
+	return fromVariantMap(map);
+}
+
+MockNetworkConditions MockNetworkConditions::fromVariantMap(const QVariantMap &conditions)
+{
+	MockNetworkConditions result;
+	for (auto it = conditions.constBegin(); it != conditions.constEnd(); ++it) {
+		bool ok = false;
+		const double value = it.value().toDouble(&ok);
+		if (!ok || value < 0) {
+			qCWarning(venusGui) << "Ignoring invalid mock network condition:" << it.key() << it.value();
+		} else if (it.key() == QStringLiteral("latency")) {
+			result.latency = qRound(value);
+		} else if (it.key() == QStringLiteral("jitter")) {
+			result.jitter = qRound(value);
+		} else if (it.key() == QStringLiteral("burst")) {
+			result.burstInterval = qRound(value);
+		} else if (it.key() == QStringLiteral("drop")) {
+			result.dropRate = qMin(value, 1.0);
+		} else if (it.key() == QStringLiteral("seed")) {
+			result.seed = quint32(value);
+		} else {
+			qCWarning(venusGui) << "Ignoring unknown mock network condition:" << it.key()
+					<< "- supported conditions are latency, jitter, burst, drop and seed";
+		}
+	}
+	return result;
+}
+
+QVariantMap MockNetworkConditions::toVariantMap() const
+{
+	return {
+		{ QStringLiteral("latency"), latency },
+		{ QStringLiteral("jitter"), jitter },
+		{ QStringLiteral("burst"), burstInterval },
+		{ QStringLiteral("drop"), dropRate },
+		{ QStringLiteral("seed"), seed },
+	};
+}
+
+bool MockNetworkConditions::isEmpty() const
+{
+	return latency <= 0 && jitter <= 0 && burstInterval <= 0 && dropRate <= 0;
+}
+
+MockFleetGenerator::MockFleetGenerator(const MockFleetConfig &config)
+	: m_config(config)
+	, m_random(config.seed)
+{
+	// Device instances start at 100 to stay clear of the devices created by the mock QML.
+	int deviceInstance = 100;
+	for (auto it = config.serviceCounts.constBegin(); it != config.serviceCounts.constEnd(); ++it) {
+		const QVector<MockPathRange> &ranges = fleetDynamicPaths().value(it.key());
+		for (int i = 0; i < it.value(); ++i) {
+			const QString serviceUid = fleetServiceUid(it.key(), i);
+			m_staticValues.append({ serviceUid + "/DeviceInstance", deviceInstance++ });
+			m_staticValues.append({ serviceUid + "/ProductName", QStringLiteral("Fleet %1").arg(it.key()) });
+			m_staticValues.append({ serviceUid + "/CustomName", QStringLiteral("Fleet %1 %2").arg(it.key()).arg(i) });
+			m_staticValues.append({ serviceUid + "/Connected", 1 });
+			m_staticValues.append({ serviceUid + "/ProductId", 0xFFFF });
+			if (it.key() == QStringLiteral("tank")) {
+				m_staticValues.append({ serviceUid + "/FluidType", i % 6 });
+				m_staticValues.append({ serviceUid + "/Capacity", 0.2 });
+				m_staticValues.append({ serviceUid + "/Status", 0 });
+			} else if (it.key() == QStringLiteral("solarcharger")) {
+				m_staticValues.append({ serviceUid + "/State", 3 });  // bulk
+				m_staticValues.append({ serviceUid + "/ErrorCode", 0 });
+				m_staticValues.append({ serviceUid + "/NrOfTrackers", 1 });
+			}
+
+			for (const MockPathRange &range : ranges) {
+				const double value = range.min + m_random.generateDouble() * (range.max - range.min);
+				m_dynamicPaths.append({ serviceUid + QLatin1String(range.path), value, range.min, range.max, range.step });
+			}
+		}
+	}
+}
+
+MockValueBatch MockFleetGenerator::initialValues() const
+{
+	MockValueBatch values = m_staticValues;
+	values.reserve(values.count() + m_dynamicPaths.count());
+	for (const DynamicPath &path : m_dynamicPaths) {
+		values.append({ path.uid, path.value });
+	}
+	return values;
+}
+
+void MockFleetGenerator::start()
+{
+	// The timer is created here rather than in the constructor, so that it lives in the worker thread.
+	if (!m_timer) {
+		m_timer = new QTimer(this);
+		connect(m_timer, &QTimer::timeout, this, &MockFleetGenerator::generate);
+	}
+	// Update a tenth of the paths on each tick, so that the changes are spread over the second.
+	m_timer->start(qMax(1, qRound(100 / qMax(m_config.updateRate, qreal(0.01)))));
+}
+
+void MockFleetGenerator::generate()
+{
+	MockValueBatch values;
+	values.reserve(m_dynamicPaths.count() / 10 + 1);
+	for (DynamicPath &path : m_dynamicPaths) {
+		if (m_random.bounded(10) != 0) {
+			continue;
+		}
+		const double delta = (m_random.generateDouble() * 2 - 1) * path.step;
+		path.value = qBound(path.min, path.value + delta, path.max);
+		values.append({ path.uid, path.value });
+	}
+	if (!values.isEmpty()) {
+		emit valuesGenerated(values);
+	}
+}
+
 VeQItemMock::VeQItemMock(VeQItemMockProducer *producer)
 	: VeQItem(producer)
 	, m_producer(producer)
@@ -18,15 +225,29 @@ VeQItemMock::VeQItemMock(VeQItemMockProducer *producer)
 }
 
 int VeQItemMock::setValue(QVariant const &value)
+{
+	m_producer->writeValue(this, value);
+	return 0;
+}
+
+void VeQItemMock::applyWrite(const QVariant &value)
 {
 	VeQItem::setValue(value);
 	produceValue(value);
-	return 0;
 }
 
 VeQItemMockProducer::VeQItemMockProducer(VeQItem *root, const QString &id, QObject *parent)
 	: VeQItemProducer(root, id, parent)
 {
+	m_deliveryTimer.setSingleShot(true);
+	connect(&m_deliveryTimer, &QTimer::timeout, this, &VeQItemMockProducer::deliverPending);
+	m_networkClock.start();
+}
+
+VeQItemMockProducer::~VeQItemMockProducer()
+{
+	stopFleet();
+	stopScenario();
 }
 
 void VeQItemMockProducer::initialize()
@@ -57,6 +278,15 @@ void VeQItemMockProducer::initialize()
 }
 
 void VeQItemMockProducer::setValue(const QString &uid, const QVariant &value)
+{
+	if (m_networkConditions.isEmpty()) {
+		applyValue(uid, value);
+	} else {
+		scheduleDelivery({ 0, uid, nullptr, value }, 0, &m_lastReadDue);
+	}
+}
+
+void VeQItemMockProducer::applyValue(const QString &uid, const QVariant &value)
 {
 	const QString normalizedUid = this->normalizedUid(uid);
 	m_values.insert(normalizedUid, value);
@@ -65,6 +295,203 @@ void VeQItemMockProducer::setValue(const QString &uid, const QVariant &value)
 	item->produceValue(value);
 }
 
+void VeQItemMockProducer::setWriteLatency(int msecs)
+{
+	m_writeLatency = qMax(0, msecs);
+}
+
+int VeQItemMockProducer::writeLatency() const
+{
+	return m_writeLatency;
+}
+
+int VeQItemMockProducer::writeCount() const
+{
+	return m_writeCount;
+}
+
+void VeQItemMockProducer::setNetworkConditions(const MockNetworkConditions &conditions)
+{
+	m_networkConditions = conditions;
+	m_networkRandom.seed(conditions.seed);
+	if (conditions.isEmpty()) {
+		qCInfo(venusGui) << "Mock network conditions cleared";
+	} else {
+		qCInfo(venusGui) << "Mock network conditions:" << conditions.latency << "ms latency,"
+				<< conditions.jitter << "ms jitter," << conditions.burstInterval << "ms burst interval,"
+				<< conditions.dropRate * 100 << "% dropped, seed" << conditions.seed;
+	}
+}
+
+MockNetworkConditions VeQItemMockProducer::networkConditions() const
+{
+	return m_networkConditions;
+}
+
+int VeQItemMockProducer::droppedCount() const
+{
+	return m_droppedCount;
+}
+
+void VeQItemMockProducer::writeValue(VeQItemMock *item, const QVariant &value)
+{
+	m_writeCount++;
+	if (m_networkConditions.isEmpty() && m_writeLatency <= 0) {
+		item->applyWrite(value);
+		return;
+	}
+	scheduleDelivery({ 0, QString(), item, value }, m_writeLatency, &m_lastWriteDue);
+}
+
+void VeQItemMockProducer::scheduleDelivery(Delivery delivery, int extraLatency, qint64 *lastDue)
+{
+	const MockNetworkConditions &conditions = m_networkConditions;
+	if (!delivery.removal && conditions.dropRate > 0 && m_networkRandom.generateDouble() < conditions.dropRate) {
+		m_droppedCount++;
+		qCDebug(venusGui) << "Mock network dropped" << (delivery.writtenItem ? "write to" : "value of")
+				<< (delivery.writtenItem ? delivery.writtenItem->uniqueId() : delivery.uid);
+		return;
+	}
+
+	const int jitter = conditions.jitter > 0 ? m_networkRandom.bounded(-conditions.jitter, conditions.jitter + 1) : 0;
+	qint64 due = m_networkClock.elapsed() + extraLatency + qMax(0, conditions.latency + jitter);
+	if (conditions.burstInterval > 0) {
+		due = (due / conditions.burstInterval + 1) * conditions.burstInterval;
+	}
+	// Keep the updates in each direction in order.
+	due = qMax(due, *lastDue);
+	*lastDue = due;
+	delivery.due = due;
+
+	auto it = std::upper_bound(m_deliveries.begin(), m_deliveries.end(), due, [](qint64 value, const Delivery &d) {
+		return value < d.due;
+	});
+	const bool first = it == m_deliveries.begin();
+	m_deliveries.insert(it, delivery);
+	if (first || !m_deliveryTimer.isActive()) {
+		m_deliveryTimer.start(qMax<qint64>(0, m_deliveries.constFirst().due - m_networkClock.elapsed()));
+	}
+}
+
+void VeQItemMockProducer::deliverPending()
+{
+	const qint64 now = m_networkClock.elapsed();
+	int count = 0;
+	while (count < m_deliveries.count() && m_deliveries.at(count).due <= now) {
+		++count;
+	}
+	// Take the due updates first, as applying them may schedule more.
+	const QVector<Delivery> due = m_deliveries.mid(0, count);
+	m_deliveries.remove(0, count);
+	for (const Delivery &delivery : due) {
+		if (delivery.uid.isEmpty()) {
+			if (delivery.writtenItem) {
+				delivery.writtenItem->applyWrite(delivery.value);
+			}
+		} else if (delivery.removal) {
+			removeService(delivery.uid);
+		} else {
+			applyValue(delivery.uid, delivery.value);
+		}
+	}
+	if (!m_deliveries.isEmpty() && !m_deliveryTimer.isActive()) {
+		m_deliveryTimer.start(qMax<qint64>(0, m_deliveries.constFirst().due - m_networkClock.elapsed()));
+	}
+}
+
+void VeQItemMockProducer::startFleet(const MockFleetConfig &config)
+{
+	stopFleet();
+	if (config.isEmpty()) {
+		return;
+	}
+
+	qRegisterMetaType<MockValueBatch>();
+	MockFleetGenerator *generator = new MockFleetGenerator(config);
+	const MockValueBatch initialValues = generator->initialValues();
+	applyValues(initialValues);
+	qCInfo(venusGui) << "Generated mock fleet" << config.serviceCounts << "with" << initialValues.count()
+			<< "paths, updating at" << config.updateRate << "Hz with seed" << config.seed;
+
+	generator->moveToThread(&m_fleetThread);
+	connect(&m_fleetThread, &QThread::finished, generator, &QObject::deleteLater);
+	connect(generator, &MockFleetGenerator::valuesGenerated, this, &VeQItemMockProducer::applyValues);
+	m_fleetGenerator = generator;
+	m_fleetThread.start();
+	QMetaObject::invokeMethod(generator, &MockFleetGenerator::start);
+}
+
+void VeQItemMockProducer::stopFleet()
+{
+	if (m_fleetThread.isRunning()) {
+		m_fleetThread.quit();
+		m_fleetThread.wait();
+	}
+	m_fleetGenerator.clear();
+}
+
+void VeQItemMockProducer::startScenario(const MockScenario &scenario)
+{
+	stopScenario();
+	if (scenario.isEmpty()) {
+		return;
+	}
+
+	qRegisterMetaType<MockValueBatch>();
+	MockScenarioPlayer *player = new MockScenarioPlayer(scenario);
+	qCInfo(venusGui) << "Playing mock scenario" << scenario.name << "with" << scenario.curves.count()
+			<< "curves and" << scenario.events.count() << "events";
+
+	player->moveToThread(&m_scenarioThread);
+	connect(&m_scenarioThread, &QThread::finished, player, &QObject::deleteLater);
+	connect(player, &MockScenarioPlayer::valuesGenerated, this, &VeQItemMockProducer::applyValues);
+	connect(player, &MockScenarioPlayer::servicesRemoved, this, &VeQItemMockProducer::removeServices);
+	m_scenarioThread.start();
+	QMetaObject::invokeMethod(player, &MockScenarioPlayer::start);
+}
+
+void VeQItemMockProducer::stopScenario()
+{
+	if (m_scenarioThread.isRunning()) {
+		m_scenarioThread.quit();
+		m_scenarioThread.wait();
+	}
+}
+
+void VeQItemMockProducer::applyValues(const MockValueBatch &values)
+{
+	for (const QPair<QString, QVariant> &value : values) {
+		setValue(value.first, value.second);
+	}
+}
+
+void VeQItemMockProducer::removeServices(const QStringList &services)
+{
+	for (const QString &service : services) {
+		if (m_networkConditions.isEmpty()) {
+			removeService(service);
+		} else {
+			// Behind the values that are still on their way, so that they do not recreate the service.
+			scheduleDelivery({ 0, service, nullptr, QVariant(), true }, 0, &m_lastReadDue);
+		}
+	}
+}
+
+void VeQItemMockProducer::removeService(const QString &service)
+{
+	const QString uid = normalizedUid(service);
+	for (auto it = m_values.begin(); it != m_values.end();) {
+		if (it.key().startsWith(uid + QLatin1Char('/'))) {
+			it = m_values.erase(it);
+		} else {
+			++it;
+		}
+	}
+	if (VeQItem *item = mProducerRoot->itemGet(uid)) {
+		item->itemDelete();
+	}
+}
+
 QVariant VeQItemMockProducer::value(const QString &uid) const
 {
 	return m_values.value(normalizedUid(uid));
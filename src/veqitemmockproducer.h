@@ -7,8 +7,17 @@
 #define VICTRON_VENUSOS_GUI_V2_VEQITEMMOCKPRODUCER_H
 
 #include "veutil/qt/ve_qitem.hpp"
+#include "mockscenario.h"
 
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QPair>
+#include <QtCore/QPointer>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
 
 #include <QtQml/QQmlEngine>
 #include <QtQml/QJSEngine>
@@ -19,6 +28,86 @@ namespace VenusOS {
 
 class VeQItemMockProducer;
 
+struct MockFleetConfig
+{
+	// Parses a list of <serviceType>=<count> pairs, e.g. "solarcharger=40,battery=20,tank=16".
+	static MockFleetConfig fromString(const QString &serviceCounts);
+
+	bool isEmpty() const;
+
+	QMap<QString, int> serviceCounts;
+	qreal updateRate = 1.0;     // updates per second, for each generated path
+	quint32 seed = 1;
+};
+
+/*
+  Simulates the link to a slow or unreliable GX device.
+
+  Values from the backend (the read path) and writes from the GUI (the write path) are delayed by
+  the latency, plus or minus a random jitter. Updates stay in order, as on a TCP connection, so
+  a delayed update also delays the ones behind it. With a burst interval, updates are held back
+  and delivered together at each multiple of the interval, like a congested link. Each update is
+  dropped with the drop rate probability. Service removals are delivered in order with the values
+  on the read path, so a late value cannot recreate a removed service, but they are never
+  dropped. The random generator uses a fixed seed, so every run
+  with the same conditions behaves the same.
+*/
+struct MockNetworkConditions
+{
+	// Parses a list of <name>=<value> pairs, e.g. "latency=300,jitter=100,drop=0.05,burst=2000".
+	static MockNetworkConditions fromString(const QString &conditions);
+	static MockNetworkConditions fromVariantMap(const QVariantMap &conditions);
+	QVariantMap toVariantMap() const;
+
+	bool isEmpty() const;
+
+	int latency = 0;            // milliseconds
+	int jitter = 0;             // milliseconds
+	int burstInterval = 0;      // milliseconds
+	qreal dropRate = 0;         // 0 - 1
+	quint32 seed = 1;
+};
+
+/*
+  Generates the values of a fleet of mock services, from a worker thread.
+
+  Each service has a set of static paths (e.g. /ProductName, /DeviceInstance) and a set of
+  dynamic paths (e.g. /Soc, /Dc/0/Power) whose values follow a bounded random walk. The random
+  generator uses a fixed seed, so every run produces the same sequence of values.
+*/
+class MockFleetGenerator : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit MockFleetGenerator(const MockFleetConfig &config);
+
+	// The static values and starting values of all services. Call before the generator is started.
+	MockValueBatch initialValues() const;
+
+	void start();
+
+Q_SIGNALS:
+	void valuesGenerated(const MockValueBatch &values);
+
+private:
+	struct DynamicPath {
+		QString uid;
+		double value;
+		double min;
+		double max;
+		double step;
+	};
+
+	void generate();
+
+	MockFleetConfig m_config;
+	MockValueBatch m_staticValues;
+	QVector<DynamicPath> m_dynamicPaths;
+	QRandomGenerator m_random;
+	QTimer *m_timer = nullptr;
+};
+
 class VeQItemMock : public VeQItem
 {
 	Q_OBJECT
@@ -29,6 +118,9 @@ public:
 	int setValue(QVariant const &value) override;
 
 private:
+	friend class VeQItemMockProducer;
+	void applyWrite(const QVariant &value);
+
 	VeQItemMockProducer *m_producer = nullptr;
 };
 
@@ -38,11 +130,35 @@ class VeQItemMockProducer : public VeQItemProducer
 
 public:
 	VeQItemMockProducer(VeQItem *root, const QString &id, QObject *parent = nullptr);
+	~VeQItemMockProducer() override;
 	void initialize();
 
+	// Creates the fleet services and starts updating them from a worker thread.
+	void startFleet(const MockFleetConfig &config);
+	void stopFleet();
+
+	// Plays the scenario from a worker thread.
+	void startScenario(const MockScenario &scenario);
+	void stopScenario();
+
 	void setValue(const QString &uid, const QVariant &value);
 	QVariant value(const QString &uid) const;
 
+	// Delays the effect of writes to items, like the round trip to a broker or D-Bus service.
+	// This is in addition to the latency of the network conditions.
+	void setWriteLatency(int msecs);
+	int writeLatency() const;
+
+	// The number of writes to items since the producer was created.
+	int writeCount() const;
+
+	// Applies to the values set with setValue() and to writes to items, from now on.
+	void setNetworkConditions(const MockNetworkConditions &conditions);
+	MockNetworkConditions networkConditions() const;
+
+	// The number of values and writes dropped because of the network conditions.
+	int droppedCount() const;
+
 	VeQItem *createItem() override;
 
 	static QObject* instance(QQmlEngine *engine, QJSEngine *);
@@ -52,14 +168,46 @@ Q_SIGNALS:
 	void mqttUidChanged();
 
 private:
+	struct Delivery {
+		qint64 due;
+		QString uid;
+		QPointer<VeQItemMock> writtenItem;  // null for values from the backend
+		QVariant value;
+		bool removal = false;   // the uid is a service to remove
+	};
+
 	static QString normalizedUid(const QString &uid);
+	void applyValues(const MockValueBatch &values);
+	void removeServices(const QStringList &services);
+	void removeService(const QString &service);
+	void applyValue(const QString &uid, const QVariant &value);
+	void writeValue(VeQItemMock *item, const QVariant &value);
+	void scheduleDelivery(Delivery delivery, int extraLatency, qint64 *lastDue);
+	void deliverPending();
+
+	friend class VeQItemMock;
 
 	QHash<QString,QVariant> m_values;
+	int m_writeLatency = 0;
+	int m_writeCount = 0;
+	MockNetworkConditions m_networkConditions;
+	QRandomGenerator m_networkRandom;
+	QElapsedTimer m_networkClock;
+	QVector<Delivery> m_deliveries;     // ordered by due time
+	QTimer m_deliveryTimer;
+	qint64 m_lastReadDue = 0;
+	qint64 m_lastWriteDue = 0;
+	int m_droppedCount = 0;
+	QThread m_fleetThread;
+	QPointer<MockFleetGenerator> m_fleetGenerator;
+	QThread m_scenarioThread;
 };
 
 } /* VenusOS */
 
 } /* Victron */
 
+Q_DECLARE_METATYPE(Victron::VenusOS::MockValueBatch)
+
 #endif // VICTRON_VENUSOS_GUI_V2_VEQITEMMOCKPRODUCER_H
 
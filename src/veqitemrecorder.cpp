@@ -0,0 +1,110 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include "veqitemrecorder.h"
+#include "logging.h"
+
+#include "veutil/qt/ve_qitem.hpp"
+
+#include <functional>
+
+namespace Victron {
+
+namespace VenusOS {
+
+VeQItemRecorder::VeQItemRecorder(VeQItem *root, const QString &uidPrefix, QObject *parent)
+	: QObject(parent)
+	, m_root(root)
+	, m_uidPrefix(uidPrefix)
+{
+	m_flushTimer.setInterval(1000);
+	connect(&m_flushTimer, &QTimer::timeout, &m_file, [this] { m_file.flush(); });
+}
+
+VeQItemRecorder::~VeQItemRecorder()
+{
+	close();
+}
+
+bool VeQItemRecorder::open(const QString &fileName)
+{
+	close();
+
+	m_file.setFileName(fileName);
+	if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qCWarning(venusGui) << "Unable to open recording file" << fileName << m_file.errorString();
+		return false;
+	}
+	m_stream.setDevice(&m_file);
+	m_stream.setVersion(VeQItemLog::StreamVersion);
+	m_stream << VeQItemLog::Magic << VeQItemLog::Version << m_uidPrefix.toUtf8();
+
+	m_recordCount = 0;
+	m_nextUidIndex = 0;
+	m_clock.start();
+	m_flushTimer.start();
+
+	qCInfo(venusGui) << "Recording" << m_uidPrefix << "value changes to" << fileName;
+	watchItem(m_root, QString());
+	return true;
+}
+
+void VeQItemRecorder::close()
+{
+	if (!m_file.isOpen()) {
+		return;
+	}
+	m_flushTimer.stop();
+	if (m_root) {
+		// Stop watching all items; the connections use the recorder as the context object.
+		std::function<void(VeQItem *)> disconnectItem = [&](VeQItem *item) {
+			item->disconnect(this);
+			for (VeQItem *child : item->itemChildren()) {
+				disconnectItem(child);
+			}
+		};
+		disconnectItem(m_root);
+	}
+	m_stream.setDevice(nullptr);
+	m_file.close();
+	qCInfo(venusGui) << "Recorded" << m_recordCount << "value changes to" << m_file.fileName();
+}
+
+quint64 VeQItemRecorder::recordCount() const
+{
+	return m_recordCount;
+}
+
+void VeQItemRecorder::watchItem(VeQItem *item, const QString &uid)
+{
+	if (!uid.isEmpty()) {
+		const quint32 uidIndex = m_nextUidIndex++;
+		m_stream << quint8(VeQItemLog::UidRecord) << uidIndex << uid.toUtf8();
+
+		connect(item, &VeQItem::valueChanged, this, [this, item, uidIndex] {
+			recordValue(uidIndex, item->getValue());
+		});
+		if (item->getState() != VeQItem::Idle) {
+			recordValue(uidIndex, item->getValue());
+		}
+	}
+
+	connect(item, &VeQItem::childAdded, this, [this, uid](VeQItem *child) {
+		watchItem(child, uid.isEmpty() ? child->id() : uid + QLatin1Char('/') + child->id());
+	});
+	for (VeQItem *child : item->itemChildren()) {
+		watchItem(child, uid.isEmpty() ? child->id() : uid + QLatin1Char('/') + child->id());
+	}
+}
+
+void VeQItemRecorder::recordValue(quint32 uidIndex, const QVariant &value)
+{
+	m_stream << quint8(VeQItemLog::ValueRecord) << quint32(m_clock.elapsed()) << uidIndex << value;
+	m_recordCount++;
+}
+
+} /* VenusOS */
+
+} /* Victron */
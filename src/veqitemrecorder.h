@@ -0,0 +1,77 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_VEQITEMRECORDER_H
+#define VICTRON_VENUSOS_GUI_V2_VEQITEMRECORDER_H
+
+#include <QtCore/QDataStream>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtCore/QTimer>
+
+class VeQItem;
+
+namespace Victron {
+
+namespace VenusOS {
+
+/*
+  The format of the value change log written by VeQItemRecorder and read by VeQItemReplayProducer.
+
+  Header: magic, version, uid prefix of the recorded backend (e.g. "mqtt" or "dbus").
+  Then a sequence of records, each starting with a RecordType:
+    - UidRecord: uid index, uid relative to the producer root (UTF-8). Written the first time an
+      item is seen, so that value records only refer to the index.
+    - ValueRecord: milliseconds since the start of the recording, uid index, value.
+*/
+namespace VeQItemLog {
+const quint32 Magic = 0x56514952; // "VQIR"
+const quint16 Version = 1;
+const QDataStream::Version StreamVersion = QDataStream::Qt_6_5;
+
+enum RecordType : quint8 {
+	UidRecord = 0,
+	ValueRecord = 1
+};
+}
+
+/*
+  Records every value change below a producer root into a timestamped binary log. The values
+  that are present when recording starts are recorded at time 0.
+*/
+class VeQItemRecorder : public QObject
+{
+	Q_OBJECT
+
+public:
+	VeQItemRecorder(VeQItem *root, const QString &uidPrefix, QObject *parent = nullptr);
+	~VeQItemRecorder() override;
+
+	bool open(const QString &fileName);
+	void close();
+
+	quint64 recordCount() const;
+
+private:
+	void watchItem(VeQItem *item, const QString &uid);
+	void recordValue(quint32 uidIndex, const QVariant &value);
+
+	QPointer<VeQItem> m_root;
+	QString m_uidPrefix;
+	QFile m_file;
+	QDataStream m_stream;
+	QElapsedTimer m_clock;
+	QTimer m_flushTimer;
+	quint32 m_nextUidIndex = 0;
+	quint64 m_recordCount = 0;
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_VEQITEMRECORDER_H
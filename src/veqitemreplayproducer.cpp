@@ -0,0 +1,181 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include "veqitemreplayproducer.h"
+#include "veqitemrecorder.h"
+#include "logging.h"
+
+#include <QtCore/QFile>
+
+namespace Victron {
+
+namespace VenusOS {
+
+namespace {
+
+const int ThrottledInterval = 10;
+
+// When unthrottled, the number of records produced before returning to the event loop.
+const int UnthrottledBatchSize = 2000;
+
+bool readHeader(QDataStream &stream, QString *uidPrefix)
+{
+	quint32 magic = 0;
+	quint16 version = 0;
+	QByteArray prefix;
+	stream.setVersion(VeQItemLog::StreamVersion);
+	stream >> magic >> version >> prefix;
+	if (magic != VeQItemLog::Magic || version != VeQItemLog::Version || stream.status() != QDataStream::Ok) {
+		return false;
+	}
+	*uidPrefix = QString::fromUtf8(prefix);
+	return true;
+}
+
+}
+
+VeQItemReplay::VeQItemReplay(VeQItemProducer *producer)
+	: VeQItem(producer)
+{
+}
+
+int VeQItemReplay::setValue(QVariant const &value)
+{
+	// There is no backend to write to, so accept the value locally, like the mock backend.
+	VeQItem::setValue(value);
+	produceValue(value);
+	return 0;
+}
+
+
+VeQItemReplayProducer::VeQItemReplayProducer(VeQItem *root, const QString &id, QObject *parent)
+	: VeQItemProducer(root, id, parent)
+{
+	connect(&m_timer, &QTimer::timeout, this, &VeQItemReplayProducer::playRecords);
+}
+
+QString VeQItemReplayProducer::recordedUidPrefix(const QString &fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return QString();
+	}
+	QDataStream stream(&file);
+	QString uidPrefix;
+	return readHeader(stream, &uidPrefix) ? uidPrefix : QString();
+}
+
+bool VeQItemReplayProducer::open(const QString &fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		qCWarning(venusGui) << "Unable to open replay file" << fileName << file.errorString();
+		return false;
+	}
+
+	QDataStream stream(&file);
+	QString uidPrefix;
+	if (!readHeader(stream, &uidPrefix)) {
+		qCWarning(venusGui) << "Not a valid replay file:" << fileName;
+		return false;
+	}
+
+	m_uids.clear();
+	m_records.clear();
+	while (!stream.atEnd() && stream.status() == QDataStream::Ok) {
+		quint8 type = 0;
+		stream >> type;
+		if (type == VeQItemLog::UidRecord) {
+			quint32 uidIndex = 0;
+			QByteArray uid;
+			stream >> uidIndex >> uid;
+			if (uidIndex != quint32(m_uids.count())) {
+				qCWarning(venusGui) << "Replay file has unexpected uid index" << uidIndex;
+				break;
+			}
+			m_uids.append(QString::fromUtf8(uid));
+		} else if (type == VeQItemLog::ValueRecord) {
+			Record record;
+			stream >> record.time >> record.uidIndex >> record.value;
+			if (record.uidIndex < quint32(m_uids.count())) {
+				m_records.append(record);
+			}
+		} else {
+			qCWarning(venusGui) << "Replay file has unknown record type" << type;
+			break;
+		}
+	}
+	if (stream.status() != QDataStream::Ok) {
+		qCWarning(venusGui) << "Replay file is truncated:" << fileName;
+	}
+
+	m_items = QVector<VeQItem *>(m_uids.count(), nullptr);
+	m_nextRecord = 0;
+	while (m_nextRecord < m_records.count() && m_records.at(m_nextRecord).time == 0) {
+		produceRecord(m_records.at(m_nextRecord++));
+	}
+
+	qCInfo(venusGui) << "Loaded" << m_records.count() << "value changes for" << m_uids.count()
+			<< "items from" << uidPrefix << "recording" << fileName;
+	return true;
+}
+
+qreal VeQItemReplayProducer::speed() const
+{
+	return m_speed;
+}
+
+void VeQItemReplayProducer::setSpeed(qreal speed)
+{
+	m_speed = qMax(qreal(0), speed);
+}
+
+void VeQItemReplayProducer::start()
+{
+	m_producedCount = 0;
+	m_clock.start();
+	m_timer.start(m_speed > 0 ? ThrottledInterval : 0);
+}
+
+VeQItem *VeQItemReplayProducer::createItem()
+{
+	return new VeQItemReplay(this);
+}
+
+void VeQItemReplayProducer::produceRecord(const Record &record)
+{
+	VeQItem *&item = m_items[record.uidIndex];
+	if (!item) {
+		item = mProducerRoot->itemGetOrCreate(m_uids.at(record.uidIndex), true, true);
+	}
+	item->produceValue(record.value, record.value.isValid() ? VeQItem::Synchronized : VeQItem::Offline);
+	m_producedCount++;
+}
+
+void VeQItemReplayProducer::playRecords()
+{
+	if (m_speed > 0) {
+		const qint64 replayTime = qint64(m_clock.elapsed() * m_speed);
+		while (m_nextRecord < m_records.count() && m_records.at(m_nextRecord).time <= replayTime) {
+			produceRecord(m_records.at(m_nextRecord++));
+		}
+	} else {
+		const int last = qMin(m_nextRecord + UnthrottledBatchSize, int(m_records.count()));
+		while (m_nextRecord < last) {
+			produceRecord(m_records.at(m_nextRecord++));
+		}
+	}
+
+	if (m_nextRecord >= m_records.count()) {
+		m_timer.stop();
+		qCInfo(venusGui) << "Replay finished:" << m_producedCount << "value changes in"
+				<< m_clock.elapsed() << "ms";
+		emit finished();
+	}
+}
+
+} /* VenusOS */
+
+} /* Victron */
@@ -0,0 +1,82 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_VEQITEMREPLAYPRODUCER_H
+#define VICTRON_VENUSOS_GUI_V2_VEQITEMREPLAYPRODUCER_H
+
+#include "veutil/qt/ve_qitem.hpp"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
+
+namespace Victron {
+
+namespace VenusOS {
+
+class VeQItemReplay : public VeQItem
+{
+	Q_OBJECT
+
+public:
+	VeQItemReplay(VeQItemProducer *producer);
+
+	int setValue(QVariant const &value) override;
+};
+
+/*
+  Plays back a value change log written by VeQItemRecorder.
+
+  The values recorded at time 0 (i.e. the values present when recording started) are produced
+  when the log is opened. The remaining changes are produced by start(), at the recorded rate
+  multiplied by the speed; a speed of 0 plays the log back as fast as possible.
+*/
+class VeQItemReplayProducer : public VeQItemProducer
+{
+	Q_OBJECT
+
+public:
+	VeQItemReplayProducer(VeQItem *root, const QString &id, QObject *parent = nullptr);
+
+	// Returns the uid prefix (e.g. "mqtt" or "dbus") of the backend that the log was recorded from.
+	static QString recordedUidPrefix(const QString &fileName);
+
+	bool open(const QString &fileName);
+
+	qreal speed() const;
+	void setSpeed(qreal speed);
+
+	void start();
+
+	VeQItem *createItem() override;
+
+Q_SIGNALS:
+	void finished();
+
+private:
+	struct Record {
+		quint32 time;
+		quint32 uidIndex;
+		QVariant value;
+	};
+
+	void produceRecord(const Record &record);
+	void playRecords();
+
+	QVector<QString> m_uids;
+	QVector<VeQItem *> m_items;
+	QVector<Record> m_records;
+	QTimer m_timer;
+	QElapsedTimer m_clock;
+	qreal m_speed = 1.0;
+	int m_nextRecord = 0;
+	qint64 m_producedCount = 0;
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_VEQITEMREPLAYPRODUCER_H
@@ -0,0 +1,145 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include "veqitemsnapshot.h"
+#include "stalestate.h"
+#include "logging.h"
+
+#include "veutil/qt/ve_qitem.hpp"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+
+namespace Victron {
+
+namespace VenusOS {
+
+namespace {
+
+const quint32 SnapshotMagic = 0x56514953; // "VQIS"
+const quint16 SnapshotVersion = 1;
+const QDataStream::Version SnapshotStreamVersion = QDataStream::Qt_6_5;
+
+void writeItems(QDataStream &stream, VeQItem *item, const QString &uid, quint32 *count)
+{
+	const VeQItem::Children &children = item->itemChildren();
+	if (children.isEmpty()) {
+		if (!uid.isEmpty() && item->getState() == VeQItem::Synchronized) {
+			const QVariant value = item->getValue();
+			if (value.isValid()) {
+				stream << uid.toUtf8() << value;
+				(*count)++;
+			}
+		}
+		return;
+	}
+	for (auto it = children.constBegin(); it != children.constEnd(); ++it) {
+		writeItems(stream, it.value(), uid.isEmpty() ? it.key() : uid + QLatin1Char('/') + it.key(), count);
+	}
+}
+
+}
+
+bool VeQItemSnapshot::save(VeQItem *root, const QString &fileName)
+{
+	if (!root || fileName.isEmpty()) {
+		return false;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	QDir().mkpath(QFileInfo(fileName).absolutePath());
+	QSaveFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly)) {
+		qCWarning(venusGui) << "Unable to write item snapshot" << fileName << file.errorString();
+		return false;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(SnapshotStreamVersion);
+	stream << SnapshotMagic << SnapshotVersion;
+
+	// The entry count is not known until the tree has been walked, so write a placeholder.
+	const qint64 countPos = file.pos();
+	quint32 count = 0;
+	stream << count;
+	writeItems(stream, root, QString(), &count);
+	file.seek(countPos);
+	stream << count;
+
+	if (stream.status() != QDataStream::Ok || !file.commit()) {
+		qCWarning(venusGui) << "Unable to write item snapshot" << fileName << file.errorString();
+		return false;
+	}
+	qCDebug(venusGui) << "Saved" << count << "items to snapshot" << fileName << "in" << timer.elapsed() << "ms";
+	return true;
+}
+
+int VeQItemSnapshot::load(VeQItem *root, const QString &fileName)
+{
+	if (!root || fileName.isEmpty()) {
+		return 0;
+	}
+
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return 0;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	// Map the file rather than reading it, so that the entries are decoded straight from the page
+	// cache. QFile unmaps it when closed.
+	QByteArray data;
+	if (uchar *mapped = file.map(0, file.size())) {
+		data = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), file.size());
+	} else {
+		data = file.readAll();
+	}
+
+	QDataStream stream(data);
+	stream.setVersion(SnapshotStreamVersion);
+	quint32 magic = 0;
+	quint16 version = 0;
+	quint32 count = 0;
+	stream >> magic >> version >> count;
+	if (magic != SnapshotMagic || version != SnapshotVersion) {
+		qCWarning(venusGui) << "Ignoring item snapshot with unknown format:" << fileName;
+		return 0;
+	}
+
+	int loaded = 0;
+	QByteArray uid;
+	QVariant value;
+	for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+		stream >> uid >> value;
+		if (stream.status() != QDataStream::Ok) {
+			break;
+		}
+		VeQItem *item = root->itemGetOrCreate(QString::fromUtf8(uid), true, true);
+		// Don't overwrite a value that has already been produced by the backend.
+		if (item && item->getState() == VeQItem::Idle) {
+			StaleState::markStale(item);
+			item->produceValue(value, VeQItem::Requested);
+			loaded++;
+		}
+	}
+
+	if (stream.status() != QDataStream::Ok) {
+		qCWarning(venusGui) << "Item snapshot is truncated:" << fileName;
+	}
+	qCInfo(venusGui) << "Loaded" << loaded << "items from snapshot" << fileName << "in" << timer.elapsed() << "ms";
+	return loaded;
+}
+
+} /* VenusOS */
+
+} /* Victron */
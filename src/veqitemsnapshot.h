@@ -0,0 +1,39 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_VEQITEMSNAPSHOT_H
+#define VICTRON_VENUSOS_GUI_V2_VEQITEMSNAPSHOT_H
+
+#include <QtCore/QString>
+
+class VeQItem;
+
+namespace Victron {
+
+namespace VenusOS {
+
+/*
+  Saves and restores the last-known values of an item tree, so that a restarted GUI can show
+  values before the backend has finished publishing or introspecting all of its services.
+
+  The file is a compact binary list of (uid, value) entries, where the uids are relative to the
+  saved root and values are serialized with their type. Only synchronized leaf values are saved.
+
+  Restored values are produced with the VeQItem::Requested state and marked as stale, until the
+  backend produces a live value for the item. QML reads the mark with StaleState, as the state
+  alone does not tell a restored value from one that is being fetched.
+*/
+class VeQItemSnapshot
+{
+public:
+	static bool save(VeQItem *root, const QString &fileName);
+	static int load(VeQItem *root, const QString &fileName);
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_VEQITEMSNAPSHOT_H
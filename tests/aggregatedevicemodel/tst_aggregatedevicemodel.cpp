@@ -0,0 +1,400 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include <QtTest/QtTest>
+#include <QtQml/QQmlComponent>
+#include <QtQml/QQmlEngine>
+
+#include "aggregatedevicemodel.h"
+#include "basedevicemodel.h"
+
+using namespace Victron::VenusOS;
+
+class tst_AggregateDeviceModel : public QObject
+{
+	Q_OBJECT
+
+private:
+	// Creates a model of devices with descriptions in random order, like the device list page.
+	static BaseDeviceModel *createModel(const QString &modelId, int deviceCount, QObject *parent)
+	{
+		BaseDeviceModel *model = new BaseDeviceModel(parent);
+		model->setModelId(modelId);
+		QRandomGenerator random(deviceCount);
+		QList<BaseDevice *> devices;
+		for (int i = 0; i < deviceCount; ++i) {
+			BaseDevice *device = new BaseDevice(model);
+			device->setServiceUid(QStringLiteral("mock/com.victronenergy.%1.ttyUSB%2").arg(modelId).arg(i));
+			device->setDeviceInstance(i);
+			device->setDescription(QStringLiteral("Device %1").arg(random.bounded(deviceCount * 10)));
+			devices.append(device);
+		}
+		model->addDevices(devices);
+		return model;
+	}
+
+	static QStringList descriptions(const AggregateDeviceModel &model)
+	{
+		QStringList result;
+		for (int i = 0; i < model.count(); ++i) {
+			result.append(model.data(model.index(i), AggregateDeviceModel::CachedDeviceDescriptionRole).toString());
+		}
+		return result;
+	}
+
+	static bool isSorted(const QStringList &list)
+	{
+		for (int i = 1; i < list.count(); ++i) {
+			if (list.at(i).localeAwareCompare(list.at(i - 1)) < 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Creates an Instantiator for the model, which creates a delegate object for each row as a
+	// ListView does, but without needing a window.
+	static QObject *createInstantiator(QQmlEngine *engine, AggregateDeviceModel *model)
+	{
+		QQmlComponent component(engine);
+		component.setData("import QtQml\n"
+				"import QtQml.Models\n"
+				"Instantiator { delegate: QtObject { property var device: model.device } }", QUrl());
+		QObject *instantiator = component.createWithInitialProperties({ { QStringLiteral("model"), QVariant::fromValue(model) } });
+		if (!instantiator) {
+			qWarning() << component.errors();
+		}
+		return instantiator;
+	}
+
+	static void addDeviceCountRows()
+	{
+		QTest::addColumn<int>("deviceCount");
+		QTest::newRow("10 devices") << 10;
+		QTest::newRow("100 devices") << 100;
+		QTest::newRow("1000 devices") << 1000;
+	}
+
+private slots:
+	void ordering()
+	{
+		QObject parent;
+		BaseDeviceModel *batteries = createModel(QStringLiteral("battery"), 20, &parent);
+		BaseDeviceModel *tanks = createModel(QStringLiteral("tank"), 20, &parent);
+		AggregateDeviceModel model;
+		model.setSourceModels({ QVariant::fromValue(batteries), QVariant::fromValue(tanks) });
+		QCOMPARE(model.count(), 40);
+		QVERIFY(isSorted(descriptions(model)));
+
+		// Moves follow description changes, in both directions.
+		batteries->deviceAt(0)->setDescription(QStringLiteral("AAA"));
+		QCOMPARE(descriptions(model).constFirst(), QStringLiteral("AAA"));
+		batteries->deviceAt(0)->setDescription(QStringLiteral("ZZZ"));
+		QCOMPARE(descriptions(model).constLast(), QStringLiteral("ZZZ"));
+		tanks->deviceAt(5)->setDescription(QStringLiteral("Device 100"));
+		QVERIFY(isSorted(descriptions(model)));
+
+		// Devices added later are inserted at their position.
+		BaseDevice *device = new BaseDevice(tanks);
+		device->setServiceUid(QStringLiteral("mock/com.victronenergy.tank.new"));
+		device->setDeviceInstance(100);
+		device->setDescription(QStringLiteral("Device 55"));
+		tanks->addDevice(device);
+		QCOMPARE(model.count(), 41);
+		QVERIFY(isSorted(descriptions(model)));
+	}
+
+	void incrementalSourceModels()
+	{
+		QObject parent;
+		BaseDeviceModel *batteries = createModel(QStringLiteral("battery"), 10, &parent);
+		BaseDeviceModel *tanks = createModel(QStringLiteral("tank"), 10, &parent);
+		AggregateDeviceModel model;
+		model.setSourceModels({ QVariant::fromValue(batteries), QVariant::fromValue(tanks) });
+
+		// Disconnect a battery, so that it is kept as a disconnected device.
+		const QString disconnectedUid = batteries->deviceAt(3)->serviceUid();
+		batteries->removeDevice(disconnectedUid);
+		QCOMPARE(model.disconnectedDeviceCount(), 1);
+
+		QSignalSpy resetSpy(&model, &AggregateDeviceModel::modelReset);
+		QSignalSpy insertSpy(&model, &AggregateDeviceModel::rowsInserted);
+		QSignalSpy removeSpy(&model, &AggregateDeviceModel::rowsAboutToBeRemoved);
+		QSignalSpy countSpy(&model, &AggregateDeviceModel::countChanged);
+
+		// Removing the tanks only removes their rows, and keeps the disconnected battery.
+		model.setSourceModels({ QVariant::fromValue(batteries) });
+		QCOMPARE(model.count(), 10);
+		QCOMPARE(model.disconnectedDeviceCount(), 1);
+		QCOMPARE(resetSpy.count(), 0);
+		QVERIFY(removeSpy.count() > 0);
+		QCOMPARE(countSpy.count(), 1);
+		QVERIFY(isSorted(descriptions(model)));
+
+		// Adding them again inserts their rows.
+		model.setSourceModels({ QVariant::fromValue(batteries), QVariant::fromValue(tanks) });
+		QCOMPARE(model.count(), 20);
+		QCOMPARE(resetSpy.count(), 0);
+		QCOMPARE(insertSpy.count(), 10);
+		QCOMPARE(countSpy.count(), 2);
+		QVERIFY(isSorted(descriptions(model)));
+
+		// The kept rows are still connected to their devices.
+		batteries->deviceAt(0)->setDescription(QStringLiteral("AAA"));
+		QCOMPARE(descriptions(model).constFirst(), QStringLiteral("AAA"));
+		tanks->removeDevice(tanks->deviceAt(0)->serviceUid());
+		QCOMPARE(model.disconnectedDeviceCount(), 2);
+
+		// Removing the batteries also removes the disconnected battery.
+		model.setSourceModels({ QVariant::fromValue(tanks) });
+		QCOMPARE(model.count(), 10);
+		QCOMPARE(model.disconnectedDeviceCount(), 1);
+	}
+
+	void cache()
+	{
+		QStandardPaths::setTestModeEnabled(true);
+		QFile::remove(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/devicelist.ini"));
+		QObject parent;
+		BaseDeviceModel *batteries = createModel(QStringLiteral("battery"), 10, &parent);
+		BaseDeviceModel *tanks = createModel(QStringLiteral("tank"), 10, &parent);
+		const QVariantList sourceModels = { QVariant::fromValue(batteries), QVariant::fromValue(tanks) };
+		QStringList cachedDescriptions;
+		{
+			// Saves the cache when destroyed.
+			AggregateDeviceModel model;
+			model.classBegin();
+			model.setCacheId(QStringLiteral("test"));
+			model.setSourceModels(sourceModels);
+			model.componentComplete();
+			QCOMPARE(model.count(), 20);
+			cachedDescriptions = descriptions(model);
+		}
+
+		// The cached devices are loaded as disconnected devices in the same order.
+		BaseDeviceModel *emptyBatteries = new BaseDeviceModel(&parent);
+		emptyBatteries->setModelId(QStringLiteral("battery"));
+		AggregateDeviceModel model;
+		model.classBegin();
+		model.setCacheId(QStringLiteral("test"));
+		model.setSourceModels({ QVariant::fromValue(emptyBatteries), QVariant::fromValue(tanks) });
+		model.componentComplete();
+		QCOMPARE(model.count(), 20);
+		QCOMPARE(model.disconnectedDeviceCount(), 10);
+		QCOMPARE(descriptions(model), cachedDescriptions);
+
+		// Devices that appear later are bound to their rows rather than inserted.
+		QSignalSpy insertSpy(&model, &AggregateDeviceModel::rowsInserted);
+		QList<BaseDevice *> devices;
+		for (int i = 0; i < batteries->count(); ++i) {
+			BaseDevice *device = new BaseDevice(emptyBatteries);
+			device->setServiceUid(batteries->deviceAt(i)->serviceUid());
+			device->setDeviceInstance(batteries->deviceAt(i)->deviceInstance());
+			device->setDescription(batteries->deviceAt(i)->description());
+			devices.append(device);
+		}
+		emptyBatteries->addDevices(devices);
+		QCOMPARE(insertSpy.count(), 0);
+		QCOMPARE(model.count(), 20);
+		QCOMPARE(model.disconnectedDeviceCount(), 0);
+		QCOMPARE(descriptions(model), cachedDescriptions);
+		for (int i = 0; i < model.count(); ++i) {
+			QVERIFY(model.data(model.index(i), AggregateDeviceModel::ConnectedRole).toBool());
+		}
+	}
+
+	void cacheOfOtherSite()
+	{
+		QStandardPaths::setTestModeEnabled(true);
+		QFile::remove(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/devicelist.ini"));
+		QObject parent;
+		{
+			AggregateDeviceModel model;
+			model.classBegin();
+			model.setCacheId(QStringLiteral("site-a"));
+			model.setSourceModels({ QVariant::fromValue(createModel(QStringLiteral("battery"), 5, &parent)) });
+			model.componentComplete();
+		}
+
+		// The devices of one site are not loaded for another.
+		{
+			AggregateDeviceModel model;
+			model.classBegin();
+			model.setCacheId(QStringLiteral("site-b"));
+			model.componentComplete();
+			QCOMPARE(model.count(), 0);
+		}
+
+		// Removing a deleted source model keeps the cached devices, although they have no source
+		// model either.
+		AggregateDeviceModel model;
+		model.classBegin();
+		model.setCacheId(QStringLiteral("site-a"));
+		BaseDeviceModel *tanks = createModel(QStringLiteral("tank"), 3, &parent);
+		model.setSourceModels({ QVariant::fromValue(tanks) });
+		model.componentComplete();
+		QCOMPARE(model.count(), 8);
+		QCOMPARE(model.disconnectedDeviceCount(), 5);
+		delete tanks;
+		model.setSourceModels({});
+		QCOMPARE(model.count(), 5);
+
+		// Changing the site removes the devices that are only cached.
+		model.setCacheId(QStringLiteral("site-b"));
+		QCOMPARE(model.count(), 0);
+		QCOMPARE(model.disconnectedDeviceCount(), 0);
+	}
+
+	void cacheOfLateSite()
+	{
+		QStandardPaths::setTestModeEnabled(true);
+		QFile::remove(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/devicelist.ini"));
+		QObject parent;
+		BaseDeviceModel *batteries = createModel(QStringLiteral("battery"), 5, &parent);
+		BaseDeviceModel *tanks = createModel(QStringLiteral("tank"), 3, &parent);
+		{
+			AggregateDeviceModel model;
+			model.classBegin();
+			model.setCacheId(QStringLiteral("site-a"));
+			model.setSourceModels({ QVariant::fromValue(batteries), QVariant::fromValue(tanks) });
+			model.componentComplete();
+		}
+
+		// The site id is not known until after the model is complete, e.g. when it is read from
+		// the backend. The cached devices that are not in the list yet are added then.
+		AggregateDeviceModel model;
+		model.classBegin();
+		model.setSourceModels({ QVariant::fromValue(tanks) });
+		model.componentComplete();
+		QCOMPARE(model.count(), 3);
+		model.setCacheId(QStringLiteral("site-a"));
+		QCOMPARE(model.count(), 8);
+		QCOMPARE(model.disconnectedDeviceCount(), 5);
+		QVERIFY(isSorted(descriptions(model)));
+
+		// The cached devices are bound when their source model is added.
+		QSignalSpy insertSpy(&model, &AggregateDeviceModel::rowsInserted);
+		model.setSourceModels({ QVariant::fromValue(batteries), QVariant::fromValue(tanks) });
+		QCOMPARE(insertSpy.count(), 0);
+		QCOMPARE(model.count(), 8);
+		QCOMPARE(model.disconnectedDeviceCount(), 0);
+	}
+
+	// Toggles one model of 10 devices on a list of 100 devices, and reports the number of delegates
+	// created, compared with rebuilding the whole list.
+	void toggleSourceModel_data()
+	{
+		QTest::addColumn<bool>("rebuild");
+		QTest::newRow("incremental") << false;
+		QTest::newRow("rebuild") << true;
+	}
+
+	void toggleSourceModel()
+	{
+		QFETCH(bool, rebuild);
+		QObject parent;
+		const QVariant solarChargers = QVariant::fromValue(createModel(QStringLiteral("solarcharger"), 50, &parent));
+		const QVariant batteries = QVariant::fromValue(createModel(QStringLiteral("battery"), 40, &parent));
+		const QVariant tanks = QVariant::fromValue(createModel(QStringLiteral("tank"), 10, &parent));
+
+		QQmlEngine engine;
+		AggregateDeviceModel model;
+		model.setSourceModels({ solarChargers, batteries, tanks });
+		QScopedPointer<QObject> instantiator(createInstantiator(&engine, &model));
+		QVERIFY(instantiator);
+		QCOMPARE(instantiator->property("count").toInt(), 100);
+
+		QSignalSpy delegateSpy(instantiator.data(), SIGNAL(objectAdded(int,QObject*)));
+		int toggleCount = 0;
+		QBENCHMARK {
+			if (rebuild) {
+				// Like the previous implementation, which reset the model on every change.
+				model.setSourceModels({});
+			}
+			model.setSourceModels({ solarChargers, batteries });
+			if (rebuild) {
+				model.setSourceModels({});
+			}
+			model.setSourceModels({ solarChargers, batteries, tanks });
+			toggleCount++;
+		}
+		QCOMPARE(instantiator->property("count").toInt(), 100);
+		qInfo() << (rebuild ? "Rebuilding" : "Incremental diffing") << "created"
+				<< delegateSpy.count() / toggleCount << "delegates per toggle of 10 of 100 devices";
+		QCOMPARE(delegateSpy.count() / toggleCount, rebuild ? 190 : 10);
+	}
+
+	void setSourceModels_data()
+	{
+		addDeviceCountRows();
+	}
+
+	void setSourceModels()
+	{
+		QFETCH(int, deviceCount);
+		QObject parent;
+		const QVariantList sourceModels = {
+			QVariant::fromValue(createModel(QStringLiteral("solarcharger"), deviceCount / 2, &parent)),
+			QVariant::fromValue(createModel(QStringLiteral("battery"), deviceCount - deviceCount / 2, &parent)),
+		};
+
+		QBENCHMARK {
+			AggregateDeviceModel model;
+			model.setSourceModels(sourceModels);
+			QCOMPARE(model.count(), deviceCount);
+		}
+	}
+
+	// The previous approach, for comparison: a linear localeAwareCompare() scan for each device.
+	void setSourceModelsLinearCompare_data()
+	{
+		addDeviceCountRows();
+	}
+
+	void setSourceModelsLinearCompare()
+	{
+		QFETCH(int, deviceCount);
+		QObject parent;
+		const BaseDeviceModel *sourceModel = createModel(QStringLiteral("solarcharger"), deviceCount, &parent);
+
+		QBENCHMARK {
+			QStringList sorted;
+			for (int i = 0; i < sourceModel->count(); ++i) {
+				const QString description = sourceModel->deviceAt(i)->description();
+				int index = 0;
+				while (index < sorted.count() && description.localeAwareCompare(sorted.at(index)) >= 0) {
+					++index;
+				}
+				sorted.insert(index, description);
+			}
+			QCOMPARE(sorted.count(), deviceCount);
+		}
+	}
+
+	void descriptionChanged_data()
+	{
+		addDeviceCountRows();
+	}
+
+	void descriptionChanged()
+	{
+		QFETCH(int, deviceCount);
+		QObject parent;
+		BaseDeviceModel *sourceModel = createModel(QStringLiteral("solarcharger"), deviceCount, &parent);
+		AggregateDeviceModel model;
+		model.setSourceModels({ QVariant::fromValue(sourceModel) });
+
+		int i = 0;
+		QBENCHMARK {
+			BaseDevice *device = sourceModel->deviceAt(i % deviceCount);
+			device->setDescription(QStringLiteral("Device %1").arg((i * 7919) % (deviceCount * 10)));
+			++i;
+		}
+		QVERIFY(isSorted(descriptions(model)));
+	}
+};
+
+QTEST_GUILESS_MAIN(tst_AggregateDeviceModel)
+#include "tst_aggregatedevicemodel.moc"
@@ -0,0 +1,17 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include <QtQuickTest/quicktest.h>
+#include <QtQml/QQmlEngine>
+#include "basedevicemodel.h"
+
+int main(int argc, char **argv) \
+{
+	qmlRegisterType<Victron::VenusOS::BaseDevice>("Victron.VenusOS", 2, 0, "BaseDevice");
+	qmlRegisterType<Victron::VenusOS::BaseDeviceModel>("Victron.VenusOS", 2, 0, "BaseDeviceModel");
+
+	QTEST_SET_MAIN_SOURCE_PATH
+	return quick_test_main(argc, argv, "tst_basedevicemodel", nullptr);
+}
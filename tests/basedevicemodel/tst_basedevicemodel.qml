@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2024 Victron Energy B.V.
+ * See LICENSE.txt for license information.
+*/
+
+import QtQuick
+import QtTest
+import Victron.VenusOS
+
+TestCase {
+	id: root
+
+	name: "BaseDeviceModel"
+
+	// Similar to the startup of a large installation.
+	readonly property int deviceCount: 500
+
+	property BaseDeviceModel model
+
+	function createDevice(deviceInstance, serviceUid) {
+		return deviceComponent.createObject(root, {
+			deviceInstance: deviceInstance,
+			serviceUid: serviceUid || ("mock/com.victronenergy.solarcharger.ttyUSB" + deviceInstance)
+		})
+	}
+
+	function createDevices(count, reversed) {
+		let devices = []
+		for (let i = 0; i < count; ++i) {
+			devices.push(createDevice(reversed ? count - i : i))
+		}
+		return devices
+	}
+
+	function deviceInstances() {
+		let instances = []
+		for (let i = 0; i < model.count; ++i) {
+			instances.push(model.deviceAt(i).deviceInstance)
+		}
+		return instances
+	}
+
+	function init() {
+		model = modelComponent.createObject(root)
+		countSpy.target = model
+		countSpy.clear()
+		firstObjectSpy.target = model
+		firstObjectSpy.clear()
+		insertSpy.target = model
+		insertSpy.clear()
+	}
+
+	function cleanup() {
+		model.destroy()
+	}
+
+	function test_addDevice() {
+		verify(model.addDevice(createDevice(3)))
+		verify(model.addDevice(createDevice(1)))
+		verify(model.addDevice(createDevice(2)))
+		compare(deviceInstances(), [1, 2, 3])
+		compare(countSpy.count, 3)
+		compare(insertSpy.count, 3)
+		compare(model.firstObject.deviceInstance, 1)
+
+		// Duplicates and invalid devices are rejected.
+		verify(!model.addDevice(createDevice(4, "mock/com.victronenergy.solarcharger.ttyUSB1")))
+		verify(!model.addDevice(createDevice(-1)))
+		compare(model.count, 3)
+	}
+
+	function test_lookup() {
+		compare(model.addDevices(createDevices(10)), 10)
+		for (let i = 0; i < 10; ++i) {
+			compare(model.indexOf("mock/com.victronenergy.solarcharger.ttyUSB" + i), i)
+			compare(model.deviceForDeviceInstance(i).deviceInstance, i)
+		}
+		compare(model.indexOf("mock/com.victronenergy.solarcharger.ttyUSB10"), -1)
+		compare(model.deviceForDeviceInstance(10), null)
+
+		verify(model.removeDevice("mock/com.victronenergy.solarcharger.ttyUSB4"))
+		compare(model.indexOf("mock/com.victronenergy.solarcharger.ttyUSB4"), -1)
+		compare(model.deviceForDeviceInstance(4), null)
+		compare(model.indexOf("mock/com.victronenergy.solarcharger.ttyUSB5"), 4)
+		compare(model.deviceForDeviceInstance(9), model.deviceAt(8))
+
+		// The indexes follow changes to the devices.
+		model.deviceAt(0).serviceUid = "mock/com.victronenergy.solarcharger.renamed"
+		compare(model.indexOf("mock/com.victronenergy.solarcharger.renamed"), 0)
+		compare(model.indexOf("mock/com.victronenergy.solarcharger.ttyUSB0"), -1)
+		model.deviceAt(1).deviceInstance = 100
+		compare(model.deviceForDeviceInstance(100), model.deviceAt(1))
+	}
+
+	function test_addDevices() {
+		compare(model.addDevices(createDevices(deviceCount, true)), deviceCount)
+		compare(model.count, deviceCount)
+		compare(countSpy.count, 1)
+		compare(firstObjectSpy.count, 1)
+		compare(insertSpy.count, 1)
+		compare(model.firstObject.deviceInstance, 1)
+
+		const instances = deviceInstances()
+		for (let i = 1; i < instances.length; ++i) {
+			verify(instances[i - 1] <= instances[i])
+		}
+	}
+
+	function test_addDevicesInterleaved() {
+		model.addDevices([createDevice(10), createDevice(20), createDevice(30)])
+		insertSpy.clear()
+		countSpy.clear()
+
+		// One insertion per gap between the existing devices, but one count change.
+		compare(model.addDevices([createDevice(35), createDevice(5), createDevice(15), createDevice(16),
+				createDevice(20, "mock/com.victronenergy.solarcharger.other20")]), 5)
+		compare(deviceInstances(), [5, 10, 15, 16, 20, 20, 30, 35])
+		compare(insertSpy.count, 4)
+		compare(countSpy.count, 1)
+		compare(model.firstObject.deviceInstance, 5)
+		compare(model.indexOf("mock/com.victronenergy.solarcharger.other20"), 5)
+		compare(model.deviceForDeviceInstance(20).serviceUid, "mock/com.victronenergy.solarcharger.ttyUSB20")
+
+		// Duplicates within the batch and of existing devices are skipped.
+		compare(model.addDevices([createDevice(40), createDevice(41, "mock/com.victronenergy.solarcharger.ttyUSB40"),
+				createDevice(5)]), 1)
+		compare(model.count, 9)
+	}
+
+	function benchmark_addDeviceOneByOne() {
+		const devices = createDevices(deviceCount, true)
+		const benchmarkModel = modelComponent.createObject(root)
+		for (let i = 0; i < devices.length; ++i) {
+			benchmarkModel.addDevice(devices[i])
+		}
+		compare(benchmarkModel.count, deviceCount)
+		benchmarkModel.destroy()
+	}
+
+	function benchmark_addDevices() {
+		const devices = createDevices(deviceCount, true)
+		const benchmarkModel = modelComponent.createObject(root)
+		compare(benchmarkModel.addDevices(devices), deviceCount)
+		benchmarkModel.destroy()
+	}
+
+	Component {
+		id: deviceComponent
+		BaseDevice {}
+	}
+
+	Component {
+		id: modelComponent
+		BaseDeviceModel {}
+	}
+
+	SignalSpy {
+		id: countSpy
+		signalName: "countChanged"
+	}
+
+	SignalSpy {
+		id: firstObjectSpy
+		signalName: "firstObjectChanged"
+	}
+
+	SignalSpy {
+		id: insertSpy
+		signalName: "rowsInserted"
+	}
+}
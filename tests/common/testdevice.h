@@ -0,0 +1,58 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#ifndef VICTRON_VENUSOS_GUI_V2_TESTDEVICE_H
+#define VICTRON_VENUSOS_GUI_V2_TESTDEVICE_H
+
+#include <QtCore/QtMath>
+
+#include "basedevicemodel.h"
+
+namespace Victron {
+
+namespace VenusOS {
+
+// Like the QML device types, which add properties to BaseDevice.
+class TestDevice : public BaseDevice
+{
+	Q_OBJECT
+	Q_PROPERTY(int status READ status WRITE setStatus NOTIFY statusChanged)
+	Q_PROPERTY(qreal power READ power WRITE setPower NOTIFY powerChanged)
+
+public:
+	using BaseDevice::BaseDevice;
+
+	int status() const { return m_status; }
+	void setStatus(int status)
+	{
+		if (m_status != status) {
+			m_status = status;
+			emit statusChanged();
+		}
+	}
+
+	qreal power() const { return m_power; }
+	void setPower(qreal power)
+	{
+		if (qIsNaN(m_power) != qIsNaN(power) || (!qIsNaN(power) && m_power != power)) {
+			m_power = power;
+			emit powerChanged();
+		}
+	}
+
+Q_SIGNALS:
+	void statusChanged();
+	void powerChanged();
+
+private:
+	int m_status = 0;
+	qreal m_power = qQNaN();
+};
+
+} /* VenusOS */
+
+} /* Victron */
+
+#endif // VICTRON_VENUSOS_GUI_V2_TESTDEVICE_H
@@ -0,0 +1,144 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include <QtTest/QtTest>
+
+#include "basedevicemodel.h"
+#include "deviceaggregate.h"
+#include "testdevice.h"
+
+using namespace Victron::VenusOS;
+
+class tst_DeviceAggregate : public QObject
+{
+	Q_OBJECT
+
+private:
+	static QList<TestDevice *> addDevices(BaseDeviceModel *model, int count)
+	{
+		static int deviceInstance = 0;
+		QList<TestDevice *> devices;
+		QList<BaseDevice *> baseDevices;
+		for (int i = 0; i < count; ++i) {
+			TestDevice *device = new TestDevice(model);
+			device->setServiceUid(QStringLiteral("mock/com.victronenergy.dcsource.ttyUSB%1").arg(deviceInstance));
+			device->setDeviceInstance(deviceInstance++);
+			devices.append(device);
+			baseDevices.append(device);
+		}
+		model->addDevices(baseDevices);
+		return devices;
+	}
+
+private slots:
+	void aggregates()
+	{
+		BaseDeviceModel model;
+		DeviceAggregate aggregate;
+		aggregate.setModel(&model);
+		aggregate.setPropertyName(QStringLiteral("power"));
+		QVERIFY(qIsNaN(aggregate.sum()));
+		QVERIFY(qIsNaN(aggregate.average()));
+
+		// Devices without a value are ignored, as with Units::sumRealNumbers().
+		const QList<TestDevice *> devices = addDevices(&model, 3);
+		QVERIFY(qIsNaN(aggregate.sum()));
+		QCOMPARE(aggregate.count(), 0);
+
+		QSignalSpy sumSpy(&aggregate, &DeviceAggregate::sumChanged);
+		devices.at(0)->setPower(100);
+		devices.at(1)->setPower(-50);
+		QCOMPARE(aggregate.sum(), 50.0);
+		QCOMPARE(aggregate.minimum(), -50.0);
+		QCOMPARE(aggregate.maximum(), 100.0);
+		QCOMPARE(aggregate.average(), 25.0);
+		QCOMPARE(aggregate.count(), 2);
+		QCOMPARE(sumSpy.count(), 2);
+
+		// The extremes follow the device values in both directions.
+		devices.at(0)->setPower(10);
+		QCOMPARE(aggregate.maximum(), 10.0);
+		devices.at(2)->setPower(10);
+		devices.at(0)->setPower(qQNaN());
+		QCOMPARE(aggregate.maximum(), 10.0);
+		QCOMPARE(aggregate.sum(), -40.0);
+		QCOMPARE(aggregate.count(), 2);
+
+		// Removed and deleted devices no longer count.
+		model.removeDevice(devices.at(1)->serviceUid());
+		QCOMPARE(aggregate.sum(), 10.0);
+		QCOMPARE(aggregate.minimum(), 10.0);
+		delete devices.at(2);
+		QVERIFY(qIsNaN(aggregate.sum()));
+		QVERIFY(qIsNaN(aggregate.minimum()));
+		QCOMPARE(aggregate.count(), 0);
+
+		// Devices added to the model are counted.
+		const QList<TestDevice *> moreDevices = addDevices(&model, 2);
+		moreDevices.at(0)->setPower(1);
+		moreDevices.at(1)->setPower(2);
+		QCOMPARE(aggregate.sum(), 3.0);
+		model.clear();
+		QVERIFY(qIsNaN(aggregate.sum()));
+	}
+
+	// 100 devices that each update their value at 10 Hz, i.e. 1000 value changes per second. The
+	// full pass recalculates the aggregates over all devices on each change, as the QML code did.
+	void updatesPerSecond_data()
+	{
+		QTest::addColumn<bool>("fullPass");
+		QTest::newRow("incremental") << false;
+		QTest::newRow("full pass") << true;
+	}
+
+	void updatesPerSecond()
+	{
+		QFETCH(bool, fullPass);
+		const int deviceCount = 100;
+		const int updateRate = 10;
+		BaseDeviceModel model;
+		const QList<TestDevice *> devices = addDevices(&model, deviceCount);
+		DeviceAggregate aggregate;
+		if (!fullPass) {
+			aggregate.setModel(&model);
+			aggregate.setPropertyName(QStringLiteral("power"));
+		}
+
+		QRandomGenerator random(1);
+		qreal fullPassSum = qQNaN();
+		QBENCHMARK {
+			for (int update = 0; update < deviceCount * updateRate; ++update) {
+				devices.at(update % deviceCount)->setPower(random.bounded(1000));
+				if (fullPass) {
+					fullPassSum = qQNaN();
+					qreal minimum = qQNaN();
+					qreal maximum = qQNaN();
+					for (int i = 0; i < model.count(); ++i) {
+						const qreal power = model.deviceAt(i)->property("power").toReal();
+						if (!qIsNaN(power)) {
+							fullPassSum = qIsNaN(fullPassSum) ? power : fullPassSum + power;
+							minimum = qIsNaN(minimum) ? power : qMin(minimum, power);
+							maximum = qIsNaN(maximum) ? power : qMax(maximum, power);
+						}
+					}
+				}
+			}
+		}
+
+		qreal expectedSum = 0;
+		for (const TestDevice *device : devices) {
+			expectedSum += device->power();
+		}
+		if (fullPass) {
+			QCOMPARE(fullPassSum, expectedSum);
+		} else {
+			QVERIFY(qAbs(aggregate.sum() - expectedSum) < 1e-6);
+			QCOMPARE(aggregate.count(), deviceCount);
+		}
+	}
+};
+
+QTEST_GUILESS_MAIN(tst_DeviceAggregate)
+#include "tst_deviceaggregate.moc"
@@ -0,0 +1,179 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include <QtTest/QtTest>
+
+#include "basedevicemodel.h"
+#include "filtereddevicemodel.h"
+#include "testdevice.h"
+
+using namespace Victron::VenusOS;
+
+class tst_FilteredDeviceModel : public QObject
+{
+	Q_OBJECT
+
+private:
+	static TestDevice *createDevice(const QString &serviceType, int deviceInstance, int status, QObject *parent)
+	{
+		TestDevice *device = new TestDevice(parent);
+		device->setServiceUid(QStringLiteral("mock/com.victronenergy.%1.ttyUSB%2").arg(serviceType).arg(deviceInstance));
+		device->setDeviceInstance(deviceInstance);
+		device->setStatus(status);
+		return device;
+	}
+
+	static QList<int> deviceInstances(const FilteredDeviceModel &model)
+	{
+		QList<int> result;
+		for (int i = 0; i < model.count(); ++i) {
+			result.append(model.deviceAt(i)->deviceInstance());
+		}
+		return result;
+	}
+
+private slots:
+	void serviceType_data()
+	{
+		QTest::addColumn<QString>("serviceUid");
+		QTest::addColumn<QString>("serviceType");
+		QTest::newRow("dbus") << QStringLiteral("dbus/com.victronenergy.battery.ttyUSB0") << QStringLiteral("battery");
+		QTest::newRow("mock") << QStringLiteral("mock/com.victronenergy.dcsource.1") << QStringLiteral("dcsource");
+		QTest::newRow("mqtt") << QStringLiteral("mqtt/alternator/279") << QStringLiteral("alternator");
+		QTest::newRow("extra mqtt source") << QStringLiteral("mqtt-b/battery/512") << QStringLiteral("battery");
+	}
+
+	void serviceType()
+	{
+		QFETCH(QString, serviceUid);
+		QFETCH(QString, serviceType);
+		QCOMPARE(FilteredDeviceModel::serviceType(serviceUid), serviceType);
+	}
+
+	void filter()
+	{
+		BaseDeviceModel sourceModel;
+		FilteredDeviceModel model;
+		model.setSourceModel(&sourceModel);
+		model.setServiceTypes({ QStringLiteral("alternator"), QStringLiteral("fuelcell") });
+		model.setFilterProperty(QStringLiteral("status"));
+		model.setFilterValues({ 1, 2 });
+
+		QList<BaseDevice *> devices = {
+			createDevice(QStringLiteral("alternator"), 0, 1, &sourceModel),
+			createDevice(QStringLiteral("alternator"), 1, 0, &sourceModel),
+			createDevice(QStringLiteral("fuelcell"), 2, 2, &sourceModel),
+			createDevice(QStringLiteral("dcsource"), 3, 1, &sourceModel),
+		};
+		sourceModel.addDevices(devices);
+		QCOMPARE(deviceInstances(model), QList<int>({ 0, 2 }));
+		QCOMPARE(model.firstObject(), devices.at(0));
+
+		// Changing the filter property of a device adds or removes only that device.
+		QSignalSpy insertSpy(&model, &FilteredDeviceModel::rowsInserted);
+		QSignalSpy removeSpy(&model, &FilteredDeviceModel::rowsRemoved);
+		QSignalSpy resetSpy(&model, &FilteredDeviceModel::modelReset);
+		static_cast<TestDevice *>(devices.at(1))->setStatus(2);
+		QCOMPARE(deviceInstances(model), QList<int>({ 0, 1, 2 }));
+		static_cast<TestDevice *>(devices.at(0))->setStatus(0);
+		QCOMPARE(deviceInstances(model), QList<int>({ 1, 2 }));
+		QCOMPARE(model.firstObject(), devices.at(1));
+		QCOMPARE(insertSpy.count(), 1);
+		QCOMPARE(removeSpy.count(), 1);
+		QCOMPARE(resetSpy.count(), 0);
+
+		// Devices removed from the source model are removed.
+		sourceModel.removeDevice(devices.at(2)->serviceUid());
+		QCOMPARE(deviceInstances(model), QList<int>({ 1 }));
+
+		// Changing the criteria rebuilds the model.
+		model.setServiceTypes({});
+		QCOMPARE(deviceInstances(model), QList<int>({ 1, 3 }));
+		QCOMPARE(resetSpy.count(), 1);
+	}
+
+	void sort()
+	{
+		BaseDeviceModel sourceModel;
+		FilteredDeviceModel model;
+		model.classBegin();
+		model.setSourceModel(&sourceModel);
+		model.setSortProperty(QStringLiteral("power"));
+		model.setSortOrder(Qt::DescendingOrder);
+		model.componentComplete();
+
+		QList<TestDevice *> devices;
+		for (int i = 0; i < 5; ++i) {
+			devices.append(createDevice(QStringLiteral("solarcharger"), i, 0, &sourceModel));
+			sourceModel.addDevice(devices.last());
+		}
+		// Devices without a value keep the source order, after the devices with a value.
+		QCOMPARE(deviceInstances(model), QList<int>({ 0, 1, 2, 3, 4 }));
+
+		devices.at(3)->setPower(100);
+		devices.at(1)->setPower(50);
+		devices.at(4)->setPower(500);
+		QCOMPARE(deviceInstances(model), QList<int>({ 4, 3, 1, 0, 2 }));
+
+		QSignalSpy moveSpy(&model, &FilteredDeviceModel::rowsMoved);
+		devices.at(4)->setPower(10);
+		QCOMPARE(deviceInstances(model), QList<int>({ 3, 1, 4, 0, 2 }));
+		devices.at(4)->setPower(qQNaN());
+		QCOMPARE(deviceInstances(model), QList<int>({ 3, 1, 0, 2, 4 }));
+		QCOMPARE(moveSpy.count(), 2);
+
+		model.setSortOrder(Qt::AscendingOrder);
+		QCOMPARE(deviceInstances(model), QList<int>({ 1, 3, 0, 2, 4 }));
+	}
+
+	// Compares a property change on one device of many with a full pass over all devices, which is
+	// what the pages did in JavaScript.
+	void propertyChanged_data()
+	{
+		QTest::addColumn<bool>("fullPass");
+		QTest::newRow("incremental") << false;
+		QTest::newRow("full pass") << true;
+	}
+
+	void propertyChanged()
+	{
+		QFETCH(bool, fullPass);
+		const int deviceCount = 500;
+		BaseDeviceModel sourceModel;
+		QList<BaseDevice *> devices;
+		for (int i = 0; i < deviceCount; ++i) {
+			devices.append(createDevice(QStringLiteral("evcharger"), i, i % 3, &sourceModel));
+		}
+		sourceModel.addDevices(devices);
+		FilteredDeviceModel model;
+		model.setSourceModel(&sourceModel);
+		model.setFilterProperty(QStringLiteral("status"));
+		model.setFilterValues({ 1 });
+
+		int i = 0;
+		QBENCHMARK {
+			TestDevice *device = static_cast<TestDevice *>(devices.at(i % deviceCount));
+			device->setStatus((device->status() + 1) % 3);
+			if (fullPass) {
+				int statusCount = 0;
+				for (int j = 0; j < sourceModel.count(); ++j) {
+					if (sourceModel.deviceAt(j)->property("status").toInt() == 1) {
+						++statusCount;
+					}
+				}
+				QVERIFY(statusCount > 0);
+			}
+			++i;
+		}
+		int expectedCount = 0;
+		for (BaseDevice *device : std::as_const(devices)) {
+			expectedCount += static_cast<TestDevice *>(device)->status() == 1 ? 1 : 0;
+		}
+		QCOMPARE(model.count(), expectedCount);
+	}
+};
+
+QTEST_GUILESS_MAIN(tst_FilteredDeviceModel)
+#include "tst_filtereddevicemodel.moc"
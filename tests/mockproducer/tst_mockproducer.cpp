@@ -0,0 +1,191 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include <QtTest/QtTest>
+
+#include "veqitemmockproducer.h"
+
+Q_LOGGING_CATEGORY(venusGui, "venus.gui")
+
+using namespace Victron::VenusOS;
+
+namespace {
+
+const QString CurrentLimitUid = QStringLiteral("com.victronenergy.vebus.ttyS4/Ac/ActiveIn/CurrentLimit");
+
+}
+
+class tst_MockProducer : public QObject
+{
+	Q_OBJECT
+
+private:
+	VeQItemMockProducer *m_source = nullptr;
+
+	VeQItem *sourceItem() const
+	{
+		return m_source->services()->itemGet(CurrentLimitUid);
+	}
+
+private slots:
+	void init()
+	{
+		m_source = new VeQItemMockProducer(VeQItems::getRoot(), QStringLiteral("mock"));
+		m_source->setValue(CurrentLimitUid, 0);
+		QVERIFY(sourceItem());
+	}
+
+	void cleanup()
+	{
+		m_source->services()->itemDelete();
+		delete m_source;
+		m_source = nullptr;
+	}
+
+	void fromString_data()
+	{
+		QTest::addColumn<QString>("conditions");
+		QTest::addColumn<int>("latency");
+		QTest::addColumn<int>("jitter");
+		QTest::addColumn<int>("burstInterval");
+		QTest::addColumn<qreal>("dropRate");
+		QTest::addColumn<int>("warningCount");
+
+		QTest::newRow("empty") << QString() << 0 << 0 << 0 << 0.0 << 0;
+		QTest::newRow("all") << "latency=300,jitter=100,drop=0.05,burst=2000" << 300 << 100 << 2000 << 0.05 << 0;
+		QTest::newRow("spaces") << " latency = 30 , jitter=20 " << 30 << 20 << 0 << 0.0 << 0;
+		QTest::newRow("drop clamped") << "drop=5" << 0 << 0 << 0 << 1.0 << 0;
+		QTest::newRow("no value") << "latency=30,jitter" << 30 << 0 << 0 << 0.0 << 1;
+		QTest::newRow("too many values") << "latency=30=40" << 0 << 0 << 0 << 0.0 << 1;
+		QTest::newRow("not a number") << "latency=slow,jitter=20" << 0 << 20 << 0 << 0.0 << 1;
+		QTest::newRow("negative") << "latency=-30,drop=-0.5" << 0 << 0 << 0 << 0.0 << 2;
+		QTest::newRow("unknown") << "latency=30,bandwidth=56" << 30 << 0 << 0 << 0.0 << 1;
+	}
+
+	void fromString()
+	{
+		QFETCH(QString, conditions);
+		QFETCH(int, latency);
+		QFETCH(int, jitter);
+		QFETCH(int, burstInterval);
+		QFETCH(qreal, dropRate);
+		QFETCH(int, warningCount);
+
+		// Invalid entries are reported and ignored, and the valid ones are still applied.
+		for (int i = 0; i < warningCount; ++i) {
+			QTest::ignoreMessage(QtWarningMsg, QRegularExpression(QStringLiteral("^Ignoring .*mock network condition")));
+		}
+		const MockNetworkConditions result = MockNetworkConditions::fromString(conditions);
+		QCOMPARE(result.latency, latency);
+		QCOMPARE(result.jitter, jitter);
+		QCOMPARE(result.burstInterval, burstInterval);
+		QCOMPARE(result.dropRate, dropRate);
+		QCOMPARE(result.isEmpty(), latency == 0 && jitter == 0 && burstInterval == 0 && dropRate == 0);
+	}
+
+	void delayedValues()
+	{
+		// Backend values arrive late and in order, despite the jitter.
+		m_source->setNetworkConditions(MockNetworkConditions::fromString(QStringLiteral("latency=30,jitter=20")));
+
+		QVariantList sourceValues;
+		connect(sourceItem(), &VeQItem::valueChanged, this, [&sourceValues](QVariant value) {
+			sourceValues.append(value);
+		});
+		for (int i = 1; i <= 20; ++i) {
+			m_source->setValue(CurrentLimitUid, i);
+		}
+		QCOMPARE(sourceItem()->getValue(), QVariant(0));
+		QTRY_COMPARE(sourceItem()->getValue(), QVariant(20));
+
+		QVariantList expected;
+		for (int i = 1; i <= 20; ++i) {
+			expected.append(i);
+		}
+		QCOMPARE(sourceValues, expected);
+	}
+
+	void delayedWrites()
+	{
+		// Writes also arrive late and in order, despite the jitter.
+		m_source->setNetworkConditions(MockNetworkConditions::fromString(QStringLiteral("latency=30,jitter=20")));
+
+		QVariantList sourceValues;
+		connect(sourceItem(), &VeQItem::valueChanged, this, [&sourceValues](QVariant value) {
+			sourceValues.append(value);
+		});
+		for (int i = 1; i <= 20; ++i) {
+			sourceItem()->setValue(i);
+		}
+		QCOMPARE(m_source->writeCount(), 20);
+		QTRY_COMPARE(sourceValues.count(), 20);
+
+		QVariantList expected;
+		for (int i = 1; i <= 20; ++i) {
+			expected.append(i);
+		}
+		QCOMPARE(sourceValues, expected);
+	}
+
+	void separatePaths()
+	{
+		// The read and write paths are ordered separately, so a slow write does not hold back
+		// the values from the backend that are sent after it, and the write still arrives.
+		MockNetworkConditions conditions;
+		conditions.latency = 10;
+		m_source->setNetworkConditions(conditions);
+		m_source->setWriteLatency(300);
+
+		QVariantList sourceValues;
+		connect(sourceItem(), &VeQItem::valueChanged, this, [&sourceValues](QVariant value) {
+			sourceValues.append(value);
+		});
+		sourceItem()->setValue(16);
+		m_source->setValue(CurrentLimitUid, 3);
+		QTRY_COMPARE(sourceValues, QVariantList({ 3 }));
+		QTRY_COMPARE(sourceValues, QVariantList({ 3, 16 }));
+	}
+
+	void burstDelivery()
+	{
+		// With a burst interval, the values are delivered together.
+		MockNetworkConditions conditions;
+		conditions.burstInterval = 200;
+		m_source->setNetworkConditions(conditions);
+
+		QElapsedTimer clock;
+		clock.start();
+		QVector<qint64> changeTimes;
+		connect(sourceItem(), &VeQItem::valueChanged, this, [&changeTimes, &clock] {
+			changeTimes.append(clock.elapsed());
+		});
+		for (int i = 1; i <= 5; ++i) {
+			m_source->setValue(CurrentLimitUid, i);
+			QTest::qWait(10);
+		}
+		QTRY_COMPARE(changeTimes.count(), 5);
+		QCOMPARE(sourceItem()->getValue(), QVariant(5));
+		QCOMPARE(changeTimes.constFirst(), changeTimes.constLast());
+	}
+
+	void droppedWrite()
+	{
+		// A dropped write never reaches the item, and is counted.
+		MockNetworkConditions conditions;
+		conditions.dropRate = 1.0;
+		m_source->setNetworkConditions(conditions);
+		QSignalSpy valueSpy(sourceItem(), &VeQItem::valueChanged);
+		sourceItem()->setValue(16);
+		m_source->setValue(CurrentLimitUid, 20);
+		QCOMPARE(m_source->writeCount(), 1);
+		QCOMPARE(m_source->droppedCount(), 2);
+		QTest::qWait(50);
+		QCOMPARE(valueSpy.count(), 0);
+		QCOMPARE(sourceItem()->getValue(), QVariant(0));
+	}
+};
+
+QTEST_GUILESS_MAIN(tst_MockProducer)
+#include "tst_mockproducer.moc"
@@ -0,0 +1,286 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include <QtTest/QtTest>
+
+#include "mqttpayloaddecoder.h"
+#include "spscqueue.h"
+#include "veqitemrecorder.h"
+
+#include <QtCore/QCborMap>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+
+using namespace Victron::VenusOS;
+
+class tst_MqttPayloadDecoder : public QObject
+{
+	Q_OBJECT
+
+private:
+	static MqttPayloadDecoder::MessageBatch createMessages(int count)
+	{
+		// Similar to the initial full publish: many services, each with a number of paths.
+		MqttPayloadDecoder::MessageBatch messages;
+		for (int i = 0; i < count; ++i) {
+			const QString topic = QStringLiteral("N/c0619ab00001/battery/%1/Dc/0/Path%2").arg(i / 100).arg(i % 100);
+			const QByteArray payload = QByteArrayLiteral("{\"value\": ") + QByteArray::number(i * 0.5) + '}';
+			messages.append({ QMqttTopicName(topic), payload });
+		}
+		return messages;
+	}
+
+	static QByteArray jsonPayload(const QVariant &value)
+	{
+		return QJsonDocument(QJsonObject{{ QStringLiteral("value"), QJsonValue::fromVariant(value) }}).toJson(QJsonDocument::Compact);
+	}
+
+	static QByteArray cborPayload(const QVariant &value)
+	{
+		return QCborMap{{ QStringLiteral("value"), QCborValue::fromVariant(value) }}.toCborValue().toCbor();
+	}
+
+	// Returns the (topic, value) pairs of a session recorded with --record, or if the
+	// MQTT_RECORDING environment variable is not set, of a synthetic 10-minute session: 50
+	// services with 20 paths each, where each path changes every 1 to 10 seconds.
+	static QVector<QPair<QString, QVariant> > sessionValues()
+	{
+		QVector<QPair<QString, QVariant> > values;
+		const QString portalTopic = QStringLiteral("N/c0619ab00001/%1");
+		const QString fileName = qEnvironmentVariable("MQTT_RECORDING");
+		if (!fileName.isEmpty()) {
+			QFile file(fileName);
+			if (!file.open(QIODevice::ReadOnly)) {
+				qWarning() << "Unable to open" << fileName;
+				return values;
+			}
+			QDataStream stream(&file);
+			stream.setVersion(VeQItemLog::StreamVersion);
+			quint32 magic = 0;
+			quint16 version = 0;
+			QByteArray prefix;
+			stream >> magic >> version >> prefix;
+			if (magic != VeQItemLog::Magic || version != VeQItemLog::Version) {
+				qWarning() << "Not a recording:" << fileName;
+				return values;
+			}
+			QStringList uids;
+			while (!stream.atEnd() && stream.status() == QDataStream::Ok) {
+				quint8 type = 0;
+				stream >> type;
+				if (type == VeQItemLog::UidRecord) {
+					quint32 uidIndex = 0;
+					QByteArray uid;
+					stream >> uidIndex >> uid;
+					uids.append(QString::fromUtf8(uid));
+				} else if (type == VeQItemLog::ValueRecord) {
+					quint32 time = 0;
+					quint32 uidIndex = 0;
+					QVariant value;
+					stream >> time >> uidIndex >> value;
+					if (uidIndex < quint32(uids.count())) {
+						values.append({ portalTopic.arg(uids.at(uidIndex)), value });
+					}
+				} else {
+					break;
+				}
+			}
+			return values;
+		}
+
+		QRandomGenerator random(1);
+		for (int second = 0; second < 600; ++second) {
+			for (int service = 0; service < 50; ++service) {
+				for (int path = 0; path < 20; ++path) {
+					if (second % (1 + (service + path) % 10) == 0) {
+						const QString topic = portalTopic.arg(QStringLiteral("battery/%1/Dc/0/Path%2").arg(service).arg(path));
+						const QVariant value = path % 5 == 0 ? QVariant(int(random.bounded(100)))
+								: QVariant(random.bounded(1000.0));
+						values.append({ topic, value });
+					}
+				}
+			}
+		}
+		return values;
+	}
+
+private Q_SLOTS:
+	void decode_data()
+	{
+		QTest::addColumn<QString>("topic");
+		QTest::addColumn<QByteArray>("payload");
+		QTest::addColumn<QString>("uid");
+		QTest::addColumn<QVariant>("value");
+
+		QTest::newRow("number") << "N/c0619ab00001/battery/512/Soc" << QByteArray("{\"value\": 73.5}")
+				<< "battery/512/Soc" << QVariant(73.5);
+		QTest::newRow("string") << "N/c0619ab00001/battery/512/ProductName" << QByteArray("{\"value\": \"SmartShunt\"}")
+				<< "battery/512/ProductName" << QVariant(QStringLiteral("SmartShunt"));
+		QTest::newRow("null") << "N/c0619ab00001/battery/512/TimeToGo" << QByteArray("{\"value\": null}")
+				<< "battery/512/TimeToGo" << QVariant();
+		QTest::newRow("removed") << "N/c0619ab00001/battery/512/Soc" << QByteArray()
+				<< "battery/512/Soc" << QVariant();
+		QTest::newRow("cbor number") << "N/c0619ab00001/battery/512/Soc" << cborPayload(73.5)
+				<< "battery/512/Soc" << QVariant(73.5);
+		QTest::newRow("cbor string") << "N/c0619ab00001/battery/512/ProductName" << cborPayload(QStringLiteral("SmartShunt"))
+				<< "battery/512/ProductName" << QVariant(QStringLiteral("SmartShunt"));
+		QTest::newRow("cbor null") << "N/c0619ab00001/battery/512/TimeToGo" << cborPayload(QVariant::fromValue(nullptr))
+				<< "battery/512/TimeToGo" << QVariant();
+		QTest::newRow("cbor self-describe") << "N/c0619ab00001/battery/512/Soc"
+				<< QCborValue(QCborKnownTags::Signature, QCborMap{{ QStringLiteral("value"), 73.5 }}).toCbor()
+				<< "battery/512/Soc" << QVariant(73.5);
+		QTest::newRow("control") << "N/c0619ab00001/full_publish_completed" << QByteArray("{\"full-publish-completed-echo\": \"x\"}")
+				<< QString() << QVariant();
+	}
+
+	void decode()
+	{
+		QFETCH(QString, topic);
+		QFETCH(QByteArray, payload);
+		QFETCH(QString, uid);
+		QFETCH(QVariant, value);
+
+		const MqttPayloadDecoder::Value decoded = MqttPayloadDecoder::decode({ QMqttTopicName(topic), payload });
+		QCOMPARE(decoded.uid, uid);
+		QCOMPARE(decoded.value.isValid(), value.isValid());
+		if (value.isValid()) {
+			QCOMPARE(decoded.value.toString(), value.toString());
+		}
+		QCOMPARE(decoded.message.topic.name(), topic);
+		QCOMPARE(decoded.message.payload, payload);
+	}
+
+	// Reports the payload bytes and decode time of a session in JSON and in CBOR. Topics are the
+	// same in both encodings, so they are not counted.
+	void payloadEncodingComparison()
+	{
+		const QVector<QPair<QString, QVariant> > values = sessionValues();
+		QVERIFY(!values.isEmpty());
+
+		MqttPayloadDecoder::MessageBatch jsonMessages;
+		MqttPayloadDecoder::MessageBatch cborMessages;
+		qint64 jsonBytes = 0;
+		qint64 cborBytes = 0;
+		for (const QPair<QString, QVariant> &value : values) {
+			const QMqttTopicName topic(value.first);
+			jsonMessages.append({ topic, jsonPayload(value.second) });
+			cborMessages.append({ topic, cborPayload(value.second) });
+			jsonBytes += jsonMessages.last().payload.size();
+			cborBytes += cborMessages.last().payload.size();
+		}
+
+		QElapsedTimer timer;
+		timer.start();
+		for (const MqttPayloadDecoder::Message &message : jsonMessages) {
+			MqttPayloadDecoder::decode(message);
+		}
+		const qint64 jsonNsecs = timer.nsecsElapsed();
+		timer.restart();
+		for (const MqttPayloadDecoder::Message &message : cborMessages) {
+			MqttPayloadDecoder::decode(message);
+		}
+		const qint64 cborNsecs = timer.nsecsElapsed();
+
+		for (int i = 0; i < values.count(); i += qMax(1, values.count() / 100)) {
+			QCOMPARE(MqttPayloadDecoder::decode(cborMessages.at(i)).value,
+					MqttPayloadDecoder::decode(jsonMessages.at(i)).value);
+		}
+
+		qInfo() << values.count() << "messages: JSON" << jsonBytes << "payload bytes, decoded in" << jsonNsecs / 1000 << "us;"
+				<< "CBOR" << cborBytes << "payload bytes, decoded in" << cborNsecs / 1000 << "us";
+	}
+
+	void spscQueueKeepsOrder()
+	{
+		const int count = 100000;
+		SpscQueue<int> queue(64);
+		QScopedPointer<QThread> producer(QThread::create([&queue] {
+			for (int i = 0; i < count; ++i) {
+				int value = i;
+				while (!queue.push(std::move(value))) {
+					QThread::yieldCurrentThread();
+				}
+			}
+		}));
+		producer->start();
+
+		int expected = 0;
+		int value = -1;
+		while (expected < count) {
+			if (queue.pop(&value)) {
+				QCOMPARE(value, expected);
+				expected++;
+			}
+		}
+		producer->wait();
+		QVERIFY(queue.isEmpty());
+	}
+
+	void decoderKeepsOrder()
+	{
+		MqttPayloadDecoder decoder;
+		QVector<MqttPayloadDecoder::Value> values;
+		connect(&decoder, &MqttPayloadDecoder::batchDecoded, this, [&values](const MqttPayloadDecoder::ValueBatch &batch) {
+			values += batch;
+		});
+
+		const MqttPayloadDecoder::MessageBatch messages = createMessages(1000);
+		for (const MqttPayloadDecoder::Message &message : messages) {
+			decoder.enqueue(message.topic, message.payload);
+		}
+		decoder.enqueue(QMqttTopicName(QStringLiteral("N/c0619ab00001/full_publish_completed")), QByteArray());
+
+		QTRY_COMPARE(values.count(), messages.count() + 1);
+		for (int i = 0; i < messages.count(); ++i) {
+			QCOMPARE(values.at(i).uid, MqttPayloadDecoder::decode(messages.at(i)).uid);
+			QCOMPARE(values.at(i).value, MqttPayloadDecoder::decode(messages.at(i)).value);
+		}
+		QVERIFY(values.last().uid.isEmpty());
+	}
+
+	// Reports the time spent on the GUI (i.e. test) thread for 10000 messages, when decoding on
+	// that thread, and when decoding on the worker thread. In both cases the decoded values are
+	// stored on the GUI thread, as the backend does when producing item values.
+	void guiThreadTimePer10kMessages()
+	{
+		const int count = 10000;
+		const MqttPayloadDecoder::MessageBatch messages = createMessages(count);
+		QElapsedTimer timer;
+
+		QHash<QString, QVariant> inlineValues;
+		timer.start();
+		for (const MqttPayloadDecoder::Message &message : messages) {
+			const MqttPayloadDecoder::Value value = MqttPayloadDecoder::decode(message);
+			inlineValues.insert(value.uid, value.value);
+		}
+		const qint64 inlineNsecs = timer.nsecsElapsed();
+
+		QHash<QString, QVariant> workerValues;
+		qint64 workerNsecs = 0;
+		MqttPayloadDecoder decoder;
+		connect(&decoder, &MqttPayloadDecoder::batchDecoded, this, [&](const MqttPayloadDecoder::ValueBatch &batch) {
+			QElapsedTimer batchTimer;
+			batchTimer.start();
+			for (const MqttPayloadDecoder::Value &value : batch) {
+				workerValues.insert(value.uid, value.value);
+			}
+			workerNsecs += batchTimer.nsecsElapsed();
+		});
+		timer.restart();
+		for (const MqttPayloadDecoder::Message &message : messages) {
+			decoder.enqueue(message.topic, message.payload);
+		}
+		workerNsecs += timer.nsecsElapsed();
+		QTRY_COMPARE(workerValues.count(), inlineValues.count());
+		QCOMPARE(workerValues, inlineValues);
+
+		qInfo() << "GUI thread time per 10000 messages: decoding on GUI thread" << inlineNsecs / 1000 << "us,"
+				<< "decoding on worker thread" << workerNsecs / 1000 << "us";
+	}
+};
+
+QTEST_GUILESS_MAIN(tst_MqttPayloadDecoder)
+
+#include "tst_mqttpayloaddecoder.moc"
@@ -0,0 +1,268 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include <QtTest/QtTest>
+#include <QtQml/QQmlComponent>
+#include <QtQml/QQmlEngine>
+
+#include "batterydevice.h"
+#include "veqitemmockproducer.h"
+#include "veutil/qt/ve_quick_item.hpp"
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+Q_LOGGING_CATEGORY(venusGui, "venus.gui")
+
+using namespace Victron::VenusOS;
+
+namespace {
+
+const int BatteryCount = 50;
+
+// The previous Battery.qml, with Device.qml inlined: one VeQuickItem per path.
+const char *VeQuickItemBattery = R"(
+import QtQml
+import Victron.VenusOS
+
+BaseDevice {
+	id: battery
+
+	property bool valid: deviceInstance >= 0
+	readonly property string customName: _customName.value || ""
+	readonly property string productName: _productName.value || ""
+	readonly property real stateOfCharge: _stateOfCharge.value === undefined ? NaN : _stateOfCharge.value
+	readonly property real voltage: _voltage.value === undefined ? NaN : _voltage.value
+	readonly property real power: _power.value === undefined ? NaN : _power.value
+	readonly property real current: _current.value === undefined ? NaN : _current.value
+	readonly property real temperature: _temperature.value === undefined ? NaN : _temperature.value
+	readonly property real timeToGo: _timeToGo.value === undefined ? NaN : _timeToGo.value
+
+	readonly property VeQuickItem _deviceInstance: VeQuickItem { uid: battery.serviceUid ? battery.serviceUid + "/DeviceInstance" : "" }
+	readonly property VeQuickItem _customName: VeQuickItem { uid: battery.serviceUid ? battery.serviceUid + "/CustomName" : "" }
+	readonly property VeQuickItem _productName: VeQuickItem { uid: battery.serviceUid ? battery.serviceUid + "/ProductName" : "" }
+	readonly property VeQuickItem _stateOfCharge: VeQuickItem { uid: battery.serviceUid + "/Soc" }
+	readonly property VeQuickItem _voltage: VeQuickItem { uid: battery.serviceUid + "/Dc/0/Voltage" }
+	readonly property VeQuickItem _power: VeQuickItem { uid: battery.serviceUid + "/Dc/0/Power" }
+	readonly property VeQuickItem _current: VeQuickItem { uid: battery.serviceUid + "/Dc/0/Current" }
+	readonly property VeQuickItem _temperature: VeQuickItem { uid: battery.serviceUid + "/Dc/0/Temperature" }
+	readonly property VeQuickItem _timeToGo: VeQuickItem { uid: battery.serviceUid + "/TimeToGo" }
+
+	deviceInstance: _deviceInstance.value === undefined ? -1 : _deviceInstance.value
+	name: _customName.value || _productName.value || ""
+	description: name
+}
+)";
+
+const char *ServiceDeviceBattery = R"(
+import QtQml
+import Victron.VenusOS
+
+BatteryDevice {}
+)";
+
+QString batteryUid(int index)
+{
+	return QStringLiteral("com.victronenergy.battery.ttyUSB%1").arg(index);
+}
+
+size_t allocatedBytes()
+{
+#if defined(__GLIBC__)
+	return mallinfo2().uordblks;
+#else
+	return 0;
+#endif
+}
+
+int objectCount(QObject *object)
+{
+	return 1 + static_cast<int>(object->findChildren<QObject *>().count());
+}
+
+}
+
+class tst_ServiceDevice : public QObject
+{
+	Q_OBJECT
+
+private:
+	VeQItemMockProducer *m_producer = nullptr;
+
+	QList<QObject *> createBatteries(QQmlEngine *engine, const char *qml, int count)
+	{
+		QQmlComponent component(engine);
+		component.setData(qml, QUrl());
+		QList<QObject *> batteries;
+		for (int i = 0; i < count; ++i) {
+			QObject *battery = component.createWithInitialProperties({
+				{ QStringLiteral("serviceUid"), QStringLiteral("mock/") + batteryUid(i) }
+			});
+			if (!battery) {
+				qWarning() << component.errors();
+				break;
+			}
+			batteries.append(battery);
+		}
+		return batteries;
+	}
+
+	void publishBattery(int index)
+	{
+		const QString uid = batteryUid(index);
+		m_producer->setValue(uid + QStringLiteral("/DeviceInstance"), 512 + index);
+		m_producer->setValue(uid + QStringLiteral("/ProductName"), QStringLiteral("SmartShunt"));
+		m_producer->setValue(uid + QStringLiteral("/Soc"), 80);
+		m_producer->setValue(uid + QStringLiteral("/Dc/0/Voltage"), 12.8);
+		m_producer->setValue(uid + QStringLiteral("/Dc/0/Power"), -120);
+		m_producer->setValue(uid + QStringLiteral("/Dc/0/Current"), -9.4);
+		m_producer->setValue(uid + QStringLiteral("/Dc/0/Temperature"), 22);
+		m_producer->setValue(uid + QStringLiteral("/TimeToGo"), 3600);
+	}
+
+private slots:
+	void initTestCase()
+	{
+		qmlRegisterType<BaseDevice>("Victron.VenusOS", 2, 0, "BaseDevice");
+		qmlRegisterType<BatteryDevice>("Victron.VenusOS", 2, 0, "BatteryDevice");
+		qmlRegisterType<VeQuickItem>("Victron.VenusOS", 2, 0, "VeQuickItem");
+
+		m_producer = new VeQItemMockProducer(VeQItems::getRoot(), QStringLiteral("mock"));
+		for (int i = 0; i < BatteryCount; ++i) {
+			publishBattery(i);
+		}
+	}
+
+	void cleanupTestCase()
+	{
+		m_producer->services()->itemDelete();
+		delete m_producer;
+	}
+
+	void values()
+	{
+		QQmlEngine engine;
+		const QList<QObject *> batteries = createBatteries(&engine, ServiceDeviceBattery, 1);
+		QCOMPARE(batteries.count(), 1);
+		QScopedPointer<BatteryDevice> battery(qobject_cast<BatteryDevice *>(batteries.constFirst()));
+		QVERIFY(battery);
+		QCOMPARE(battery->deviceInstance(), 512);
+		QVERIFY(battery->isValid());
+		QCOMPARE(battery->name(), QStringLiteral("SmartShunt"));
+		QCOMPARE(battery->description(), QStringLiteral("SmartShunt"));
+		QCOMPARE(battery->stateOfCharge(), 80.0);
+		QCOMPARE(battery->current(), -9.4);
+		QCOMPARE(battery->property("timeToGo").toReal(), 3600.0);
+
+		// Value changes update the property and emit its notify signal.
+		QSignalSpy socSpy(battery.data(), &BatteryDevice::stateOfChargeChanged);
+		QSignalSpy powerSpy(battery.data(), &BatteryDevice::powerChanged);
+		m_producer->setValue(batteryUid(0) + QStringLiteral("/Soc"), 79);
+		QCOMPARE(battery->stateOfCharge(), 79.0);
+		QCOMPARE(socSpy.count(), 1);
+		QCOMPARE(powerSpy.count(), 0);
+
+		m_producer->setValue(batteryUid(0) + QStringLiteral("/CustomName"), QStringLiteral("House"));
+		QCOMPARE(battery->customName(), QStringLiteral("House"));
+		QCOMPARE(battery->name(), QStringLiteral("House"));
+		m_producer->setValue(batteryUid(0) + QStringLiteral("/CustomName"), QString());
+
+		// Invalid values become NaN, as in the QML bindings.
+		m_producer->setValue(batteryUid(0) + QStringLiteral("/Dc/0/Power"), QVariant());
+		QVERIFY(qIsNaN(battery->power()));
+		QCOMPARE(powerSpy.count(), 1);
+
+		// Changing the service rebinds all values.
+		QSignalSpy validSpy(battery.data(), &ServiceDevice::validChanged);
+		battery->setServiceUid(QStringLiteral("mock/com.victronenergy.battery.missing"));
+		QVERIFY(!battery->isValid());
+		QVERIFY(qIsNaN(battery->stateOfCharge()));
+		QCOMPARE(validSpy.count(), 1);
+		battery->setServiceUid(QStringLiteral("mock/") + batteryUid(1));
+		QVERIFY(battery->isValid());
+		QCOMPARE(battery->deviceInstance(), 513);
+		QCOMPARE(battery->stateOfCharge(), 80.0);
+		m_producer->setValue(batteryUid(0) + QStringLiteral("/Soc"), 80);
+		m_producer->setValue(batteryUid(0) + QStringLiteral("/Dc/0/Power"), -120);
+	}
+
+	void recreatedItems()
+	{
+		// When the service is removed and published again, the device follows the new items.
+		QQmlEngine engine;
+		const QList<QObject *> batteries = createBatteries(&engine, ServiceDeviceBattery, 3);
+		QCOMPARE(batteries.count(), 3);
+		QScopedPointer<BatteryDevice> battery(qobject_cast<BatteryDevice *>(batteries.at(2)));
+		qDeleteAll(batteries.mid(0, 2));
+		QCOMPARE(battery->stateOfCharge(), 80.0);
+
+		m_producer->services()->itemGet(batteryUid(2))->itemDelete();
+		QTRY_VERIFY(!battery->isValid());
+		QVERIFY(qIsNaN(battery->stateOfCharge()));
+
+		publishBattery(2);
+		QVERIFY(battery->isValid());
+		QCOMPARE(battery->deviceInstance(), 514);
+		QCOMPARE(battery->stateOfCharge(), 80.0);
+		m_producer->setValue(batteryUid(2) + QStringLiteral("/Soc"), 75);
+		QCOMPARE(battery->stateOfCharge(), 75.0);
+		m_producer->setValue(batteryUid(2) + QStringLiteral("/Soc"), 80);
+	}
+
+	// Compares the QObjects and heap memory used by 50 batteries with one VeQuickItem per path, and
+	// 50 BatteryDevice objects.
+	void batteryFootprint_data()
+	{
+		QTest::addColumn<bool>("veQuickItems");
+		QTest::newRow("VeQuickItem per path") << true;
+		QTest::newRow("BatteryDevice") << false;
+	}
+
+	void batteryFootprint()
+	{
+		QFETCH(bool, veQuickItems);
+		QQmlEngine engine;
+
+		// Create one battery first, so that the component compilation is not counted.
+		qDeleteAll(createBatteries(&engine, veQuickItems ? VeQuickItemBattery : ServiceDeviceBattery, 1));
+
+		const size_t bytesBefore = allocatedBytes();
+		const QList<QObject *> batteries = createBatteries(&engine, veQuickItems ? VeQuickItemBattery : ServiceDeviceBattery, BatteryCount);
+		const size_t bytesAfter = allocatedBytes();
+		QCOMPARE(batteries.count(), BatteryCount);
+
+		int objects = 0;
+		for (QObject *battery : batteries) {
+			objects += objectCount(battery);
+			QCOMPARE(battery->property("stateOfCharge").toReal(), 80.0);
+			QCOMPARE(battery->property("name").toString(), QStringLiteral("SmartShunt"));
+		}
+		qInfo() << BatteryCount << "batteries with" << (veQuickItems ? "a VeQuickItem per path:" : "BatteryDevice:")
+				<< objects << "QObjects," << (bytesAfter - bytesBefore) / 1024 << "KiB allocated";
+		QCOMPARE(objects, veQuickItems ? BatteryCount * 10 : BatteryCount);
+
+		qDeleteAll(batteries);
+	}
+
+	void createBatteries_data()
+	{
+		batteryFootprint_data();
+	}
+
+	void createBatteries()
+	{
+		QFETCH(bool, veQuickItems);
+		QQmlEngine engine;
+		QBENCHMARK {
+			const QList<QObject *> batteries = createBatteries(&engine, veQuickItems ? VeQuickItemBattery : ServiceDeviceBattery, BatteryCount);
+			QCOMPARE(batteries.count(), BatteryCount);
+			qDeleteAll(batteries);
+		}
+	}
+};
+
+QTEST_GUILESS_MAIN(tst_ServiceDevice)
+#include "tst_servicedevice.moc"
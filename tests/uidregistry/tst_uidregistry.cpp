@@ -0,0 +1,23 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include <QtQuickTest/quicktest.h>
+#include <QtQml/QQmlEngine>
+#include "uidregistry.h"
+
+static QObject *registryFactory(QQmlEngine *engine, QJSEngine *jsEngine)
+{
+	QObject *registry = Victron::VenusOS::UidRegistry::create(engine, jsEngine);
+	QJSEngine::setObjectOwnership(registry, QJSEngine::CppOwnership);
+	return registry;
+}
+
+int main(int argc, char **argv) \
+{
+	qmlRegisterSingletonType<Victron::VenusOS::UidRegistry>("Victron.VenusOS", 2, 0, "UidRegistry", registryFactory);
+
+	QTEST_SET_MAIN_SOURCE_PATH
+	return quick_test_main(argc, argv, "tst_uidregistry", nullptr);
+}
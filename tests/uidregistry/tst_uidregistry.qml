@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2024 Victron Energy B.V.
+ * See LICENSE.txt for license information.
+*/
+
+import QtTest
+import Victron.VenusOS
+
+TestCase {
+	name: "UidRegistry"
+
+	// A tree similar to a large installation: 50 services with 400 paths each.
+	readonly property int serviceCount: 50
+	readonly property int pathCount: 400
+
+	function servicePrefix(i) {
+		return "mqtt/solarcharger/" + (100 + i)
+	}
+
+	function test_handles() {
+		const handle = UidRegistry.handle("mqtt/battery/512/Dc/0/Voltage")
+		verify(handle > 0)
+		compare(UidRegistry.handle("mqtt/battery/512/Dc/0/Voltage"), handle)
+		compare(UidRegistry.uid(handle), "mqtt/battery/512/Dc/0/Voltage")
+
+		const parent = UidRegistry.parentHandle(handle)
+		compare(UidRegistry.uid(parent), "mqtt/battery/512/Dc/0")
+		compare(UidRegistry.childHandle(parent, "Voltage"), handle)
+		compare(UidRegistry.childHandle(UidRegistry.handle("mqtt/battery/512"), "Dc/0/Voltage"), handle)
+
+		compare(UidRegistry.handle(""), 0)
+		compare(UidRegistry.uid(0), "")
+		compare(UidRegistry.uid(-1), "")
+	}
+
+	function test_queriesDoNotRegister() {
+		const countBefore = UidRegistry.count()
+		compare(UidRegistry.find("mqtt/dcdc/7/Dc/0/Power"), 0)
+		compare(UidRegistry.serviceTypeFromUid("mqtt/dcdc/7/Dc/0/Power"), "dcdc")
+		compare(UidRegistry.serviceTypeFromUid("mqtt-b/dcdc/7"), "dcdc")
+		compare(UidRegistry.serviceTypeFromUid("dbus/com.victronenergy.dcdc.ttyS3/Dc/0/Power"), "dcdc")
+		compare(UidRegistry.serviceTypeFromUid("mqtt"), "")
+		compare(UidRegistry.count(), countBefore)
+
+		const handle = UidRegistry.handle("mqtt/dcdc/7/Dc/0/Power")
+		compare(UidRegistry.find("mqtt/dcdc/7/Dc/0/Power"), handle)
+		compare(UidRegistry.find("mqtt/dcdc/7/Dc/1"), 0)
+	}
+
+	function test_childUid() {
+		compare(UidRegistry.childUid("mqtt/solarcharger/279", "History/Daily/3"), "mqtt/solarcharger/279/History/Daily/3")
+		compare(UidRegistry.childUid("mqtt/solarcharger/279/", "/History/Daily/3/"), "mqtt/solarcharger/279/History/Daily/3")
+		compare(UidRegistry.childUid("mqtt/solarcharger/279", ""), "mqtt/solarcharger/279")
+
+		// Composing from handles gives the same uids, whether or not the parent uid is cached.
+		const day = UidRegistry.handle("mqtt/solarcharger/280/History/Daily/3")
+		const tracker = UidRegistry.childHandle(UidRegistry.childHandle(day, "Pv"), 1)
+		compare(UidRegistry.uid(tracker), "mqtt/solarcharger/280/History/Daily/3/Pv/1")
+		compare(UidRegistry.uid(day), "mqtt/solarcharger/280/History/Daily/3")
+		compare(UidRegistry.uid(tracker), "mqtt/solarcharger/280/History/Daily/3/Pv/1")
+	}
+
+	function test_serviceFields_data() {
+		return [
+			{ tag: "mqtt", uid: "mqtt/battery/512/Dc/0/Voltage", serviceType: "battery", serviceUid: "mqtt/battery/512", deviceInstance: 512 },
+			{ tag: "mqtt service", uid: "mqtt/tank/3", serviceType: "tank", serviceUid: "mqtt/tank/3", deviceInstance: 3 },
+			{ tag: "mqtt service type", uid: "mqtt/tank", serviceType: "tank", serviceUid: "", deviceInstance: -1 },
+			{ tag: "dbus", uid: "dbus/com.victronenergy.battery.ttyUSB1/Soc", serviceType: "battery", serviceUid: "dbus/com.victronenergy.battery.ttyUSB1", deviceInstance: -1 },
+			{ tag: "dbus no suffix", uid: "dbus/com.victronenergy.system/Dc/Battery/Power", serviceType: "system", serviceUid: "dbus/com.victronenergy.system", deviceInstance: -1 },
+			{ tag: "mock", uid: "mock/com.victronenergy.tank.fleet_1/Level", serviceType: "tank", serviceUid: "mock/com.victronenergy.tank.fleet_1", deviceInstance: -1 },
+		]
+	}
+
+	function test_serviceFields(data) {
+		const handle = UidRegistry.handle(data.uid)
+		compare(UidRegistry.serviceType(handle), data.serviceType)
+		compare(UidRegistry.serviceTypeFromUid(data.uid), data.serviceType)
+		compare(UidRegistry.serviceUid(handle), data.serviceUid)
+		compare(UidRegistry.deviceInstance(handle), data.deviceInstance)
+	}
+
+	function test_memoryUsage() {
+		const countBefore = UidRegistry.count()
+		const memoryBefore = UidRegistry.memoryUsage()
+		let stringBytes = 0
+		for (let i = 0; i < serviceCount; ++i) {
+			for (let j = 0; j < pathCount; ++j) {
+				const uid = servicePrefix(i) + "/History/Daily/" + j
+				UidRegistry.handle(uid)
+				// A separately allocated QString: header plus UTF-16 data.
+				stringBytes += 24 + uid.length * 2
+			}
+		}
+		const added = UidRegistry.count() - countBefore
+		verify(added >= serviceCount * pathCount)
+		console.log("Memory for", serviceCount * pathCount, "uids: registry",
+				UidRegistry.memoryUsage() - memoryBefore, "bytes, separate strings", stringBytes, "bytes")
+	}
+
+	// CPU comparison: finding the service type of a uid by splitting strings, as
+	// BackendConnection.serviceTypeFromUid() did, versus a registry lookup.
+	function benchmark_serviceTypeBySplitting() {
+		for (let i = 0; i < serviceCount; ++i) {
+			for (let j = 0; j < pathCount; j += 10) {
+				const uid = servicePrefix(i) + "/History/Daily/" + j
+				compare(uid.split("/")[1], "solarcharger")
+			}
+		}
+	}
+
+	function benchmark_serviceTypeFromRegistry() {
+		for (let i = 0; i < serviceCount; ++i) {
+			const dailyHandle = UidRegistry.handle(servicePrefix(i) + "/History/Daily")
+			for (let j = 0; j < pathCount; j += 10) {
+				compare(UidRegistry.serviceType(UidRegistry.childHandle(dailyHandle, j)), "solarcharger")
+			}
+		}
+	}
+
+	// Composing child uids by concatenation versus from a registered parent.
+	function benchmark_composeByConcatenation() {
+		let total = 0
+		for (let i = 0; i < serviceCount; ++i) {
+			const prefix = servicePrefix(i)
+			for (let j = 0; j < pathCount; j += 10) {
+				total += (prefix + "/History/Daily/" + j).length
+			}
+		}
+		verify(total > 0)
+	}
+
+	function benchmark_composeFromRegistry() {
+		let total = 0
+		for (let i = 0; i < serviceCount; ++i) {
+			const dailyHandle = UidRegistry.handle(servicePrefix(i) + "/History/Daily")
+			for (let j = 0; j < pathCount; j += 10) {
+				total += UidRegistry.uid(UidRegistry.childHandle(dailyHandle, j)).length
+			}
+		}
+		verify(total > 0)
+	}
+}
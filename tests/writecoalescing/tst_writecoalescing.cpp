@@ -0,0 +1,204 @@
+/*
+** Copyright (C) 2024 Victron Energy B.V.
+** See LICENSE.txt for license information.
+*/
+
+#include <QtTest/QtTest>
+
+#include "veqitemcoalescingproducer.h"
+#include "veqitemmockproducer.h"
+
+Q_LOGGING_CATEGORY(venusGui, "venus.gui")
+
+using namespace Victron::VenusOS;
+
+namespace {
+
+const QString CurrentLimitUid = QStringLiteral("com.victronenergy.vebus.ttyS4/Ac/ActiveIn/CurrentLimit");
+
+}
+
+class tst_WriteCoalescing : public QObject
+{
+	Q_OBJECT
+
+private:
+	VeQItemMockProducer *m_source = nullptr;
+	VeQItemCoalescingProducer *m_mirror = nullptr;
+
+	VeQItem *sourceItem() const
+	{
+		return m_source->services()->itemGet(CurrentLimitUid);
+	}
+
+	VeQItem *mirrorItem() const
+	{
+		return m_mirror->services()->itemGet(CurrentLimitUid);
+	}
+
+private slots:
+	void init()
+	{
+		// The source producer plays the role of the MQTT or D-Bus backend.
+		m_source = new VeQItemMockProducer(VeQItems::getRoot(), QStringLiteral("mock"));
+		m_source->setValue(CurrentLimitUid, 0);
+		m_mirror = new VeQItemCoalescingProducer(VeQItems::getRoot(), QStringLiteral("coalesced"), m_source->services());
+
+		// Like a VeQuickItem, create the item in the mirror tree and connect to it. It is bound to
+		// its source and shows the source value straight away.
+		VeQItem *item = m_mirror->services()->itemGetOrCreate(CurrentLimitUid);
+		connect(item, &VeQItem::valueChanged, this, [] {});
+		QCOMPARE(mirrorItem(), item);
+		QCOMPARE(mirrorItem()->getValue(), QVariant(0));
+	}
+
+	void cleanup()
+	{
+		m_mirror->services()->itemDelete();
+		m_source->services()->itemDelete();
+		delete m_mirror;
+		m_mirror = nullptr;
+		delete m_source;
+		m_source = nullptr;
+	}
+
+	void lazyMirror()
+	{
+		// Items below the services are only mirrored when they are used.
+		const QString voltageUid = QStringLiteral("com.victronenergy.vebus.ttyS4/Ac/ActiveIn/L1/V");
+		m_source->setValue(voltageUid, 230);
+		VeQItem *activeIn = m_mirror->services()->itemGet(QStringLiteral("com.victronenergy.vebus.ttyS4/Ac/ActiveIn"));
+		QVERIFY(activeIn);
+		QVERIFY(!activeIn->itemGet(QStringLiteral("L1")));
+
+		// The children of an item are mirrored once something connects to its childAdded().
+		QStringList addedIds;
+		connect(activeIn, &VeQItem::childAdded, this, [&addedIds](VeQItem *child) {
+			addedIds.append(child->id());
+		});
+		QTRY_COMPARE(addedIds, QStringList({ QStringLiteral("L1") }));
+
+		// The values below a mirrored child are mirrored when they are used.
+		VeQItem *voltage = m_mirror->services()->itemGetOrCreate(voltageUid);
+		connect(voltage, &VeQItem::stateChanged, this, [] {});
+		QCOMPARE(voltage->getValue(), QVariant(230));
+
+		// A source child added later to a consumed item is mirrored straight away.
+		m_source->setValue(QStringLiteral("com.victronenergy.vebus.ttyS4/Ac/ActiveIn/L2/V"), 231);
+		QCOMPARE(addedIds, QStringList({ QStringLiteral("L1"), QStringLiteral("L2") }));
+	}
+
+	void sliderDrag()
+	{
+		m_source->setWriteLatency(50);
+
+		// Record every value shown by the mirrored item.
+		QVariantList shownValues;
+		connect(mirrorItem(), &VeQItem::valueChanged, this, [&shownValues](QVariant value) {
+			shownValues.append(value);
+		});
+
+		for (int i = 1; i <= 100; ++i) {
+			QCOMPARE(mirrorItem()->setValue(i), 0);
+			// The written value is shown straight away.
+			QCOMPARE(mirrorItem()->getValue(), QVariant(i));
+		}
+
+		// Only the first write has been sent, and the last one is queued.
+		QCOMPARE(m_source->writeCount(), 1);
+		QCOMPARE(m_mirror->coalescedWriteCount(), 98);
+
+		QTRY_COMPARE(sourceItem()->getValue(), QVariant(100));
+		QCOMPARE(m_source->writeCount(), 2);
+		m_mirror->flush();
+		QCOMPARE(mirrorItem()->getValue(), QVariant(100));
+
+		// The confirmation of the first write did not move the mirrored item back.
+		for (int i = 1; i < shownValues.count(); ++i) {
+			QVERIFY2(shownValues.at(i).toInt() > shownValues.at(i - 1).toInt(),
+					qPrintable(QStringLiteral("%1 shown after %2").arg(shownValues.at(i).toInt()).arg(shownValues.at(i - 1).toInt())));
+		}
+	}
+
+	void noLatency()
+	{
+		// Writes that complete immediately are not coalesced.
+		for (int i = 1; i <= 10; ++i) {
+			mirrorItem()->setValue(i);
+			QCOMPARE(sourceItem()->getValue(), QVariant(i));
+		}
+		QCOMPARE(m_source->writeCount(), 10);
+		QCOMPARE(m_mirror->coalescedWriteCount(), 0);
+	}
+
+	void currentValueWrite()
+	{
+		// Writing the current value does not change the source, so the write completes straight
+		// away and the next write is sent without waiting for the timeout.
+		m_source->setWriteLatency(10);
+		mirrorItem()->setValue(0);
+		mirrorItem()->setValue(5);
+		QCOMPARE(m_source->writeCount(), 2);
+		QTRY_COMPARE_WITH_TIMEOUT(sourceItem()->getValue(), QVariant(5), 500);
+	}
+
+	void clampedWrite()
+	{
+		// A source change that does not confirm the write, e.g. when the backend clamps the
+		// written value, does not complete it. The written value is shown until the write times
+		// out, and then the source value.
+		MockNetworkConditions conditions;
+		conditions.dropRate = 1.0;
+		m_source->setNetworkConditions(conditions);
+		mirrorItem()->setValue(500);
+		m_source->setNetworkConditions(MockNetworkConditions());
+		m_source->setValue(CurrentLimitUid, 100);
+		m_mirror->flush();
+		QCOMPARE(mirrorItem()->getValue(), QVariant(500));
+		QTRY_COMPARE_WITH_TIMEOUT(mirrorItem()->getValue(), QVariant(100), 3000);
+	}
+
+	void unrelatedChangeDuringWrite()
+	{
+		// A source change before the confirmation, e.g. a value published by another client,
+		// does not show an older value between the written value and its confirmation.
+		m_source->setWriteLatency(50);
+		QVariantList shownValues;
+		connect(mirrorItem(), &VeQItem::valueChanged, this, [&shownValues](QVariant value) {
+			shownValues.append(value);
+		});
+		mirrorItem()->setValue(16);
+		m_source->setValue(CurrentLimitUid, 3);
+		m_mirror->flush();
+		QCOMPARE(mirrorItem()->getValue(), QVariant(16));
+
+		QTRY_COMPARE(sourceItem()->getValue(), QVariant(16));
+		m_mirror->flush();
+		QCOMPARE(shownValues, QVariantList({ 16 }));
+		QCOMPARE(m_source->writeCount(), 1);
+	}
+
+	void sourceUpdatesDuringWrite()
+	{
+		// An update from the backend sends the queued write without waiting for the confirmation
+		// of the first one. That late confirmation neither completes the second write nor is
+		// shown.
+		m_source->setWriteLatency(50);
+		QVariantList shownValues;
+		connect(mirrorItem(), &VeQItem::valueChanged, this, [&shownValues](QVariant value) {
+			shownValues.append(value);
+		});
+		mirrorItem()->setValue(16);
+		mirrorItem()->setValue(20);
+		m_source->setValue(CurrentLimitUid, 3);
+		m_mirror->flush();
+		QCOMPARE(m_source->writeCount(), 2);
+
+		QTRY_COMPARE(sourceItem()->getValue(), QVariant(20));
+		m_mirror->flush();
+		QCOMPARE(shownValues, QVariantList({ 16, 20 }));
+	}
+};
+
+QTEST_GUILESS_MAIN(tst_WriteCoalescing)
+#include "tst_writecoalescing.moc"
@@ -0,0 +1,179 @@
+#
+# Copyright (C) 2024 Victron Energy B.V.
+# See LICENSE.txt for license information.
+#
+# Registers a number of fake com.victronenergy.* services on the session bus, for measuring how
+# long the GUI takes to fetch the initial values of all services.
+#
+# Usage:
+#   dbus-run-session -- sh -c '
+#       python3 tools/fakedbusservices.py --count 50 --paths 200 --delay 20 &
+#       sleep 2
+#       venus-gui-v2 --dbus "$DBUS_SESSION_BUS_ADDRESS" --dbus-initial-fetch 16'
+#
+# Once every service has returned all of its values (with GetItems or GetValue on its root, or
+# GetValue on every path), the wall-clock time since the first request is printed. Run the GUI
+# with and without --dbus-initial-fetch to compare. --delay adds a per-call delay, like that of a
+# busy service on a GX device.
+#
+# Two seconds after the last call, the number of calls received by all services is printed, with
+# the number of services whose values were fetched more than once, so that duplicate startup
+# traffic (e.g. from two initial fetches of the same service) shows up.
+#
+# With --update-rate, each service also changes --changes paths that many times per second, and
+# sends a PropertiesChanged signal for each path, to measure the per-path signal load on the GUI.
+#
+# Requires dbus-python and PyGObject.
+import argparse
+import random
+import sys
+import time
+
+import dbus
+import dbus.service
+from dbus.mainloop.glib import DBusGMainLoop
+from gi.repository import GLib
+
+INTERFACE = 'com.victronenergy.BusItem'
+
+class Progress:
+    def __init__(self, count):
+        self.count = count
+        self.done = set()
+        self.start = None
+        self.calls = {}
+        self.refetched = set()
+        self.report_timer = None
+
+    def requested(self, method):
+        if self.start is None:
+            self.start = time.monotonic()
+        self.calls[method] = self.calls.get(method, 0) + 1
+        if self.report_timer is not None:
+            GLib.source_remove(self.report_timer)
+        self.report_timer = GLib.timeout_add(2000, self.report_calls)
+
+    def report_calls(self):
+        self.report_timer = None
+        print('Calls received: %s; %d services fetched more than once' % (
+                ', '.join('%d %s' % (n, m) for m, n in sorted(self.calls.items())), len(self.refetched)))
+        sys.stdout.flush()
+        return False
+
+    def completed(self, service):
+        if service in self.done:
+            self.refetched.add(service)
+            return
+        self.done.add(service)
+        if len(self.done) == self.count:
+            print('All %d services fetched in %d ms' % (self.count, (time.monotonic() - self.start) * 1000))
+            sys.stdout.flush()
+
+class Service(dbus.service.FallbackObject):
+    def __init__(self, bus, name, values, progress, delay):
+        self.name = name
+        self.values = values
+        self.progress = progress
+        self.delay = delay
+        self.fetched = set()
+        super().__init__(bus, '/')
+
+    def reply_later(self, method, reply_handler, result, completed):
+        # Reply from a timer rather than sleeping, so that the services answer concurrent calls
+        # concurrently, as separate processes would.
+        def reply():
+            reply_handler(result)
+            if completed:
+                self.progress.completed(self.name)
+            return False
+        self.progress.requested(method)
+        if self.delay:
+            GLib.timeout_add(self.delay, reply)
+        else:
+            reply()
+
+    def value(self, path):
+        value = self.values.get(path)
+        return dbus.Array([], signature='i') if value is None else value
+
+    @dbus.service.method(INTERFACE, out_signature='a{sa{sv}}', rel_path_keyword='path',
+            async_callbacks=('reply_handler', 'error_handler'))
+    def GetItems(self, path='/', reply_handler=None, error_handler=None):
+        items = { p: { 'Value': self.value(p), 'Text': str(v) } for p, v in self.values.items() }
+        self.reply_later('GetItems', reply_handler, items, True)
+
+    @dbus.service.method(INTERFACE, out_signature='v', rel_path_keyword='path',
+            async_callbacks=('reply_handler', 'error_handler'))
+    def GetValue(self, path='/', reply_handler=None, error_handler=None):
+        if path == '/':
+            values = dbus.Dictionary({ p[1:]: self.value(p) for p in self.values }, signature='sv', variant_level=1)
+            self.reply_later('GetValue on root', reply_handler, values, True)
+            return
+        self.fetched.add(path)
+        self.reply_later('GetValue on path', reply_handler, self.value(path), len(self.fetched) == len(self.values))
+
+    @dbus.service.method(INTERFACE, out_signature='v', rel_path_keyword='path')
+    def GetText(self, path='/'):
+        return str(self.values.get(path, ''))
+
+    @dbus.service.method(INTERFACE, in_signature='v', out_signature='i', rel_path_keyword='path')
+    def SetValue(self, value, path='/'):
+        self.values[path] = value
+        return 0
+
+    @dbus.service.signal(INTERFACE, signature='a{sv}', rel_path_keyword='path')
+    def PropertiesChanged(self, changes, path='/'):
+        pass
+
+    def update(self, change_count):
+        paths = random.sample([p for p in self.values if p.startswith('/Fake/')], change_count)
+        for p in paths:
+            value = dbus.Double(random.uniform(0, 100))
+            self.values[p] = value
+            self.PropertiesChanged({ 'Value': value, 'Text': '%.1f' % value }, path=p)
+        return True
+
+def create_values(service_type, instance, path_count):
+    values = {
+        '/DeviceInstance': dbus.Int32(instance),
+        '/ProductName': dbus.String('Fake %s %d' % (service_type, instance)),
+        '/Connected': dbus.Int32(1),
+        '/Mgmt/ProcessName': dbus.String('fakedbusservices'),
+    }
+    for i in range(path_count - len(values)):
+        values['/Fake/Path%d' % i] = dbus.Double(i * 0.5)
+    return values
+
+def main():
+    parser = argparse.ArgumentParser(description='Fake com.victronenergy D-Bus services')
+    parser.add_argument('--count', type=int, default=50, help='number of services')
+    parser.add_argument('--paths', type=int, default=100, help='number of paths per service')
+    parser.add_argument('--delay', type=int, default=0, help='delay per call, in milliseconds')
+    parser.add_argument('--update-rate', type=float, default=0, help='updates per second per service')
+    parser.add_argument('--changes', type=int, default=10, help='number of paths changed per update')
+    args = parser.parse_args()
+
+    DBusGMainLoop(set_as_default=True)
+    progress = Progress(args.count)
+    services = []
+    types = ['battery', 'solarcharger', 'tank', 'temperature', 'pvinverter']
+    for i in range(args.count):
+        service_type = types[i % len(types)]
+        name = 'com.victronenergy.%s.fake_%d' % (service_type, i)
+        # Each service has its own connection, as on a GX device.
+        bus = dbus.SessionBus(private=True)
+        services.append(Service(bus, name, create_values(service_type, 100 + i, args.paths), progress, args.delay))
+        services[-1].bus_name = dbus.service.BusName(name, bus)
+
+    if args.update_rate > 0:
+        changes = min(args.changes, max(0, args.paths - 4))
+        for service in services:
+            GLib.timeout_add(int(1000 / args.update_rate), service.update, changes)
+        print('Each service sends %d changes %.1f times per second' % (changes, args.update_rate))
+
+    print('Registered %d services with %d paths each' % (args.count, args.paths))
+    sys.stdout.flush()
+    GLib.MainLoop().run()
+
+if __name__ == '__main__':
+    main()
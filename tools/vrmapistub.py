@@ -0,0 +1,72 @@
+#
+# Copyright (C) 2024 Victron Energy B.V.
+# See LICENSE.txt for license information.
+#
+# A minimal stand-in for the VRM API, for testing the cached VRM login without a VRM account.
+#
+# Usage: python3 vrmapistub.py [--port 8080] [--webhost host] [--reject-tokens]
+# then run: venus-gui-v2 --shard vrm --vrm-api http://localhost:8080 --mqtt-portal-id <id> ...
+#
+# Each request is printed, so it is easy to see whether the GUI logged in again or used the
+# cached token. With --reject-tokens, /v2/users/me returns 401, so the GUI falls back to a fresh
+# login.
+import argparse
+import base64
+import json
+import time
+from http.server import BaseHTTPRequestHandler, HTTPServer
+
+ID_USER = 1234
+
+def make_token():
+    def encode(obj):
+        return base64.urlsafe_b64encode(json.dumps(obj).encode()).decode().rstrip('=')
+    payload = { 'uid': ID_USER, 'exp': int(time.time()) + 3600 }
+    return '%s.%s.stub' % (encode({ 'alg': 'none' }), encode(payload))
+
+class Handler(BaseHTTPRequestHandler):
+    def reply(self, status, obj):
+        body = json.dumps(obj).encode()
+        self.send_response(status)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_POST(self):
+        if self.path == '/v2/auth/login':
+            self.reply(200, { 'token': make_token(), 'idUser': ID_USER })
+        else:
+            self.reply(404, { 'success': False })
+
+    def do_GET(self):
+        if self.path == '/v2/users/me':
+            if self.server.reject_tokens:
+                self.reply(401, { 'success': False, 'errors': 'Token is invalid' })
+            else:
+                self.reply(200, { 'success': True, 'user': { 'id': ID_USER } })
+        elif self.path.startswith('/v2/users/%d/installations' % ID_USER):
+            self.reply(200, { 'success': True, 'records': [ {
+                'identifier': self.server.portal_id,
+                'mqtt_webhost': self.server.webhost,
+            } ] })
+        else:
+            self.reply(404, { 'success': False })
+
+def main():
+    parser = argparse.ArgumentParser(description='VRM API stub')
+    parser.add_argument('--port', type=int, default=8080)
+    parser.add_argument('--portal-id', default='c0619ab00001')
+    parser.add_argument('--webhost', default='webmqtt0.victronenergy.com')
+    parser.add_argument('--reject-tokens', action='store_true')
+    args = parser.parse_args()
+
+    server = HTTPServer(('', args.port), Handler)
+    server.portal_id = args.portal_id
+    server.webhost = args.webhost
+    server.reject_tokens = args.reject_tokens
+    print('VRM API stub listening on port %d' % args.port)
+    server.serve_forever()
+
+if __name__ == '__main__':
+    main()